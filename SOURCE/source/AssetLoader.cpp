@@ -0,0 +1,98 @@
+#include "pch.h"
+#include "AssetLoader.h"
+
+#include <SDL_image.h>
+
+#include "EGLBParser.h"
+#include "EOBJParser.h"
+#include "MeshOptimizer.h"
+
+AssetLoader::AssetLoader(ID3D11Device* pDevice, TextureCache& textureCache)
+	: m_pDevice(pDevice)
+	, m_TextureCache(textureCache)
+{
+	// IMG_Load initializes the image libraries on first use, which is not safe to race on
+	IMG_Init(IMG_INIT_PNG | IMG_INIT_JPG);
+}
+
+MeshView MeshAsset::GetView() const
+{
+	if (pCache != nullptr)
+		return pCache->GetView();
+	return MeshView{ vertices.data(), vertices.size(), indices.data(), indices.size() };
+}
+
+std::future<MeshAsset> AssetLoader::LoadMesh(const std::string& path)
+{
+	return m_ThreadPool.Submit([path]()
+		{
+			return ReadMesh(path);
+		});
+}
+
+MeshAsset AssetLoader::ReadMesh(const std::string& path, bool useCache)
+{
+	MeshAsset mesh{};
+	if (useCache)
+	{
+		auto pCache{ std::make_shared<const MeshCacheFile>(path) };
+		if (pCache->IsValid())
+		{
+			mesh.bounds = pCache->GetBounds();
+			mesh.acmrBefore = pCache->GetAcmrBefore();
+			mesh.acmrAfter = pCache->GetAcmrAfter();
+			mesh.isLoaded = true;
+			if (!pCache->IsTimeOutdated())
+			{
+				mesh.pCache = std::move(pCache);
+				return mesh;
+			}
+
+			// Rewritten with the new write time once the mapping is closed, the loaded data is used even when that fails
+			const MeshView view{ pCache->GetView() };
+			mesh.vertices.assign(view.pVertices, view.pVertices + view.vertexCount);
+			mesh.indices.assign(view.pIndices, view.pIndices + view.indexCount);
+			pCache.reset();
+			MeshCacheFile::Write(path, mesh.GetView(), mesh.bounds, mesh.acmrBefore, mesh.acmrAfter);
+			return mesh;
+		}
+	}
+
+	const bool isGLB{ path.size() >= 4 && path.compare(path.size() - 4, 4, ".glb") == 0 };
+	mesh.isLoaded = isGLB ? Elite::ParseGLB(path, mesh.vertices, mesh.indices) : Elite::ParseOBJ(path, mesh.vertices, mesh.indices);
+	if (!mesh.isLoaded)
+		return mesh;
+
+	OptimizeMesh(mesh.vertices, mesh.indices, mesh.acmrBefore, mesh.acmrAfter);
+	for (const IVertex& vertex : mesh.vertices)
+	{
+		Grow(mesh.bounds, vertex.pos);
+	}
+	if (useCache)
+	{
+		MeshCacheFile::Write(path, mesh.GetView(), mesh.bounds, mesh.acmrBefore, mesh.acmrAfter);
+	}
+	return mesh;
+}
+
+std::future<std::shared_ptr<Texture>> AssetLoader::LoadTexture(const std::string& path, TextureResidency residency, TextureFormat format)
+{
+	return m_ThreadPool.Submit([&textureCache = m_TextureCache, path, residency, format]()
+		{
+			return textureCache.GetTexture(path, residency, format);
+		});
+}
+
+std::future<std::shared_ptr<Texture>> AssetLoader::LoadPackedTexture(const std::vector<std::string>& channelPaths, TextureResidency residency,
+	TextureFormat format)
+{
+	return m_ThreadPool.Submit([&textureCache = m_TextureCache, channelPaths, residency, format]()
+		{
+			return textureCache.GetPackedTexture(channelPaths, residency, format);
+		});
+}
+
+ID3D11Device* AssetLoader::GetDevice() const
+{
+	return m_pDevice;
+}
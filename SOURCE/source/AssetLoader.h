@@ -0,0 +1,66 @@
+#pragma once
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Bounds.h"
+#include "MeshCache.h"
+#include "TextureCache.h"
+#include "ThreadPool.h"
+
+// Mesh data parsed and optimized for the vertex cache, ready for Mesh and TriangleMesh. A mesh read from its cache stays in
+// the mapping, which the asset keeps open, and leaves the vectors empty
+struct MeshAsset
+{
+	std::vector<IVertex> vertices{};
+	std::vector<uint32_t> indices{};
+	std::shared_ptr<const MeshCacheFile> pCache{};
+	AABB bounds{};
+	float acmrBefore{};
+	float acmrAfter{};
+	bool isLoaded{ false };
+
+	MeshView GetView() const;
+};
+
+// Loads assets on a thread pool, every Load returns right away with a future to wait on when the asset is needed.
+// The device is free threaded, so textures are created on the workers too. Call from one thread only.
+class AssetLoader final
+{
+public:
+	explicit AssetLoader(ID3D11Device* pDevice, TextureCache& textureCache);
+	AssetLoader(const AssetLoader& other) = delete;
+	AssetLoader(AssetLoader&& other) = delete;
+	AssetLoader& operator=(const AssetLoader& other) = delete;
+	AssetLoader& operator=(AssetLoader&& other) = delete;
+	// Waits for every outstanding load
+	~AssetLoader() = default;
+
+	// Parses an .obj or .glb file, see ReadMesh
+	std::future<MeshAsset> LoadMesh(const std::string& path);
+	// Reads the mesh cache of the file when it is still valid, or else parses and optimizes the file and writes the cache
+	static MeshAsset ReadMesh(const std::string& path, bool useCache = true);
+	// Goes through the texture cache, so requests for the same path share one texture
+	std::future<std::shared_ptr<Texture>> LoadTexture(const std::string& path, TextureResidency residency,
+		TextureFormat format = TextureFormat::RGBA8);
+	std::future<std::shared_ptr<Texture>> LoadPackedTexture(const std::vector<std::string>& channelPaths, TextureResidency residency,
+		TextureFormat format = TextureFormat::RGBA8);
+
+	// Runs any other loading work, like compiling an effect, on the pool
+	template<typename Function>
+	std::future<std::invoke_result_t<std::decay_t<Function>>> Run(Function&& function);
+
+	ID3D11Device* GetDevice() const;
+
+private:
+	ID3D11Device* m_pDevice;
+	TextureCache& m_TextureCache;
+	ThreadPool m_ThreadPool{};
+};
+
+template<typename Function>
+std::future<std::invoke_result_t<std::decay_t<Function>>> AssetLoader::Run(Function&& function)
+{
+	return m_ThreadPool.Submit(std::forward<Function>(function));
+}
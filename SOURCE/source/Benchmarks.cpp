@@ -0,0 +1,159 @@
+#include "pch.h"
+#include "Benchmarks.h"
+
+#include <cfloat>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <vector>
+
+#include "AssetLoader.h"
+#include "EOBJParser.h"
+#include "EGLBParser.h"
+#include "Texture.h"
+
+using namespace Elite;
+
+namespace
+{
+	// Runs the sampler over every footprint a few times, returns the fastest run
+	template<FilterMode filterMode>
+	double MeasureFilter(const Texture& texture, const std::vector<FVector2>& uvs, const std::vector<FVector2>& uvDdxs,
+		const std::vector<FVector2>& uvDdys, int iterations, float& checksum)
+	{
+		double bestSeconds{ DBL_MAX };
+		for (int i{ 0 }; i < iterations; ++i)
+		{
+			const auto start{ std::chrono::steady_clock::now() };
+			for (size_t sample{ 0 }; sample < uvs.size(); ++sample)
+			{
+				const RGBColor color{ texture.SampleGrad<AddressMode::Wrap, filterMode>(uvs[sample], uvDdxs[sample], uvDdys[sample]) };
+				checksum += color.r + color.g + color.b;
+			}
+			bestSeconds = std::min(bestSeconds, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+		}
+		return bestSeconds;
+	}
+}
+
+bool RunBenchmark(int argc, char* args[])
+{
+	if (argc < 3)
+		return false;
+
+	const std::string name{ args[1] };
+	const int iterations{ argc >= 4 ? std::max(1, std::atoi(args[3])) : 5 };
+	//Usage: --benchmark-obj <file> [iterations]
+	if (name == "--benchmark-obj")
+	{
+		BenchmarkOBJ(args[2], iterations);
+		return true;
+	}
+	//Usage: --benchmark-glb <file> [iterations]
+	if (name == "--benchmark-glb")
+	{
+		BenchmarkGLB(args[2], iterations);
+		return true;
+	}
+	//Usage: --benchmark-filters <texture> [iterations]
+	if (name == "--benchmark-filters")
+	{
+		BenchmarkFilters(args[2], iterations);
+		return true;
+	}
+	return false;
+}
+
+void BenchmarkOBJ(const std::string& filename, int iterations)
+{
+	std::error_code error{};
+	const double megabytes{ static_cast<double>(std::filesystem::file_size(filename, error)) / 1'000'000.0 };
+	if (error)
+	{
+		std::cout << "Could not open " << filename << "\n";
+		return;
+	}
+
+	const auto measure{ [iterations](const auto& load)
+		{
+			double bestSeconds{ DBL_MAX };
+			for (int i{ 0 }; i < iterations; ++i)
+			{
+				const auto start{ std::chrono::steady_clock::now() };
+				load();
+				bestSeconds = std::min(bestSeconds, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+			}
+			return bestSeconds;
+		} };
+
+	std::vector<IVertex> vertices{};
+	std::vector<uint32_t> indices{};
+	const double parseSeconds{ measure([&]() { ParseOBJ(filename, vertices, indices); }) };
+	std::cout << filename << ": " << megabytes << " MB, " << vertices.size() << " vertices, " << indices.size() / 3 << " triangles, "
+		<< parseSeconds * 1000.0 << " ms, " << megabytes / parseSeconds << " MB/s\n";
+
+	//What the asset loader does without and with the cache, the first cached read writes the cache when there is none yet
+	const double optimizeSeconds{ measure([&]() { AssetLoader::ReadMesh(filename, false); }) };
+	AssetLoader::ReadMesh(filename);
+	const double cacheSeconds{ measure([&]() { AssetLoader::ReadMesh(filename); }) };
+	std::cout << filename << " parsed and optimized: " << optimizeSeconds * 1000.0 << " ms, from cache: " << cacheSeconds * 1000.0 << " ms\n";
+}
+
+void BenchmarkGLB(const std::string& filename, int iterations)
+{
+	std::vector<IVertex> vertices{};
+	std::vector<uint32_t> indices{};
+	GLBContents contents{};
+	double bestSeconds{ DBL_MAX };
+	for (int i{ 0 }; i < iterations; ++i)
+	{
+		const auto start{ std::chrono::steady_clock::now() };
+		if (!ParseGLB(filename, vertices, indices, &contents))
+		{
+			std::cout << "Could not parse " << filename << "\n";
+			return;
+		}
+		bestSeconds = std::min(bestSeconds, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+	}
+	std::cout << filename << ": " << vertices.size() << " vertices, " << indices.size() / 3 << " triangles, " << contents.submeshes.size() << " primitives, "
+		<< contents.materials.size() << " materials, " << bestSeconds * 1000.0 << " ms\n";
+}
+
+// Samples a million pixels of a floor seen at a grazing angle, from magnified under the camera to stretched at the horizon,
+// and prints the cost of every filter mode with the texels uncompressed and as BC1
+void BenchmarkFilters(const std::string& filename, int iterations)
+{
+	constexpr int size{ 1000 };
+	std::vector<FVector2> uvs{};
+	std::vector<FVector2> uvDdxs{};
+	std::vector<FVector2> uvDdys{};
+	for (int row{ 0 }; row < size; ++row)
+	{
+		// Distance to the floor grows with 1 / height above the horizon
+		const float height{ (static_cast<float>(size - row) + .5f) / static_cast<float>(size) };
+		const float distance{ .05f / height };
+		for (int col{ 0 }; col < size; ++col)
+		{
+			const float across{ (static_cast<float>(col) + .5f) / static_cast<float>(size) - .5f };
+			uvs.push_back(FVector2{ across * distance * 4.f, distance * 4.f });
+			uvDdxs.push_back(FVector2{ distance * 4.f / static_cast<float>(size), 0.f });
+			uvDdys.push_back(FVector2{ across * distance * 4.f / (height * static_cast<float>(size)), distance * 4.f / (height * static_cast<float>(size)) });
+		}
+	}
+
+	for (const TextureFormat format : { TextureFormat::RGBA8, TextureFormat::BC1 })
+	{
+		const Texture texture{ filename, nullptr, TextureResidency::Cpu, format };
+		if (texture.GetMipLevelCount() == 0)
+			return;
+
+		float checksum{};
+		const double pointSeconds{ MeasureFilter<FilterMode::Point>(texture, uvs, uvDdxs, uvDdys, iterations, checksum) };
+		const double linearSeconds{ MeasureFilter<FilterMode::Linear>(texture, uvs, uvDdxs, uvDdys, iterations, checksum) };
+		const double anisotropicSeconds{ MeasureFilter<FilterMode::Anisotropic>(texture, uvs, uvDdxs, uvDdys, iterations, checksum) };
+		const double millions{ static_cast<double>(uvs.size()) / 1'000'000.0 };
+		std::cout << filename << (texture.GetFormat() == TextureFormat::RGBA8 ? " RGBA8 " : " BC ") << texture.GetCpuMemory() / 1024
+			<< " KB, ms per million samples: point " << pointSeconds * 1000.0 / millions << ", linear " << linearSeconds * 1000.0 / millions
+			<< ", anisotropic " << anisotropicSeconds * 1000.0 / millions << " (checksum " << checksum << ")\n";
+	}
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include <string>
+
+// Command line benchmarks of single parts of the engine, run instead of the renderer.
+// Returns false when the arguments name no benchmark, the application then starts as usual.
+bool RunBenchmark(int argc, char* args[]);
+
+// Parses the file a few times and prints the throughput of the fastest run, then the time the asset loader takes without
+// and with the mesh cache
+void BenchmarkOBJ(const std::string& filename, int iterations);
+// Parses a binary glTF file a few times and prints the time of the fastest run
+void BenchmarkGLB(const std::string& filename, int iterations);
+// Samples a floor seen at a grazing angle with every filter mode, uncompressed and as BC1, and prints the cost of each
+void BenchmarkFilters(const std::string& filename, int iterations);
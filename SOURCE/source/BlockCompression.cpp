@@ -0,0 +1,341 @@
+#include "pch.h"
+#include "BlockCompression.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace
+{
+	// Widened to 8 bits per channel by repeating the high bits, like the GPU does
+	void Expand565(uint16_t color, int* pChannels)
+	{
+		const int red{ (color >> 11) & 31 };
+		const int green{ (color >> 5) & 63 };
+		const int blue{ color & 31 };
+		pChannels[0] = (red << 3) | (red >> 2);
+		pChannels[1] = (green << 2) | (green >> 4);
+		pChannels[2] = (blue << 3) | (blue >> 2);
+	}
+
+	uint16_t Quantize565(const float* pChannels)
+	{
+		const auto quantize{ [](float channel, int maxValue)
+			{
+				return std::min(std::max(static_cast<int>(channel * static_cast<float>(maxValue) / 255.f + .5f), 0), maxValue);
+			} };
+		return static_cast<uint16_t>((quantize(pChannels[0], 31) << 11) | (quantize(pChannels[1], 63) << 5) | quantize(pChannels[2], 31));
+	}
+
+	// The four colors a color block picks from. BC1 blocks with color0 <= color1 have the halfway color and transparent
+	// black instead of the two thirds colors
+	void GetColorPalette(uint16_t color0, uint16_t color1, bool isBC1, uint32_t* pPalette)
+	{
+		int endpoint0[3]{};
+		int endpoint1[3]{};
+		Expand565(color0, endpoint0);
+		Expand565(color1, endpoint1);
+
+		const bool hasFourColors{ !isBC1 || color0 > color1 };
+		pPalette[0] = 0xFF000000;
+		pPalette[1] = 0xFF000000;
+		pPalette[2] = 0xFF000000;
+		pPalette[3] = hasFourColors ? 0xFF000000 : 0;
+		for (uint32_t channel{ 0 }; channel < 3; ++channel)
+		{
+			const int a{ endpoint0[channel] };
+			const int b{ endpoint1[channel] };
+			const uint32_t shift{ channel * 8 };
+			pPalette[0] |= static_cast<uint32_t>(a) << shift;
+			pPalette[1] |= static_cast<uint32_t>(b) << shift;
+			if (hasFourColors)
+			{
+				pPalette[2] |= static_cast<uint32_t>((2 * a + b + 1) / 3) << shift;
+				pPalette[3] |= static_cast<uint32_t>((a + 2 * b + 1) / 3) << shift;
+			}
+			else
+			{
+				pPalette[2] |= static_cast<uint32_t>((a + b + 1) / 2) << shift;
+			}
+		}
+	}
+
+	// Picks the nearest palette color for every texel, returns the summed squared error
+	uint32_t FindColorIndices(const uint32_t* pTexels, const uint32_t* pPalette, uint32_t& indices)
+	{
+		indices = 0;
+		uint32_t error{ 0 };
+		for (uint32_t i{ 0 }; i < 16; ++i)
+		{
+			uint32_t bestError{ UINT32_MAX };
+			uint32_t bestIndex{ 0 };
+			for (uint32_t index{ 0 }; index < 4; ++index)
+			{
+				uint32_t distance{ 0 };
+				for (uint32_t shift{ 0 }; shift < 24; shift += 8)
+				{
+					const int difference{ static_cast<int>((pTexels[i] >> shift) & 0xFF) - static_cast<int>((pPalette[index] >> shift) & 0xFF) };
+					distance += static_cast<uint32_t>(difference * difference);
+				}
+				if (distance < bestError)
+				{
+					bestError = distance;
+					bestIndex = index;
+				}
+			}
+			indices |= bestIndex << (i * 2);
+			error += bestError;
+		}
+		return error;
+	}
+
+	void EncodeColorBlock(const uint32_t* pTexels, uint8_t* pBlock)
+	{
+		float colors[16][3]{};
+		float minimum[3]{ 255.f, 255.f, 255.f };
+		float maximum[3]{ 0.f, 0.f, 0.f };
+		float mean[3]{};
+		for (int i{ 0 }; i < 16; ++i)
+		{
+			for (int channel{ 0 }; channel < 3; ++channel)
+			{
+				colors[i][channel] = static_cast<float>((pTexels[i] >> (channel * 8)) & 0xFF);
+				minimum[channel] = std::min(minimum[channel], colors[i][channel]);
+				maximum[channel] = std::max(maximum[channel], colors[i][channel]);
+				mean[channel] += colors[i][channel] / 16.f;
+			}
+		}
+
+		// The diagonal of the bounding box that follows the colors, red and blue are flipped when they fall as green rises
+		float covarianceRed{};
+		float covarianceBlue{};
+		for (int i{ 0 }; i < 16; ++i)
+		{
+			covarianceRed += (colors[i][0] - mean[0]) * (colors[i][1] - mean[1]);
+			covarianceBlue += (colors[i][2] - mean[2]) * (colors[i][1] - mean[1]);
+		}
+		if (covarianceRed < 0.f)
+			std::swap(minimum[0], maximum[0]);
+		if (covarianceBlue < 0.f)
+			std::swap(minimum[2], maximum[2]);
+
+		// Pulled in by a sixteenth of the range, so the interpolated colors spread over the box instead of its corners
+		float endpoint0[3]{};
+		float endpoint1[3]{};
+		for (int channel{ 0 }; channel < 3; ++channel)
+		{
+			const float inset{ (maximum[channel] - minimum[channel]) / 16.f };
+			endpoint0[channel] = maximum[channel] - inset;
+			endpoint1[channel] = minimum[channel] + inset;
+		}
+
+		uint16_t color0{ Quantize565(endpoint0) };
+		uint16_t color1{ Quantize565(endpoint1) };
+		uint32_t palette[4]{};
+		GetColorPalette(color0, color1, false, palette);
+		uint32_t indices{};
+		const uint32_t error{ FindColorIndices(pTexels, palette, indices) };
+
+		// One least squares pass for the endpoints that fit the picked indices best, kept when it lowers the error
+		constexpr float weights[4]{ 1.f, 0.f, 2.f / 3.f, 1.f / 3.f };
+		float aa{};
+		float ab{};
+		float bb{};
+		float ax[3]{};
+		float bx[3]{};
+		for (uint32_t i{ 0 }; i < 16; ++i)
+		{
+			const float a{ weights[(indices >> (i * 2)) & 3] };
+			const float b{ 1.f - a };
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+			for (int channel{ 0 }; channel < 3; ++channel)
+			{
+				ax[channel] += a * colors[i][channel];
+				bx[channel] += b * colors[i][channel];
+			}
+		}
+		// Zero when every texel picked the same weight
+		const float determinant{ aa * bb - ab * ab };
+		if (std::abs(determinant) > 1e-3f)
+		{
+			for (int channel{ 0 }; channel < 3; ++channel)
+			{
+				endpoint0[channel] = (ax[channel] * bb - bx[channel] * ab) / determinant;
+				endpoint1[channel] = (bx[channel] * aa - ax[channel] * ab) / determinant;
+			}
+			const uint16_t refinedColor0{ Quantize565(endpoint0) };
+			const uint16_t refinedColor1{ Quantize565(endpoint1) };
+			uint32_t refinedPalette[4]{};
+			GetColorPalette(refinedColor0, refinedColor1, false, refinedPalette);
+			uint32_t refinedIndices{};
+			if (FindColorIndices(pTexels, refinedPalette, refinedIndices) < error)
+			{
+				color0 = refinedColor0;
+				color1 = refinedColor1;
+				indices = refinedIndices;
+			}
+		}
+
+		// The four color mode of BC1 needs color0 > color1, swapping the endpoints swaps index 0 with 1 and 2 with 3
+		if (color0 < color1)
+		{
+			std::swap(color0, color1);
+			indices ^= 0x55555555;
+		}
+		else if (color0 == color1)
+		{
+			indices = 0;
+		}
+
+		pBlock[0] = static_cast<uint8_t>(color0);
+		pBlock[1] = static_cast<uint8_t>(color0 >> 8);
+		pBlock[2] = static_cast<uint8_t>(color1);
+		pBlock[3] = static_cast<uint8_t>(color1 >> 8);
+		for (int i{ 0 }; i < 4; ++i)
+		{
+			pBlock[4 + i] = static_cast<uint8_t>(indices >> (i * 8));
+		}
+	}
+
+	void DecodeColorBlock(const uint8_t* pBlock, bool isBC1, uint32_t* pTexels)
+	{
+		const uint16_t color0{ static_cast<uint16_t>(pBlock[0] | (pBlock[1] << 8)) };
+		const uint16_t color1{ static_cast<uint16_t>(pBlock[2] | (pBlock[3] << 8)) };
+		const uint32_t indices{ pBlock[4] | (pBlock[5] << 8) | (pBlock[6] << 16) | (static_cast<uint32_t>(pBlock[7]) << 24) };
+		uint32_t palette[4]{};
+		GetColorPalette(color0, color1, isBC1, palette);
+		for (uint32_t i{ 0 }; i < 16; ++i)
+		{
+			pTexels[i] = palette[(indices >> (i * 2)) & 3];
+		}
+	}
+
+	// The eight values a channel block picks from. Blocks with value0 <= value1 have four values in between and 0 and 255
+	void GetChannelPalette(int value0, int value1, int* pPalette)
+	{
+		pPalette[0] = value0;
+		pPalette[1] = value1;
+		if (value0 > value1)
+		{
+			for (int i{ 2 }; i < 8; ++i)
+			{
+				pPalette[i] = ((8 - i) * value0 + (i - 1) * value1 + 3) / 7;
+			}
+		}
+		else
+		{
+			for (int i{ 2 }; i < 6; ++i)
+			{
+				pPalette[i] = ((6 - i) * value0 + (i - 1) * value1 + 2) / 5;
+			}
+			pPalette[6] = 0;
+			pPalette[7] = 255;
+		}
+	}
+
+	// Shift picks the channel of the texels the block holds
+	void EncodeChannelBlock(const uint32_t* pTexels, uint32_t shift, uint8_t* pBlock)
+	{
+		int minimum{ 255 };
+		int maximum{ 0 };
+		for (int i{ 0 }; i < 16; ++i)
+		{
+			const int value{ static_cast<int>((pTexels[i] >> shift) & 0xFF) };
+			minimum = std::min(minimum, value);
+			maximum = std::max(maximum, value);
+		}
+
+		// Only the eight value mode, six steps between the extremes of the block
+		int palette[8]{};
+		GetChannelPalette(maximum, minimum, palette);
+		uint64_t indices{ 0 };
+		for (uint32_t i{ 0 }; i < 16; ++i)
+		{
+			const int value{ static_cast<int>((pTexels[i] >> shift) & 0xFF) };
+			int bestError{ INT32_MAX };
+			uint64_t bestIndex{ 0 };
+			for (uint64_t index{ 0 }; index < 8; ++index)
+			{
+				const int error{ std::abs(value - palette[index]) };
+				if (error < bestError)
+				{
+					bestError = error;
+					bestIndex = index;
+				}
+			}
+			indices |= bestIndex << (i * 3);
+		}
+
+		pBlock[0] = static_cast<uint8_t>(maximum);
+		pBlock[1] = static_cast<uint8_t>(minimum);
+		for (int i{ 0 }; i < 6; ++i)
+		{
+			pBlock[2 + i] = static_cast<uint8_t>(indices >> (i * 8));
+		}
+	}
+
+	// Replaces the channel at shift in the texels, the other channels are left alone
+	void DecodeChannelBlock(const uint8_t* pBlock, uint32_t shift, uint32_t* pTexels)
+	{
+		int palette[8]{};
+		GetChannelPalette(pBlock[0], pBlock[1], palette);
+		uint64_t indices{ 0 };
+		for (int i{ 0 }; i < 6; ++i)
+		{
+			indices |= static_cast<uint64_t>(pBlock[2 + i]) << (i * 8);
+		}
+		for (uint32_t i{ 0 }; i < 16; ++i)
+		{
+			const uint32_t value{ static_cast<uint32_t>(palette[(indices >> (i * 3)) & 7]) };
+			pTexels[i] = (pTexels[i] & ~(0xFFu << shift)) | (value << shift);
+		}
+	}
+}
+
+void EncodeBC1Block(const uint32_t* pTexels, uint8_t* pBlock)
+{
+	EncodeColorBlock(pTexels, pBlock);
+}
+
+void DecodeBC1Block(const uint8_t* pBlock, uint32_t* pTexels)
+{
+	DecodeColorBlock(pBlock, true, pTexels);
+}
+
+void EncodeBC3Block(const uint32_t* pTexels, uint8_t* pBlock)
+{
+	EncodeChannelBlock(pTexels, 24, pBlock);
+	EncodeColorBlock(pTexels, pBlock + 8);
+}
+
+void DecodeBC3Block(const uint8_t* pBlock, uint32_t* pTexels)
+{
+	DecodeColorBlock(pBlock + 8, false, pTexels);
+	DecodeChannelBlock(pBlock, 24, pTexels);
+}
+
+void EncodeBC4Block(const uint32_t* pTexels, uint8_t* pBlock)
+{
+	EncodeChannelBlock(pTexels, 0, pBlock);
+}
+
+void DecodeBC4Block(const uint8_t* pBlock, uint32_t* pTexels)
+{
+	std::fill(pTexels, pTexels + 16, 0xFF000000);
+	DecodeChannelBlock(pBlock, 0, pTexels);
+}
+
+void EncodeBC5Block(const uint32_t* pTexels, uint8_t* pBlock)
+{
+	EncodeChannelBlock(pTexels, 0, pBlock);
+	EncodeChannelBlock(pTexels, 8, pBlock + 8);
+}
+
+void DecodeBC5Block(const uint8_t* pBlock, uint32_t* pTexels)
+{
+	std::fill(pTexels, pTexels + 16, 0xFF000000);
+	DecodeChannelBlock(pBlock, 0, pTexels);
+	DecodeChannelBlock(pBlock + 8, 8, pTexels);
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <cstdint>
+
+// Encoders and decoders for single 4x4 blocks of the DirectX block compression formats. Texels are RGBA8 with red in the
+// lowest byte, 16 of them row by row, blocks are the bytes of the block as DirectX stores them.
+// Decoding rounds the interpolated values to the nearest 8 bit value, which is within the tolerance the DirectX spec gives
+// hardware decoders
+
+// 8 bytes, two 565 endpoints and 2 bits per texel. Always encoded in the four color mode, so alpha is dropped
+void EncodeBC1Block(const uint32_t* pTexels, uint8_t* pBlock);
+void DecodeBC1Block(const uint8_t* pBlock, uint32_t* pTexels);
+
+// 16 bytes, a BC4 block for alpha followed by a BC1 block for the color, which only has the four color mode
+void EncodeBC3Block(const uint32_t* pTexels, uint8_t* pBlock);
+void DecodeBC3Block(const uint8_t* pBlock, uint32_t* pTexels);
+
+// 8 bytes, two 8 bit endpoints and 3 bits per texel for the red channel. Decodes to red, 0, 0, 255 like the GPU
+void EncodeBC4Block(const uint32_t* pTexels, uint8_t* pBlock);
+void DecodeBC4Block(const uint8_t* pBlock, uint32_t* pTexels);
+
+// 16 bytes, a BC4 block for red followed by one for green. Decodes to red, green, 0, 255 like the GPU
+void EncodeBC5Block(const uint32_t* pTexels, uint8_t* pBlock);
+void DecodeBC5Block(const uint8_t* pBlock, uint32_t* pTexels);
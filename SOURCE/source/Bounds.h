@@ -0,0 +1,244 @@
+#pragma once
+#include "EMath.h"
+#include <vector>
+#include <cfloat>
+
+#include "Structs.h"
+
+struct AABB
+{
+	Elite::FPoint3 min{ FLT_MAX, FLT_MAX, FLT_MAX };
+	Elite::FPoint3 max{ -FLT_MAX, -FLT_MAX, -FLT_MAX };
+};
+
+struct BoundingSphere
+{
+	Elite::FPoint3 center{ 0.f, 0.f, 0.f };
+	float radius{};
+};
+
+// Planes are stored as (normal, distance) with the normal pointing into the frustum
+struct Frustum
+{
+	Elite::FVector4 planes[6]{};
+};
+
+struct Ray
+{
+	Elite::FPoint3 origin{ 0.f, 0.f, 0.f };
+	Elite::FVector3 direction{ 0.f, 0.f, 1.f };
+};
+
+enum class FrustumTest
+{
+	Outside,
+	Intersecting,
+	Inside
+};
+
+inline bool IsValid(const AABB& box)
+{
+	return box.min.x <= box.max.x && box.min.y <= box.max.y && box.min.z <= box.max.z;
+}
+
+inline void Grow(AABB& box, const Elite::FPoint3& point)
+{
+	box.min = Elite::FPoint3{ std::min(box.min.x, point.x), std::min(box.min.y, point.y), std::min(box.min.z, point.z) };
+	box.max = Elite::FPoint3{ std::max(box.max.x, point.x), std::max(box.max.y, point.y), std::max(box.max.z, point.z) };
+}
+
+inline void Grow(AABB& box, const AABB& other)
+{
+	Grow(box, other.min);
+	Grow(box, other.max);
+}
+
+inline Elite::FPoint3 GetCenter(const AABB& box)
+{
+	return Elite::FPoint3{ (box.min.x + box.max.x) / 2.f, (box.min.y + box.max.y) / 2.f, (box.min.z + box.max.z) / 2.f };
+}
+
+inline Elite::FVector3 GetExtent(const AABB& box)
+{
+	return (box.max - box.min) / 2.f;
+}
+
+inline AABB CalcBounds(const VertexStreams& vertices)
+{
+	AABB box{};
+	for (size_t i{ 0 }; i < vertices.count; ++i)
+	{
+		Grow(box, Elite::FPoint3{ vertices.x[i], vertices.y[i], vertices.z[i] });
+	}
+	return box;
+}
+
+inline BoundingSphere CalcBoundingSphere(const VertexStreams& vertices, const AABB& box)
+{
+	BoundingSphere sphere{ GetCenter(box), 0.f };
+	for (size_t i{ 0 }; i < vertices.count; ++i)
+	{
+		sphere.radius = std::max(sphere.radius, Elite::SqrMagnitude(Elite::FPoint3{ vertices.x[i], vertices.y[i], vertices.z[i] } - sphere.center));
+	}
+	sphere.radius = sqrtf(sphere.radius);
+	return sphere;
+}
+
+// Transforms the box and returns the axis aligned box around the result (Arvo)
+inline AABB TransformAABB(const Elite::FMatrix4& transform, const AABB& box)
+{
+	if (!IsValid(box))
+	{
+		return box;
+	}
+
+	const Elite::FPoint3 center{ GetCenter(box) };
+	const Elite::FVector3 extent{ GetExtent(box) };
+
+	const Elite::FPoint4 worldCenter{ transform * Elite::FPoint4{ center } };
+	Elite::FVector3 worldExtent{};
+	for (uint8_t row{ 0 }; row < 3; ++row)
+	{
+		worldExtent[row] =
+			std::abs(transform(row, 0)) * extent.x +
+			std::abs(transform(row, 1)) * extent.y +
+			std::abs(transform(row, 2)) * extent.z;
+	}
+
+	return AABB{ worldCenter.xyz - worldExtent, worldCenter.xyz + worldExtent };
+}
+
+inline BoundingSphere TransformBoundingSphere(const Elite::FMatrix4& transform, const BoundingSphere& sphere)
+{
+	const float maxScale
+	{
+		std::max(Elite::Magnitude(transform[0].xyz), std::max(Elite::Magnitude(transform[1].xyz), Elite::Magnitude(transform[2].xyz)))
+	};
+	const Elite::FPoint4 worldCenter{ transform * Elite::FPoint4{ sphere.center } };
+	return BoundingSphere{ worldCenter.xyz, sphere.radius * maxScale };
+}
+
+// Gribb-Hartmann plane extraction; clip space depth runs from 0 to w like the projection in Camera
+inline Frustum ExtractFrustum(const Elite::FMatrix4& viewProjection)
+{
+	const auto getRow = [&viewProjection](uint8_t row)
+	{
+		return Elite::FVector4{ viewProjection(row, 0), viewProjection(row, 1), viewProjection(row, 2), viewProjection(row, 3) };
+	};
+	const Elite::FVector4 row0{ getRow(0) };
+	const Elite::FVector4 row1{ getRow(1) };
+	const Elite::FVector4 row2{ getRow(2) };
+	const Elite::FVector4 row3{ getRow(3) };
+
+	Frustum frustum{};
+	frustum.planes[0] = row3 + row0; // left
+	frustum.planes[1] = row3 - row0; // right
+	frustum.planes[2] = row3 + row1; // bottom
+	frustum.planes[3] = row3 - row1; // top
+	frustum.planes[4] = row2; // near
+	frustum.planes[5] = row3 - row2; // far
+
+	for (Elite::FVector4& plane : frustum.planes)
+	{
+		plane /= Elite::Magnitude(plane.xyz);
+	}
+	return frustum;
+}
+
+inline float GetSignedDistance(const Elite::FVector4& plane, const Elite::FPoint3& point)
+{
+	return plane.x * point.x + plane.y * point.y + plane.z * point.z + plane.w;
+}
+
+inline bool IsInsideFrustum(const Frustum& frustum, const BoundingSphere& sphere)
+{
+	for (const Elite::FVector4& plane : frustum.planes)
+	{
+		if (GetSignedDistance(plane, sphere.center) < -sphere.radius)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+inline bool IsInsideFrustum(const Frustum& frustum, const AABB& box)
+{
+	for (const Elite::FVector4& plane : frustum.planes)
+	{
+		// Test the corner furthest along the plane normal
+		const Elite::FPoint3 positiveCorner
+		{
+			plane.x >= 0.f ? box.max.x : box.min.x,
+			plane.y >= 0.f ? box.max.y : box.min.y,
+			plane.z >= 0.f ? box.max.z : box.min.z
+		};
+		if (GetSignedDistance(plane, positiveCorner) < 0.f)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// Only the planes set in planeMask are tested, planes the box is completely inside of are cleared from the mask
+inline FrustumTest TestFrustum(const Frustum& frustum, const AABB& box, uint8_t& planeMask)
+{
+	for (uint8_t i{ 0 }; i < 6; ++i)
+	{
+		const uint8_t planeBit{ static_cast<uint8_t>(1 << i) };
+		if ((planeMask & planeBit) == 0)
+		{
+			continue;
+		}
+
+		const Elite::FVector4& plane{ frustum.planes[i] };
+		const Elite::FPoint3 positiveCorner
+		{
+			plane.x >= 0.f ? box.max.x : box.min.x,
+			plane.y >= 0.f ? box.max.y : box.min.y,
+			plane.z >= 0.f ? box.max.z : box.min.z
+		};
+		if (GetSignedDistance(plane, positiveCorner) < 0.f)
+		{
+			return FrustumTest::Outside;
+		}
+
+		const Elite::FPoint3 negativeCorner
+		{
+			plane.x >= 0.f ? box.min.x : box.max.x,
+			plane.y >= 0.f ? box.min.y : box.max.y,
+			plane.z >= 0.f ? box.min.z : box.max.z
+		};
+		if (GetSignedDistance(plane, negativeCorner) >= 0.f)
+		{
+			planeMask &= ~planeBit;
+		}
+	}
+	return planeMask == 0 ? FrustumTest::Inside : FrustumTest::Intersecting;
+}
+
+// Slab test, distance is the entry distance along the ray or 0 when the origin is inside the box
+inline bool IntersectRay(const AABB& box, const Ray& ray, float maxDistance, float& distance)
+{
+	float tMin{ 0.f };
+	float tMax{ maxDistance };
+	for (uint8_t axis{ 0 }; axis < 3; ++axis)
+	{
+		const float inverseDirection{ 1.f / ray.direction[axis] };
+		float t0{ (box.min[axis] - ray.origin[axis]) * inverseDirection };
+		float t1{ (box.max[axis] - ray.origin[axis]) * inverseDirection };
+		if (inverseDirection < 0.f)
+		{
+			std::swap(t0, t1);
+		}
+		tMin = std::max(tMin, t0);
+		tMax = std::min(tMax, t1);
+		if (tMax < tMin)
+		{
+			return false;
+		}
+	}
+	distance = tMin;
+	return true;
+}
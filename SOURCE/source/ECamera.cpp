@@ -18,6 +18,7 @@ namespace Elite
 		//Calculate initial matrices based on given parameters (position & target)
 		CalculateLookAt();
 		CalcProj();
+		CalcFrustum();
 	}
 
 	void Camera::Update(float elapsedSec)
@@ -54,6 +55,7 @@ namespace Elite
 		//Update LookAt (view2world & world2view matrices)
 		//*************
 		CalculateLookAt();
+		CalcFrustum();
 	}
 
 	void Camera::CalculateLookAt()
@@ -126,6 +128,14 @@ namespace Elite
 		}
 	}
 
+	Ray Camera::GetRHRay(const FPoint2& pixel) const
+	{
+		const float viewX{ (2.f * (pixel.x + 0.5f) / static_cast<float>(m_Width) - 1.f) * m_AspectRatio * m_Fov };
+		const float viewY{ (1.f - 2.f * (pixel.y + 0.5f) / static_cast<float>(m_Height)) * m_Fov };
+		const FVector4 direction{ m_ViewToWorldRH * FVector4{ viewX, viewY, -1.f } };
+		return Ray{ FPoint3{ m_ViewToWorldRH[3].xyz }, GetNormalized(direction.xyz) };
+	}
+
 	void Camera::CalcProj()
 	{
 			m_ProjectionLH = FMatrix4::Identity();
@@ -144,5 +154,9 @@ namespace Elite
 			m_ProjectionRH.data[3][2] = (m_FarClipPlane * m_NearClipPlane) / (m_NearClipPlane - m_FarClipPlane);
 			m_ProjectionRH.data[3][3] = 0.f;
 	}
+
+	void Camera::CalcFrustum()
+	{
+		m_FrustumRH = ExtractFrustum(m_ProjectionRH * m_WorldToViewRH);
+	}
 }
- 
\ No newline at end of file
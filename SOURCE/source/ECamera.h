@@ -7,6 +7,7 @@
 
 #pragma once
 #include "EMath.h"
+#include "Bounds.h"
 
 namespace Elite
 {
@@ -40,15 +41,21 @@ namespace Elite
 		const FMatrix4& GetRHWorldToView() const { return m_WorldToViewRH; }
 		const FMatrix4& GetRHViewToWorld() const { return m_ViewToWorldRH; }
 		const FMatrix4& GetRHProjection() const { return  m_ProjectionRH; }
+		const Frustum& GetRHFrustum() const { return m_FrustumRH; }
+		// World space ray through the center of a pixel, used for picking
+		Ray GetRHRay(const FPoint2& pixel) const;
 
 		int GetScreenWidth() const { return m_Width; }
 		int GetScreenHeight() const { return m_Height; }
 		float GetAspectRatio() const { return m_AspectRatio; }
 		float GetFov() const { return m_Fov; }
+		float GetNearClip() const { return m_NearClipPlane; }
+		float GetFarClip() const { return m_FarClipPlane; }
 
 	private:
 		void CalculateLookAt();
 		void CalcProj();
+		void CalcFrustum();
 
 		const int m_Width{};
 		const int m_Height{};
@@ -74,6 +81,7 @@ namespace Elite
 		FMatrix4 m_WorldToViewRH{};
 		FMatrix4 m_ViewToWorldRH{};
 		FMatrix4 m_ProjectionRH{};
+		Frustum m_FrustumRH{};
 
 		const float m_NearClipPlane;
 		const float m_FarClipPlane;
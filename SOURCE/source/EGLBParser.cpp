@@ -0,0 +1,746 @@
+#include "pch.h"
+#include "EGLBParser.h"
+
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <string_view>
+
+#include "EOBJParser.h"
+#include "MappedFile.h"
+
+namespace
+{
+	using namespace Elite;
+
+	constexpr uint32_t glbMagic{ 0x46546C67 };
+	constexpr uint32_t glbJsonChunk{ 0x4E4F534A };
+	constexpr uint32_t glbBinaryChunk{ 0x004E4942 };
+	constexpr int maxJsonDepth{ 64 };
+	constexpr int maxNodeDepth{ 64 };
+
+	// Parsed JSON, strings point into the mapped file and still contain their escapes
+	struct JsonValue
+	{
+		enum class Type : uint8_t
+		{
+			Null,
+			Boolean,
+			Number,
+			String,
+			Array,
+			Object
+		};
+
+		Type type{ Type::Null };
+		double number{};
+		std::string_view text{};
+		// Array elements, or object values in the order of keys
+		std::vector<JsonValue> elements{};
+		std::vector<std::string_view> keys{};
+
+		const JsonValue* Find(std::string_view key) const
+		{
+			for (size_t i{ 0 }; i < keys.size(); ++i)
+			{
+				if (keys[i] == key)
+					return &elements[i];
+			}
+			return nullptr;
+		}
+	};
+
+	// A buffer of the file, fileOffset is the position of the data in the .glb or SIZE_MAX when it is another file
+	struct GLBBuffer
+	{
+		const char* pData{ nullptr };
+		size_t size{};
+		size_t fileOffset{ SIZE_MAX };
+	};
+
+	struct GLBAccessor
+	{
+		const char* pData{ nullptr };
+		size_t count{};
+		size_t stride{};
+		uint32_t componentType{};
+		uint32_t componentCount{};
+		bool isNormalized{ false };
+	};
+
+	struct GLBFile
+	{
+		JsonValue root{};
+		std::vector<GLBBuffer> buffers{};
+		std::vector<std::unique_ptr<MappedFile>> externalFiles{};
+		std::string directory{};
+	};
+
+	const char* SkipJsonSpaces(const char* pText, const char* pEnd)
+	{
+		while (pText < pEnd && (*pText == ' ' || *pText == '\t' || *pText == '\n' || *pText == '\r'))
+			++pText;
+		return pText;
+	}
+
+	// Returns the position after the closing quote, or nullptr when the string does not end
+	const char* ParseJsonString(const char* pText, const char* pEnd, std::string_view& text)
+	{
+		const char* pBegin{ ++pText };
+		while (pText < pEnd && *pText != '"')
+		{
+			pText += *pText == '\\' ? 2 : 1;
+		}
+		if (pText >= pEnd)
+			return nullptr;
+
+		text = std::string_view{ pBegin, static_cast<size_t>(pText - pBegin) };
+		return pText + 1;
+	}
+
+	const char* ParseJsonValue(const char* pText, const char* pEnd, JsonValue& value, int depth)
+	{
+		pText = SkipJsonSpaces(pText, pEnd);
+		if (pText >= pEnd || depth > maxJsonDepth)
+			return nullptr;
+
+		const auto isWord{ [&](std::string_view word)
+			{
+				return static_cast<size_t>(pEnd - pText) >= word.size() && std::string_view{ pText, word.size() } == word;
+			} };
+
+		switch (*pText)
+		{
+		case '"':
+			value.type = JsonValue::Type::String;
+			return ParseJsonString(pText, pEnd, value.text);
+		case '[':
+		case '{':
+		{
+			const bool isObject{ *pText == '{' };
+			const char closing{ isObject ? '}' : ']' };
+			value.type = isObject ? JsonValue::Type::Object : JsonValue::Type::Array;
+			pText = SkipJsonSpaces(pText + 1, pEnd);
+			if (pText < pEnd && *pText == closing)
+				return pText + 1;
+
+			while (pText < pEnd)
+			{
+				if (isObject)
+				{
+					std::string_view key{};
+					if (*pText != '"' || !(pText = ParseJsonString(pText, pEnd, key)))
+						return nullptr;
+					pText = SkipJsonSpaces(pText, pEnd);
+					if (pText >= pEnd || *pText != ':')
+						return nullptr;
+					++pText;
+					value.keys.push_back(key);
+				}
+
+				value.elements.emplace_back();
+				if (!(pText = ParseJsonValue(pText, pEnd, value.elements.back(), depth + 1)))
+					return nullptr;
+
+				pText = SkipJsonSpaces(pText, pEnd);
+				if (pText < pEnd && *pText == closing)
+					return pText + 1;
+				if (pText >= pEnd || *pText != ',')
+					return nullptr;
+				pText = SkipJsonSpaces(pText + 1, pEnd);
+			}
+			return nullptr;
+		}
+		default:
+			if (isWord("true") || isWord("false"))
+			{
+				value.type = JsonValue::Type::Boolean;
+				value.number = *pText == 't' ? 1.0 : 0.0;
+				return pText + (*pText == 't' ? 4 : 5);
+			}
+			if (isWord("null"))
+			{
+				value.type = JsonValue::Type::Null;
+				return pText + 4;
+			}
+
+			value.type = JsonValue::Type::Number;
+			const std::from_chars_result result{ std::from_chars(pText, pEnd, value.number) };
+			return result.ec == std::errc{} ? result.ptr : nullptr;
+		}
+	}
+
+	// Decodes the JSON escapes and, for uris, the percent encoding of a string
+	std::string DecodeString(std::string_view text, bool isUri)
+	{
+		const auto hexValue{ [](char c)
+			{
+				return c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+			} };
+
+		std::string decoded{};
+		decoded.reserve(text.size());
+		for (size_t i{ 0 }; i < text.size(); ++i)
+		{
+			if (text[i] == '\\' && i + 1 < text.size())
+			{
+				const char escaped{ text[++i] };
+				switch (escaped)
+				{
+				case 'n': decoded += '\n'; break;
+				case 't': decoded += '\t'; break;
+				case 'r': decoded += '\r'; break;
+				case 'b': decoded += '\b'; break;
+				case 'f': decoded += '\f'; break;
+				case 'u':
+				{
+					// Code points are written as UTF-8, surrogate pairs are not combined
+					uint32_t codePoint{};
+					for (size_t j{ 0 }; j < 4 && i + 1 < text.size(); ++j)
+					{
+						codePoint = codePoint * 16 + static_cast<uint32_t>(std::max(0, hexValue(text[++i])));
+					}
+					if (codePoint < 0x80)
+					{
+						decoded += static_cast<char>(codePoint);
+					}
+					else if (codePoint < 0x800)
+					{
+						decoded += static_cast<char>(0xC0 | (codePoint >> 6));
+						decoded += static_cast<char>(0x80 | (codePoint & 0x3F));
+					}
+					else
+					{
+						decoded += static_cast<char>(0xE0 | (codePoint >> 12));
+						decoded += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+						decoded += static_cast<char>(0x80 | (codePoint & 0x3F));
+					}
+					break;
+				}
+				default: decoded += escaped; break;
+				}
+			}
+			else if (isUri && text[i] == '%' && i + 2 < text.size() && hexValue(text[i + 1]) >= 0 && hexValue(text[i + 2]) >= 0)
+			{
+				decoded += static_cast<char>(hexValue(text[i + 1]) * 16 + hexValue(text[i + 2]));
+				i += 2;
+			}
+			else
+			{
+				decoded += text[i];
+			}
+		}
+		return decoded;
+	}
+
+	double GetNumber(const JsonValue& object, std::string_view key, double defaultValue)
+	{
+		const JsonValue* pValue{ object.Find(key) };
+		return pValue && pValue->type == JsonValue::Type::Number ? pValue->number : defaultValue;
+	}
+
+	// Only whole numbers from 0 up to where a double still holds every integer, so the conversion is always defined
+	bool ToSize(double value, size_t& size)
+	{
+		constexpr double maxSize{ 9007199254740992.0 };
+		if (!(value >= 0.0 && value <= maxSize) || value != std::floor(value))
+			return false;
+		size = static_cast<size_t>(value);
+		return true;
+	}
+
+	// False when the key is missing or not a valid index
+	bool GetIndex(const JsonValue& object, std::string_view key, size_t& index)
+	{
+		const JsonValue* pValue{ object.Find(key) };
+		return pValue && pValue->type == JsonValue::Type::Number && ToSize(pValue->number, index);
+	}
+
+	// Counts, offsets and lengths: defaultSize when the key is missing, false when it is there but not a valid size
+	bool GetSize(const JsonValue& object, std::string_view key, size_t defaultSize, size_t& size)
+	{
+		if (!object.Find(key))
+		{
+			size = defaultSize;
+			return true;
+		}
+		return GetIndex(object, key, size);
+	}
+
+	// Whether length bytes from offset lie within size bytes, without the sum ever wrapping
+	bool IsInRange(size_t offset, size_t length, size_t size)
+	{
+		return offset <= size && length <= size - offset;
+	}
+
+	const JsonValue* GetElement(const JsonValue& root, std::string_view key, size_t index)
+	{
+		const JsonValue* pArray{ root.Find(key) };
+		if (!pArray || pArray->type != JsonValue::Type::Array || index >= pArray->elements.size())
+			return nullptr;
+		return &pArray->elements[index];
+	}
+
+	uint32_t GetComponentSize(uint32_t componentType)
+	{
+		switch (componentType)
+		{
+		case 5120: case 5121: return 1;
+		case 5122: case 5123: return 2;
+		case 5125: case 5126: return 4;
+		default: return 0;
+		}
+	}
+
+	uint32_t GetComponentCount(std::string_view type)
+	{
+		if (type == "SCALAR") return 1;
+		if (type == "VEC2") return 2;
+		if (type == "VEC3") return 3;
+		if (type == "VEC4") return 4;
+		return 0;
+	}
+
+	// Resolves an accessor to a strided range of a buffer, sparse accessors and accessors without data are not supported
+	bool GetAccessor(const GLBFile& file, size_t index, GLBAccessor& accessor)
+	{
+		const JsonValue* pAccessor{ GetElement(file.root, "accessors", index) };
+		size_t viewIndex{};
+		if (!pAccessor || !GetIndex(*pAccessor, "bufferView", viewIndex) || pAccessor->Find("sparse"))
+			return false;
+
+		const JsonValue* pView{ GetElement(file.root, "bufferViews", viewIndex) };
+		size_t bufferIndex{};
+		if (!pView || !GetIndex(*pView, "buffer", bufferIndex) || bufferIndex >= file.buffers.size())
+			return false;
+
+		const JsonValue* pType{ pAccessor->Find("type") };
+		size_t componentType{};
+		if (!GetIndex(*pAccessor, "componentType", componentType) || componentType > UINT32_MAX)
+			return false;
+		accessor.componentType = static_cast<uint32_t>(componentType);
+		accessor.componentCount = pType ? GetComponentCount(pType->text) : 0;
+		const size_t elementSize{ static_cast<size_t>(GetComponentSize(accessor.componentType)) * accessor.componentCount };
+		if (elementSize == 0)
+			return false;
+
+		const JsonValue* pNormalized{ pAccessor->Find("normalized") };
+		accessor.isNormalized = pNormalized && pNormalized->number != 0.0;
+		size_t viewOffset{}, viewLength{}, accessorOffset{};
+		if (!GetSize(*pAccessor, "count", 0, accessor.count) || !GetSize(*pView, "byteStride", 0, accessor.stride) ||
+			!GetSize(*pView, "byteOffset", 0, viewOffset) || !GetSize(*pView, "byteLength", 0, viewLength) ||
+			!GetSize(*pAccessor, "byteOffset", 0, accessorOffset))
+			return false;
+		if (accessor.stride == 0)
+			accessor.stride = elementSize;
+
+		// The last element starts count - 1 strides after the first, which is compared by division so nothing can wrap
+		const GLBBuffer& buffer{ file.buffers[bufferIndex] };
+		if (!IsInRange(viewOffset, viewLength, buffer.size))
+			return false;
+		if (accessor.count > 0 &&
+			(!IsInRange(accessorOffset, elementSize, viewLength) || accessor.count - 1 > (viewLength - accessorOffset - elementSize) / accessor.stride))
+			return false;
+
+		accessor.pData = buffer.pData + viewOffset + accessorOffset;
+		return true;
+	}
+
+	float ReadFloat(const GLBAccessor& accessor, size_t element, uint32_t component)
+	{
+		const char* pValue{ accessor.pData + element * accessor.stride + component * GetComponentSize(accessor.componentType) };
+		switch (accessor.componentType)
+		{
+		case 5120:
+		{
+			int8_t value{};
+			memcpy(&value, pValue, sizeof(value));
+			return accessor.isNormalized ? std::max(value / 127.f, -1.f) : value;
+		}
+		case 5121:
+		{
+			uint8_t value{};
+			memcpy(&value, pValue, sizeof(value));
+			return accessor.isNormalized ? value / 255.f : value;
+		}
+		case 5122:
+		{
+			int16_t value{};
+			memcpy(&value, pValue, sizeof(value));
+			return accessor.isNormalized ? std::max(value / 32767.f, -1.f) : value;
+		}
+		case 5123:
+		{
+			uint16_t value{};
+			memcpy(&value, pValue, sizeof(value));
+			return accessor.isNormalized ? value / 65535.f : value;
+		}
+		case 5126:
+		{
+			float value{};
+			memcpy(&value, pValue, sizeof(value));
+			return value;
+		}
+		default:
+			return 0.f;
+		}
+	}
+
+	uint32_t ReadIndex(const GLBAccessor& accessor, size_t element)
+	{
+		const char* pValue{ accessor.pData + element * accessor.stride };
+		switch (accessor.componentType)
+		{
+		case 5121:
+			return static_cast<uint8_t>(*pValue);
+		case 5123:
+		{
+			uint16_t value{};
+			memcpy(&value, pValue, sizeof(value));
+			return value;
+		}
+		default:
+		{
+			uint32_t value{};
+			memcpy(&value, pValue, sizeof(value));
+			return value;
+		}
+		}
+	}
+
+	FMatrix4 GetLocalTransform(const JsonValue& node)
+	{
+		const JsonValue* pMatrix{ node.Find("matrix") };
+		if (pMatrix && pMatrix->elements.size() == 16)
+		{
+			const auto column{ [pMatrix](size_t c)
+				{
+					return FVector4{ static_cast<float>(pMatrix->elements[c * 4].number), static_cast<float>(pMatrix->elements[c * 4 + 1].number),
+						static_cast<float>(pMatrix->elements[c * 4 + 2].number), static_cast<float>(pMatrix->elements[c * 4 + 3].number) };
+				} };
+			return FMatrix4{ column(0), column(1), column(2), column(3) };
+		}
+
+		const auto getVector{ [&node](std::string_view key, FVector4 value)
+			{
+				const JsonValue* pValue{ node.Find(key) };
+				if (pValue)
+				{
+					for (size_t i{ 0 }; i < std::min<size_t>(pValue->elements.size(), 4); ++i)
+					{
+						value[static_cast<uint8_t>(i)] = static_cast<float>(pValue->elements[i].number);
+					}
+				}
+				return value;
+			} };
+		const FVector4 t{ getVector("translation", FVector4{ 0.f, 0.f, 0.f, 0.f }) };
+		const FVector4 q{ getVector("rotation", FVector4{ 0.f, 0.f, 0.f, 1.f }) };
+		const FVector4 s{ getVector("scale", FVector4{ 1.f, 1.f, 1.f, 0.f }) };
+
+		return FMatrix4{
+			(1.f - 2.f * (q.y * q.y + q.z * q.z)) * s.x, 2.f * (q.x * q.y - q.z * q.w) * s.y, 2.f * (q.x * q.z + q.y * q.w) * s.z, t.x,
+			2.f * (q.x * q.y + q.z * q.w) * s.x, (1.f - 2.f * (q.x * q.x + q.z * q.z)) * s.y, 2.f * (q.y * q.z - q.x * q.w) * s.z, t.y,
+			2.f * (q.x * q.z - q.y * q.w) * s.x, 2.f * (q.y * q.z + q.x * q.w) * s.y, (1.f - 2.f * (q.x * q.x + q.y * q.y)) * s.z, t.z,
+			0.f, 0.f, 0.f, 1.f };
+	}
+
+	// Appends one triangle primitive transformed to world space and mirrored on z, like ParseOBJ does
+	bool AddPrimitive(const GLBFile& file, const JsonValue& primitive, const FMatrix4& transform,
+		std::vector<IVertex>& vertices, std::vector<uint32_t>& indices, GLBContents* pContents)
+	{
+		if (GetNumber(primitive, "mode", 4.0) != 4.0)
+			return true;
+
+		const JsonValue* pAttributes{ primitive.Find("attributes") };
+		size_t positionIndex{};
+		GLBAccessor positions{};
+		if (!pAttributes || !GetIndex(*pAttributes, "POSITION", positionIndex) || !GetAccessor(file, positionIndex, positions) ||
+			positions.componentCount != 3 || positions.count > UINT32_MAX - vertices.size())
+			return false;
+
+		const auto getAttribute{ [&](std::string_view key, uint32_t componentCount, GLBAccessor& accessor)
+			{
+				size_t index{};
+				return GetIndex(*pAttributes, key, index) && GetAccessor(file, index, accessor) &&
+					accessor.componentCount >= componentCount && accessor.count == positions.count;
+			} };
+		GLBAccessor normals{}, uvs{}, tangents{};
+		const bool hasNormals{ getAttribute("NORMAL", 3, normals) };
+		const bool hasUVs{ getAttribute("TEXCOORD_0", 2, uvs) };
+		const bool hasTangents{ getAttribute("TANGENT", 3, tangents) };
+
+		// Normals go through the cofactor matrix, the inverse transpose without the division by the determinant
+		const FVector3 a{ transform[0].xyz }, b{ transform[1].xyz }, c{ transform[2].xyz };
+		const float determinant{ Dot(Cross(a, b), c) };
+		const float normalSign{ determinant < 0.f ? -1.f : 1.f };
+		const FVector3 cofactor0{ Cross(b, c) * normalSign }, cofactor1{ Cross(c, a) * normalSign }, cofactor2{ Cross(a, b) * normalSign };
+
+		const size_t firstVertex{ vertices.size() };
+		const size_t firstIndex{ indices.size() };
+		vertices.resize(firstVertex + positions.count, IVertex{});
+		for (size_t i{ 0 }; i < positions.count; ++i)
+		{
+			IVertex& vertex{ vertices[firstVertex + i] };
+			const FPoint4 position{ transform * FPoint4{ ReadFloat(positions, i, 0), ReadFloat(positions, i, 1), ReadFloat(positions, i, 2), 1.f } };
+			vertex.pos = FPoint3{ position.x, position.y, -position.z };
+
+			if (hasNormals)
+			{
+				const FVector3 normal{ GetNormalized(cofactor0 * ReadFloat(normals, i, 0) + cofactor1 * ReadFloat(normals, i, 1) +
+					cofactor2 * ReadFloat(normals, i, 2)) };
+				vertex.normal = FVector3{ normal.x, normal.y, -normal.z };
+			}
+			if (hasUVs)
+			{
+				// glTF already has its uv origin in the top left, where ParseOBJ flips v
+				vertex.uv = FPoint2{ ReadFloat(uvs, i, 0), ReadFloat(uvs, i, 1) };
+			}
+			if (hasTangents)
+			{
+				const FVector3 tangent{ GetNormalized(a * ReadFloat(tangents, i, 0) + b * ReadFloat(tangents, i, 1) + c * ReadFloat(tangents, i, 2)) };
+				vertex.tangent = FVector3{ tangent.x, tangent.y, -tangent.z };
+			}
+		}
+
+		size_t indicesIndex{};
+		if (GetIndex(primitive, "indices", indicesIndex))
+		{
+			GLBAccessor primitiveIndices{};
+			if (!GetAccessor(file, indicesIndex, primitiveIndices) || primitiveIndices.componentCount != 1 ||
+				primitiveIndices.componentType == 5120 || primitiveIndices.componentType == 5122 || primitiveIndices.componentType == 5126)
+				return false;
+
+			indices.resize(firstIndex + primitiveIndices.count / 3 * 3);
+			for (size_t i{ firstIndex }; i < indices.size(); ++i)
+			{
+				const uint32_t index{ ReadIndex(primitiveIndices, i - firstIndex) };
+				if (index >= positions.count)
+					return false;
+				indices[i] = static_cast<uint32_t>(firstVertex) + index;
+			}
+		}
+		else
+		{
+			indices.resize(firstIndex + positions.count / 3 * 3);
+			for (size_t i{ firstIndex }; i < indices.size(); ++i)
+			{
+				indices[i] = static_cast<uint32_t>(firstVertex + i - firstIndex);
+			}
+		}
+
+		// A mirroring transform turns the faces inside out
+		if (determinant < 0.f)
+		{
+			for (size_t i{ firstIndex }; i < indices.size(); i += 3)
+			{
+				std::swap(indices[i + 1], indices[i + 2]);
+			}
+		}
+
+		if (!hasTangents)
+			CalcTangents(vertices, indices, firstIndex, firstVertex);
+
+		if (pContents)
+		{
+			size_t material{};
+			GLBSubmesh submesh{ static_cast<uint32_t>(firstIndex), static_cast<uint32_t>(indices.size() - firstIndex) };
+			if (GetIndex(primitive, "material", material))
+				submesh.material = static_cast<uint32_t>(material);
+			pContents->submeshes.push_back(submesh);
+		}
+		return true;
+	}
+
+	bool AddNode(const GLBFile& file, size_t nodeIndex, const FMatrix4& parentTransform, int depth,
+		std::vector<IVertex>& vertices, std::vector<uint32_t>& indices, GLBContents* pContents)
+	{
+		const JsonValue* pNode{ GetElement(file.root, "nodes", nodeIndex) };
+		if (!pNode || depth > maxNodeDepth)
+			return false;
+
+		const FMatrix4 transform{ parentTransform * GetLocalTransform(*pNode) };
+		size_t meshIndex{};
+		if (GetIndex(*pNode, "mesh", meshIndex))
+		{
+			const JsonValue* pMesh{ GetElement(file.root, "meshes", meshIndex) };
+			const JsonValue* pPrimitives{ pMesh ? pMesh->Find("primitives") : nullptr };
+			if (!pPrimitives)
+				return false;
+			for (const JsonValue& primitive : pPrimitives->elements)
+			{
+				if (!AddPrimitive(file, primitive, transform, vertices, indices, pContents))
+					return false;
+			}
+		}
+
+		const JsonValue* pChildren{ pNode->Find("children") };
+		if (pChildren)
+		{
+			for (const JsonValue& child : pChildren->elements)
+			{
+				size_t childIndex{};
+				if (!ToSize(child.number, childIndex) || !AddNode(file, childIndex, transform, depth + 1, vertices, indices, pContents))
+					return false;
+			}
+		}
+		return true;
+	}
+
+	GLBTextureReference GetTextureReference(const GLBFile& file, const JsonValue* pTextureInfo)
+	{
+		GLBTextureReference reference{};
+		size_t textureIndex{}, imageIndex{};
+		const JsonValue* pTexture{ pTextureInfo && GetIndex(*pTextureInfo, "index", textureIndex) ? GetElement(file.root, "textures", textureIndex) : nullptr };
+		const JsonValue* pImage{ pTexture && GetIndex(*pTexture, "source", imageIndex) ? GetElement(file.root, "images", imageIndex) : nullptr };
+		if (!pImage)
+			return reference;
+
+		const JsonValue* pMimeType{ pImage->Find("mimeType") };
+		if (pMimeType)
+			reference.mimeType = DecodeString(pMimeType->text, false);
+
+		const JsonValue* pUri{ pImage->Find("uri") };
+		size_t viewIndex{};
+		if (pUri && pUri->text.substr(0, 5) != "data:")
+		{
+			reference.path = file.directory + DecodeString(pUri->text, true);
+		}
+		else if (GetIndex(*pImage, "bufferView", viewIndex))
+		{
+			const JsonValue* pView{ GetElement(file.root, "bufferViews", viewIndex) };
+			size_t bufferIndex{};
+			size_t viewOffset{}, viewLength{};
+			if (pView && GetIndex(*pView, "buffer", bufferIndex) && bufferIndex < file.buffers.size() && file.buffers[bufferIndex].fileOffset != SIZE_MAX &&
+				GetSize(*pView, "byteOffset", 0, viewOffset) && GetSize(*pView, "byteLength", 0, viewLength) &&
+				IsInRange(viewOffset, viewLength, file.buffers[bufferIndex].size))
+			{
+				reference.byteOffset = file.buffers[bufferIndex].fileOffset + viewOffset;
+				reference.byteLength = viewLength;
+			}
+		}
+		return reference;
+	}
+
+	void AddMaterials(const GLBFile& file, GLBContents& contents)
+	{
+		const JsonValue* pMaterials{ file.root.Find("materials") };
+		if (!pMaterials)
+			return;
+
+		for (const JsonValue& material : pMaterials->elements)
+		{
+			GLBMaterial& result{ contents.materials.emplace_back() };
+			const JsonValue* pName{ material.Find("name") };
+			if (pName)
+				result.name = DecodeString(pName->text, false);
+
+			const JsonValue* pPbr{ material.Find("pbrMetallicRoughness") };
+			result.diffuse = GetTextureReference(file, pPbr ? pPbr->Find("baseColorTexture") : nullptr);
+			result.metallicRoughness = GetTextureReference(file, pPbr ? pPbr->Find("metallicRoughnessTexture") : nullptr);
+			result.normal = GetTextureReference(file, material.Find("normalTexture"));
+		}
+	}
+}
+
+bool Elite::ParseGLB(const std::string& filename, std::vector<IVertex>& vertices, std::vector<uint32_t>& indices, GLBContents* pContents)
+{
+	const MappedFile mappedFile{ filename };
+	if (!mappedFile.IsOpen() || mappedFile.GetSize() < 20)
+		return false;
+
+	const char* pData{ mappedFile.GetData() };
+	const size_t size{ mappedFile.GetSize() };
+	const auto readUint{ [pData](size_t offset)
+		{
+			uint32_t value{};
+			memcpy(&value, pData + offset, sizeof(value));
+			return value;
+		} };
+	if (readUint(0) != glbMagic || readUint(4) != 2)
+		return false;
+
+	// The JSON chunk comes first, the optional binary chunk right after it
+	const size_t jsonLength{ readUint(12) };
+	if (readUint(16) != glbJsonChunk || 20 + jsonLength > size)
+		return false;
+
+	GLBFile file{};
+	const char* pJsonEnd{ pData + 20 + jsonLength };
+	const char* pJsonParsed{ ParseJsonValue(pData + 20, pJsonEnd, file.root, 0) };
+	if (!pJsonParsed || SkipJsonSpaces(pJsonParsed, pJsonEnd) != pJsonEnd || file.root.type != JsonValue::Type::Object)
+		return false;
+
+	GLBBuffer binaryChunk{};
+	const size_t binaryHeader{ (20 + jsonLength + 3) & ~size_t{ 3 } };
+	if (binaryHeader + 8 <= size && readUint(binaryHeader + 4) == glbBinaryChunk)
+	{
+		binaryChunk.pData = pData + binaryHeader + 8;
+		binaryChunk.size = std::min<size_t>(readUint(binaryHeader), size - binaryHeader - 8);
+		binaryChunk.fileOffset = binaryHeader + 8;
+	}
+
+	const size_t directoryEnd{ filename.find_last_of("/\\") };
+	file.directory = directoryEnd == std::string::npos ? std::string{} : filename.substr(0, directoryEnd + 1);
+
+	const JsonValue* pBuffers{ file.root.Find("buffers") };
+	if (pBuffers)
+	{
+		for (const JsonValue& buffer : pBuffers->elements)
+		{
+			const JsonValue* pUri{ buffer.Find("uri") };
+			if (!pUri)
+			{
+				file.buffers.push_back(binaryChunk);
+				continue;
+			}
+			if (pUri->text.substr(0, 5) == "data:")
+				return false;
+
+			const MappedFile& external{ *file.externalFiles.emplace_back(std::make_unique<MappedFile>(file.directory + DecodeString(pUri->text, true))) };
+			if (!external.IsOpen())
+				return false;
+			file.buffers.push_back(GLBBuffer{ external.GetData(), external.GetSize() });
+		}
+	}
+
+	vertices.clear();
+	indices.clear();
+	if (pContents)
+	{
+		*pContents = GLBContents{};
+		AddMaterials(file, *pContents);
+	}
+
+	// The default scene, or every mesh untransformed when the file has no scenes
+	size_t sceneIndex{};
+	const JsonValue* pScene{ GetSize(file.root, "scene", 0, sceneIndex) ? GetElement(file.root, "scenes", sceneIndex) : nullptr };
+	const JsonValue* pNodes{ pScene ? pScene->Find("nodes") : nullptr };
+	if (pNodes)
+	{
+		for (const JsonValue& node : pNodes->elements)
+		{
+			size_t nodeIndex{};
+			if (!ToSize(node.number, nodeIndex) || !AddNode(file, nodeIndex, FMatrix4::Identity(), 0, vertices, indices, pContents))
+				return false;
+		}
+		return true;
+	}
+
+	const JsonValue* pMeshes{ file.root.Find("meshes") };
+	if (pMeshes)
+	{
+		for (const JsonValue& mesh : pMeshes->elements)
+		{
+			const JsonValue* pPrimitives{ mesh.Find("primitives") };
+			if (!pPrimitives)
+				return false;
+			for (const JsonValue& primitive : pPrimitives->elements)
+			{
+				if (!AddPrimitive(file, primitive, FMatrix4::Identity(), vertices, indices, pContents))
+					return false;
+			}
+		}
+	}
+	return true;
+}
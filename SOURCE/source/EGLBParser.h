@@ -0,0 +1,47 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "EMath.h"
+#include "Structs.h"
+
+namespace Elite
+{
+	//Image used by a material, either a file next to the .glb or a range of the .glb itself
+	struct GLBTextureReference
+	{
+		std::string path{};
+		std::string mimeType{};
+		size_t byteOffset{};
+		size_t byteLength{};
+
+		bool IsValid() const { return !path.empty() || byteLength > 0; }
+		bool IsEmbedded() const { return path.empty() && byteLength > 0; }
+	};
+
+	struct GLBMaterial
+	{
+		std::string name{};
+		GLBTextureReference diffuse{};
+		GLBTextureReference normal{};
+		GLBTextureReference metallicRoughness{};
+	};
+
+	//Index range of one glTF primitive in the merged index array
+	struct GLBSubmesh
+	{
+		uint32_t firstIndex{};
+		uint32_t indexCount{};
+		uint32_t material{ UINT32_MAX };
+	};
+
+	struct GLBContents
+	{
+		std::vector<GLBMaterial> materials{};
+		std::vector<GLBSubmesh> submeshes{};
+	};
+
+	//Parses the triangle primitives of the default scene of a binary glTF into one vertex and index array, in the same
+	//left handed space as ParseOBJ. Node transforms are applied, tangents are calculated when the file has none.
+	//The file is memory mapped and every attribute is read straight from the binary chunk into the vertices.
+	bool ParseGLB(const std::string& filename, std::vector<IVertex>& vertices, std::vector<uint32_t>& indices, GLBContents* pContents = nullptr);
+}
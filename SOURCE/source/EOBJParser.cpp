@@ -0,0 +1,359 @@
+#include "pch.h"
+#include "EOBJParser.h"
+
+#include <charconv>
+#include <cstring>
+#include <string_view>
+#include <thread>
+
+#include "MappedFile.h"
+
+namespace
+{
+	using namespace Elite;
+
+	// Files smaller than this per thread are not worth splitting
+	constexpr size_t minChunkSize{ 1 << 20 };
+
+	// OBJ indices of a face corner, 1-based and 0 when the corner has none. Relative (negative) indices are
+	// stored relative to the start of their chunk, with their bit set in relativeMask, until the chunk offsets are known
+	struct OBJCorner
+	{
+		int64_t position, texCoord, normal;
+		uint8_t relativeMask;
+	};
+
+	struct OBJCornerKey
+	{
+		int64_t position, texCoord, normal;
+		bool operator==(const OBJCornerKey& other) const { return position == other.position && texCoord == other.texCoord && normal == other.normal; }
+	};
+
+	// Open addressing map from corner to vertex, sized up front for every corner of the file.
+	// std::unordered_map spends most of the weld allocating a node per corner. Position 0 marks an empty slot
+	class OBJCornerTable final
+	{
+	public:
+		explicit OBJCornerTable(size_t cornerAmount)
+		{
+			size_t capacity{ 16 };
+			while (capacity < cornerAmount * 2)
+			{
+				capacity *= 2;
+			}
+			m_Keys.resize(capacity, OBJCornerKey{ 0, 0, 0 });
+			m_Vertices.resize(capacity);
+			m_Mask = capacity - 1;
+		}
+
+		// Returns the vertex of the corner, or adds it with newVertex
+		uint32_t FindOrAdd(const OBJCornerKey& key, uint32_t newVertex, bool& isAdded)
+		{
+			uint64_t hash
+			{
+				static_cast<uint64_t>(key.position) * 0x9E3779B97F4A7C15ull ^
+				static_cast<uint64_t>(key.texCoord) * 0xC2B2AE3D27D4EB4Full ^
+				static_cast<uint64_t>(key.normal) * 0x165667B19E3779F9ull
+			};
+			hash ^= hash >> 32;
+
+			for (size_t slot{ static_cast<size_t>(hash) & m_Mask };; slot = (slot + 1) & m_Mask)
+			{
+				if (m_Keys[slot].position == 0)
+				{
+					m_Keys[slot] = key;
+					m_Vertices[slot] = newVertex;
+					isAdded = true;
+					return newVertex;
+				}
+				if (m_Keys[slot] == key)
+				{
+					isAdded = false;
+					return m_Vertices[slot];
+				}
+			}
+		}
+
+	private:
+		std::vector<OBJCornerKey> m_Keys;
+		std::vector<uint32_t> m_Vertices;
+		size_t m_Mask{};
+	};
+
+	struct OBJChunk
+	{
+		std::vector<FPoint3> positions;
+		std::vector<FVector3> normals;
+		std::vector<FVector2> UVs;
+		std::vector<OBJCorner> corners;
+	};
+
+	bool IsSpace(char character)
+	{
+		return character == ' ' || character == '\t' || character == '\r' || character == '\v' || character == '\f';
+	}
+
+	const char* SkipSpaces(const char* pText, const char* pEnd)
+	{
+		while (pText < pEnd && IsSpace(*pText))
+		{
+			++pText;
+		}
+		return pText;
+	}
+
+	const char* ParseFloat(const char* pText, const char* pEnd, float& value)
+	{
+		pText = SkipSpaces(pText, pEnd);
+		if (pText < pEnd && *pText == '+')
+		{
+			++pText;
+		}
+
+		value = 0.f;
+		return std::from_chars(pText, pEnd, value).ptr;
+	}
+
+	const char* ParseIndex(const char* pText, const char* pEnd, size_t elementCount, uint8_t relativeBit, OBJCorner& corner, int64_t& index)
+	{
+		pText = SkipSpaces(pText, pEnd);
+		int64_t value{};
+		const std::from_chars_result result{ std::from_chars(pText, pEnd, value) };
+		index = 0;
+		if (result.ec == std::errc{})
+		{
+			index = value;
+			if (value < 0)
+			{
+				index = static_cast<int64_t>(elementCount) + value + 1;
+				corner.relativeMask |= relativeBit;
+			}
+		}
+		return result.ptr;
+	}
+
+	// Same corner syntax as the stream parser read: v, v/vt, v//vn or v/vt/vn
+	const char* ParseCorner(const char* pText, const char* pEnd, const OBJChunk& chunk, OBJCorner& corner)
+	{
+		corner = OBJCorner{};
+		pText = ParseIndex(pText, pEnd, chunk.positions.size(), 1, corner, corner.position);
+		if (pText < pEnd && *pText == '/')
+		{
+			++pText;
+			if (pText < pEnd && *pText != '/')
+			{
+				pText = ParseIndex(pText, pEnd, chunk.UVs.size(), 2, corner, corner.texCoord);
+			}
+			if (pText < pEnd && *pText == '/')
+			{
+				++pText;
+				pText = ParseIndex(pText, pEnd, chunk.normals.size(), 4, corner, corner.normal);
+			}
+		}
+		return pText;
+	}
+
+	void ParseChunk(const char* pBegin, const char* pEnd, OBJChunk& chunk)
+	{
+		const char* pLine{ pBegin };
+		while (pLine < pEnd)
+		{
+			const char* pLineEnd{ static_cast<const char*>(memchr(pLine, '\n', static_cast<size_t>(pEnd - pLine))) };
+			if (!pLineEnd)
+			{
+				pLineEnd = pEnd;
+			}
+
+			const char* pCommand{ SkipSpaces(pLine, pLineEnd) };
+			const char* pText{ pCommand };
+			while (pText < pLineEnd && !IsSpace(*pText))
+			{
+				++pText;
+			}
+			const std::string_view command{ pCommand, static_cast<size_t>(pText - pCommand) };
+
+			if (command == "v")
+			{
+				float x{}, y{}, z{};
+				pText = ParseFloat(pText, pLineEnd, x);
+				pText = ParseFloat(pText, pLineEnd, y);
+				ParseFloat(pText, pLineEnd, z);
+				chunk.positions.push_back(FPoint3(x, y, -z));
+			}
+			else if (command == "vt")
+			{
+				float u{}, v{};
+				pText = ParseFloat(pText, pLineEnd, u);
+				ParseFloat(pText, pLineEnd, v);
+				chunk.UVs.push_back(FVector2(u, 1 - v));
+			}
+			else if (command == "vn")
+			{
+				float x{}, y{}, z{};
+				pText = ParseFloat(pText, pLineEnd, x);
+				pText = ParseFloat(pText, pLineEnd, y);
+				ParseFloat(pText, pLineEnd, z);
+				chunk.normals.push_back(FVector3(x, y, -z));
+			}
+			else if (command == "f")
+			{
+				// Only triangles, corners past the third are ignored
+				for (size_t iFace = 0; iFace < 3; iFace++)
+				{
+					OBJCorner corner{};
+					pText = ParseCorner(pText, pLineEnd, chunk, corner);
+					chunk.corners.push_back(corner);
+				}
+			}
+
+			pLine = pLineEnd + 1;
+		}
+	}
+
+	// Turns an index relative to its chunk into a global 1-based one
+	int64_t ResolveIndex(int64_t index, bool isRelative, size_t chunkOffset)
+	{
+		return isRelative ? static_cast<int64_t>(chunkOffset) + index : index;
+	}
+}
+
+void Elite::CalcTangents(std::vector<IVertex>& vertices, const std::vector<uint32_t>& indices, size_t firstIndex, size_t firstVertex)
+{
+	for (size_t i{ firstIndex }; i + 2 < indices.size(); i += 3)
+	{
+		const uint32_t idx0 = indices[i];
+		const uint32_t idx1 = indices[i + 1];
+		const uint32_t idx2 = indices[i + 2];
+
+		const FPoint3& p0 = vertices[idx0].pos;
+		const FPoint3& p1 = vertices[idx1].pos;
+		const FPoint3& p2 = vertices[idx2].pos;
+		const FPoint2& uv0 = vertices[idx0].uv;
+		const FPoint2& uv1 = vertices[idx1].uv;
+		const FPoint2& uv2 = vertices[idx2].uv;
+
+		const FVector3 edge0 = p1 - p0;
+		const FVector3 edge1 = p2 - p0;
+		const FVector2 diffX{ uv1.x - uv0.x, uv2.x - uv0.x };
+		const FVector2 diffY{ uv1.y - uv0.y, uv2.y - uv0.y };
+		const float uvArea = Cross(diffX, diffY);
+		// A face without uv area has no tangent, skip it instead of spreading infinities over the welded vertices
+		if (uvArea == 0.f)
+			continue;
+		const float r = 1.f / uvArea;
+
+		FVector3 tangent = (edge0 * diffY.y - edge1 * diffY.x) * r;
+		vertices[idx0].tangent += tangent;
+		vertices[idx1].tangent += tangent;
+		vertices[idx2].tangent += tangent;
+	}
+
+	for (size_t i{ firstVertex }; i < vertices.size(); ++i)
+	{
+		IVertex& vertex{ vertices[i] };
+		vertex.tangent = GetNormalized(Reject(vertex.tangent, vertex.normal));
+	}
+}
+
+bool Elite::ParseOBJ(const std::string& filename, std::vector<IVertex>& vertices, std::vector<uint32_t>& indices)
+{
+	const MappedFile file{ filename };
+	if (!file.IsOpen())
+		return false;
+
+	vertices.clear();
+	indices.clear();
+
+	// Split on line ends, every chunk gets its own thread and the first one runs on this thread
+	const char* pData{ file.GetData() };
+	const size_t size{ file.GetSize() };
+	const size_t chunkAmount
+	{
+		std::max<size_t>(1, std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), size / minChunkSize))
+	};
+
+	std::vector<const char*> chunkBounds{ pData };
+	for (size_t i{ 1 }; i < chunkAmount; ++i)
+	{
+		const char* pSplit{ std::max(pData + size * i / chunkAmount, chunkBounds.back()) };
+		const char* pLineEnd{ static_cast<const char*>(memchr(pSplit, '\n', static_cast<size_t>(pData + size - pSplit))) };
+		chunkBounds.push_back(pLineEnd ? pLineEnd + 1 : pData + size);
+	}
+	chunkBounds.push_back(pData + size);
+
+	std::vector<OBJChunk> chunks(chunkAmount);
+	std::vector<std::thread> threads{};
+	for (size_t i{ 1 }; i < chunkAmount; ++i)
+	{
+		threads.emplace_back(ParseChunk, chunkBounds[i], chunkBounds[i + 1], std::ref(chunks[i]));
+	}
+	ParseChunk(chunkBounds[0], chunkBounds[1], chunks[0]);
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+
+	// Merge in file order, relative indices get the amount of elements in the chunks before theirs
+	std::vector<FPoint3> positions;
+	std::vector<FVector3> normals;
+	std::vector<FVector2> UVs;
+	size_t cornerAmount{ 0 };
+	for (const OBJChunk& chunk : chunks)
+	{
+		cornerAmount += chunk.corners.size();
+	}
+
+	OBJCornerTable cornerVertices{ cornerAmount };
+	indices.reserve(cornerAmount);
+
+	for (OBJChunk& chunk : chunks)
+	{
+		const size_t positionOffset{ positions.size() };
+		const size_t UVOffset{ UVs.size() };
+		const size_t normalOffset{ normals.size() };
+		positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+		UVs.insert(UVs.end(), chunk.UVs.begin(), chunk.UVs.end());
+		normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+
+		for (const OBJCorner& corner : chunk.corners)
+		{
+			const OBJCornerKey key
+			{
+				ResolveIndex(corner.position, corner.relativeMask & 1, positionOffset),
+				ResolveIndex(corner.texCoord, corner.relativeMask & 2, UVOffset),
+				ResolveIndex(corner.normal, corner.relativeMask & 4, normalOffset)
+			};
+
+			if (key.position < 1 || key.position > static_cast<int64_t>(positions.size()) ||
+				key.texCoord < 0 || key.texCoord > static_cast<int64_t>(UVs.size()) ||
+				key.normal < 0 || key.normal > static_cast<int64_t>(normals.size()))
+			{
+				return false;
+			}
+
+			// Weld corners that reference the same attributes, so tangents accumulate over every face using the vertex
+			bool isAdded{};
+			const uint32_t vertexIndex{ cornerVertices.FindOrAdd(key, uint32_t(vertices.size()), isAdded) };
+			if (isAdded)
+			{
+				IVertex vertex{};
+				vertex.pos = positions[key.position - 1];
+				if (key.texCoord > 0)
+				{
+					vertex.uv.x = UVs[key.texCoord - 1].x;
+					vertex.uv.y = UVs[key.texCoord - 1].y;
+				}
+				if (key.normal > 0)
+				{
+					vertex.normal = normals[key.normal - 1];
+				}
+				vertices.push_back(vertex);
+			}
+			indices.push_back(vertexIndex);
+		}
+		chunk = OBJChunk{};
+	}
+
+	CalcTangents(vertices, indices);
+	return true;
+}
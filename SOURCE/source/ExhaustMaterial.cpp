@@ -2,21 +2,18 @@
 #include "ExhaustMaterial.h"
 #include "Texture.h"
 
-ExhaustMaterial::ExhaustMaterial(ID3D11Device* pDevice, const std::wstring& path, Texture* pDiffuseTexture)
+ExhaustMaterial::ExhaustMaterial(ID3D11Device* pDevice, const std::wstring& path, std::shared_ptr<Texture> pDiffuseTexture)
 	: Material(pDevice, path)
 	, m_pDiffuseMapVariable(nullptr)
-	, m_pDiffuse(pDiffuseTexture)
+	, m_pDiffuse(std::move(pDiffuseTexture))
 {
 }
 
-ExhaustMaterial::~ExhaustMaterial()
-{
-	delete m_pDiffuse;
-}
+ExhaustMaterial::~ExhaustMaterial() = default;
 
 void ExhaustMaterial::Update(Mesh* mesh)
 {
 	Material::Update(mesh);
 
-	SetEffectShaderResource("gDiffuseMap", m_pDiffuseMapVariable, m_pDiffuse);
+	SetEffectShaderResource("gDiffuseMap", m_pDiffuseMapVariable, m_pDiffuse.get());
 }
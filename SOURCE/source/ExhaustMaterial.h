@@ -1,9 +1,10 @@
 #pragma once
 #include "Material.h"
+#include <memory>
 class ExhaustMaterial final : public Material
 {
 public:
-	ExhaustMaterial(ID3D11Device* pDevice, const std::wstring& path, Texture* pDiffuseTexture);
+	ExhaustMaterial(ID3D11Device* pDevice, const std::wstring& path, std::shared_ptr<Texture> pDiffuseTexture);
 	ExhaustMaterial(ExhaustMaterial& other) = delete;
 	ExhaustMaterial(ExhaustMaterial&& other) = delete;
 	ExhaustMaterial operator=(ExhaustMaterial& other) = delete;
@@ -14,6 +15,6 @@ public:
 
 private:
 	ID3DX11EffectShaderResourceVariable* m_pDiffuseMapVariable;
-	Texture* m_pDiffuse;
+	std::shared_ptr<Texture> m_pDiffuse;
 };
 
@@ -0,0 +1,65 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "EMath.h"
+
+// Surface attributes of the visible opaque pixels for deferred shading, 10 bytes per pixel next to the depth buffer.
+// The pixel stages write them and the tiled lighting pass lights them afterwards
+struct GBuffer
+{
+	// World space normal folded onto an octahedron, two 16 bit signed normalized coordinates
+	std::vector<uint32_t> normals;
+	// Diffuse color as RGBA8, alpha 0 marks a pixel whose color is already final and gets no lighting
+	std::vector<uint32_t> albedo;
+	// Specular in the low byte, glossiness in the high byte
+	std::vector<uint16_t> specularGlossiness;
+
+	void Resize(size_t pixelCount);
+
+	static uint32_t EncodeNormal(float x, float y, float z);
+	static Elite::FVector3 DecodeNormal(uint32_t encoded);
+};
+
+inline void GBuffer::Resize(size_t pixelCount)
+{
+	normals.resize(pixelCount);
+	albedo.resize(pixelCount);
+	specularGlossiness.resize(pixelCount);
+}
+
+inline uint32_t GBuffer::EncodeNormal(float x, float y, float z)
+{
+	// The upper half projects straight down onto the octahedron, the lower half is folded over its diagonals
+	const float length{ std::abs(x) + std::abs(y) + std::abs(z) };
+	if (!(length > 0.f))
+		return 0;
+	float u{ x / length };
+	float v{ y / length };
+	if (z < 0.f)
+	{
+		const float foldedU{ (1.f - std::abs(v)) * (u >= 0.f ? 1.f : -1.f) };
+		v = (1.f - std::abs(u)) * (v >= 0.f ? 1.f : -1.f);
+		u = foldedU;
+	}
+	const auto quantize{ [](float value) { return static_cast<uint32_t>(static_cast<uint16_t>(static_cast<int16_t>(std::lround(value * 32767.f)))); } };
+	return quantize(u) | quantize(v) << 16;
+}
+
+inline Elite::FVector3 GBuffer::DecodeNormal(uint32_t encoded)
+{
+	float u{ static_cast<float>(static_cast<int16_t>(encoded & 0xFFFF)) / 32767.f };
+	float v{ static_cast<float>(static_cast<int16_t>(encoded >> 16)) / 32767.f };
+	const float z{ 1.f - std::abs(u) - std::abs(v) };
+	if (z < 0.f)
+	{
+		const float unfoldedU{ (1.f - std::abs(v)) * (u >= 0.f ? 1.f : -1.f) };
+		v = (1.f - std::abs(u)) * (v >= 0.f ? 1.f : -1.f);
+		u = unfoldedU;
+	}
+	Elite::FVector3 normal{ u, v, z };
+	Elite::Normalize(normal);
+	return normal;
+}
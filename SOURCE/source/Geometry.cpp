@@ -1,5 +1,7 @@
 #include "pch.h"
 #include "Geometry.h"
+#include "SceneBVH.h"
+#include "SoftwareMaterial.h"
 
 #include <utility>
 
@@ -36,18 +38,102 @@ const FMatrix4& Geometry::GetTransform() const
 	return m_Transform;
 }
 
+const AABB& Geometry::GetWorldAABB() const
+{
+	return m_WorldAABB;
+}
+const BoundingSphere& Geometry::GetWorldBoundingSphere() const
+{
+	return m_WorldBoundingSphere;
+}
 
-void Geometry::CalcTransform()
+bool Geometry::IsVisible(const Frustum& frustum) const
+{
+	if (!IsValid(m_WorldAABB))
+	{
+		return true;
+	}
+	return IsInsideFrustum(frustum, m_WorldBoundingSphere) && IsInsideFrustum(frustum, m_WorldAABB);
+}
+
+const SoftwareMaterial* Geometry::GetMaterial() const
+{
+	return m_pMaterial.get();
+}
+void Geometry::SetMaterial(std::shared_ptr<const SoftwareMaterial> pMaterial)
+{
+	m_pMaterial = std::move(pMaterial);
+}
+
+void Geometry::SetIsActive(bool active)
+{
+	m_IsActive = active;
+}
+bool Geometry::GetIsActive() const
+{
+	return m_IsActive;
+}
+
+uint32_t Geometry::GetInstanceCount() const
+{
+	return 1;
+}
+FMatrix4 Geometry::GetInstanceTransform(uint32_t) const
+{
+	return m_Transform;
+}
+bool Geometry::IsInstanceVisible(uint32_t, const Frustum&) const
+{
+	return true;
+}
+
+void Geometry::RasterizeDepth(uint32_t, DepthTarget&, ProjectedGeometry&, RasterizerState&) const
+{
+}
+
+bool Geometry::Raycast(const Ray& ray, float& distance) const
+{
+	return IsValid(m_WorldAABB) && IntersectRay(m_WorldAABB, ray, FLT_MAX, distance);
+}
+
+FMatrix4 Geometry::MakeTransform(const FPoint3& position, const FVector3& forward)
 {
 	const FVector3 worldup{ 0,1,0 };
 
-	const FVector3 right{ Cross(worldup, m_Forward) };
-	const FVector3 up{ Cross(m_Forward, right) };
+	const FVector3 right{ Cross(worldup, forward) };
+	const FVector3 up{ Cross(forward, right) };
+
+	FMatrix4 transform{};
+	transform[0] = FVector4{ right, 0 };
+	transform[1] = FVector4{ up, 0 };
+	transform[2] = FVector4{ forward, 0 };
+	transform[3] = FVector4{ position.x, position.y, position.z, 1.f };
+	return transform;
+}
+
+void Geometry::SetLocalBounds(const AABB& box, const BoundingSphere& sphere)
+{
+	m_LocalAABB = box;
+	m_LocalBoundingSphere = sphere;
+	CalcWorldBounds();
+}
 
-	m_Transform[0] = FVector4{ right, 0 };
-	m_Transform[1] = FVector4{ up, 0 };
-	m_Transform[2] = FVector4{ m_Forward, 0 };
-	m_Transform[3] = FVector4{ m_Pos.x, m_Pos.y, m_Pos.z, 1.f };
 
+void Geometry::CalcTransform()
+{
+	m_Transform = MakeTransform(m_Pos, m_Forward);
+
+	CalcWorldBounds();
 	OnRecalculateTransform();
 }
+
+void Geometry::CalcWorldBounds()
+{
+	m_WorldAABB = TransformAABB(m_Transform, m_LocalAABB);
+	m_WorldBoundingSphere = TransformBoundingSphere(m_Transform, m_LocalBoundingSphere);
+
+	if (m_pBVH)
+	{
+		m_pBVH->Refit(m_BVHProxy);
+	}
+}
@@ -1,11 +1,17 @@
 #pragma once
 #include "EMath.h"
+#include <memory>
 #include <vector>
 
 #include "Structs.h"
+#include "Bounds.h"
 
 using namespace Elite;
 
+class SceneBVH;
+class SoftwareMaterial;
+struct DepthTarget;
+
 class Geometry
 {
 public:
@@ -20,18 +26,72 @@ public:
 
 	const FMatrix4& GetTransform() const;
 
+	const AABB& GetWorldAABB() const;
+	const BoundingSphere& GetWorldBoundingSphere() const;
+	bool IsVisible(const Frustum& frustum) const;
+
+	// A plain geometry is a single instance drawn with its own transform
+	virtual uint32_t GetInstanceCount() const;
+	virtual FMatrix4 GetInstanceTransform(uint32_t instance) const;
+	// Only asked for geometry that already passed IsVisible
+	virtual bool IsInstanceVisible(uint32_t instance, const Frustum& frustum) const;
+
+	// Shading on the software renderer, geometry without a material gets the default one of the renderer
+	const SoftwareMaterial* GetMaterial() const;
+	void SetMaterial(std::shared_ptr<const SoftwareMaterial> pMaterial);
+
+	// Inactive geometry stays in the scene but is not drawn, casts no shadow and cannot be picked
+	void SetIsActive(bool active);
+	bool GetIsActive() const;
+
+	// Distance along the ray to the closest hit, the default only tests the world bounds
+	virtual bool Raycast(const Ray& ray, float& distance) const;
+
 	virtual std::vector<Vertex> GetModelVerts() const = 0;
 
-	virtual void Project(std::vector<Vertex>& vertices) const = 0;
-	virtual bool Rasterize(std::vector<Vertex>& vertices, std::vector<float>& depthBuffer, std::vector<Vertex>& outVertices) const = 0;
+	// Project runs first for a draw and may pick per instance state, like the level of detail, that the later stages then read
+	// back from projected alone. projected.lod holds the level the instance had in the previous frame and gets the new one, the
+	// caller keeps it between frames so the geometry itself stays unchanged while it is drawn. It culls and leaves the vertex
+	// and triangle ranges of what is left, the stages after it work on parts of those and may run on different threads at once
+	virtual void Project(uint32_t instance, ProjectedGeometry& projected, RasterizerState& state) const = 0;
+	// Vertex stage for projected.vertexRanges [firstRange, endRange)
+	virtual void ShadeVertices(uint32_t instance, ProjectedGeometry& projected, size_t firstRange, size_t endRange) const = 0;
+	// Adds the triangles of projected.triangleRanges [firstRange, endRange) that can cover a pixel to the bins, as triangles of draw
+	virtual void BinTriangles(const ProjectedGeometry& projected, size_t firstRange, size_t endRange, uint32_t draw, const RasterizerState& state,
+		TileBins& bins) const = 0;
+	// Rasterizes binned triangles of this draw in order, only testing and writing the pixels of the tile
+	virtual bool Rasterize(const ProjectedGeometry& projected, const BinnedTriangle* pFirst, const BinnedTriangle* pLast, const ScreenTile& tile,
+		std::vector<float>& depthBuffer, std::vector<Vertex>& outVertices, RasterizerState& state) const = 0;
+	// Depth only into the target, seen through its own view projection instead of the camera. No vertex stage, no attributes
+	// and no fragments, projected is only scratch space. Geometry that does not implement it casts no shadow
+	virtual void RasterizeDepth(uint32_t instance, DepthTarget& target, ProjectedGeometry& projected, RasterizerState& state) const;
+
+	static FMatrix4 MakeTransform(const FPoint3& position, const FVector3& forward);
 
 protected:
 	virtual void OnRecalculateTransform(){};
 	void CalcTransform();
 
+	void SetLocalBounds(const AABB& box, const BoundingSphere& sphere);
+
 private:
+	friend class SceneBVH;
+
 	FPoint3 m_Pos;
 	FVector3 m_Forward;
 	FMatrix4 m_Transform;
+
+	AABB m_LocalAABB;
+	BoundingSphere m_LocalBoundingSphere;
+	AABB m_WorldAABB;
+	BoundingSphere m_WorldBoundingSphere;
+
+	std::shared_ptr<const SoftwareMaterial> m_pMaterial;
+	bool m_IsActive{ true };
+
+	SceneBVH* m_pBVH{ nullptr };
+	uint32_t m_BVHProxy{};
+
+	void CalcWorldBounds();
 };
 
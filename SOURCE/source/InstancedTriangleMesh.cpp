@@ -0,0 +1,76 @@
+#include "pch.h"
+#include "InstancedTriangleMesh.h"
+
+#include <utility>
+
+InstancedTriangleMesh::InstancedTriangleMesh(std::shared_ptr<const TriangleMeshData> pData, const FPoint3& position)
+	: TriangleMesh(position, std::move(pData))
+{
+	UpdateInstanceBounds();
+}
+
+uint32_t InstancedTriangleMesh::AddInstance(const FPoint3& position, const FVector3& forward)
+{
+	m_InstanceTransforms.push_back(MakeTransform(position, forward));
+	GrowInstanceBounds(m_InstanceTransforms.back());
+	UpdateInstanceBounds();
+	return static_cast<uint32_t>(m_InstanceTransforms.size()) - 1;
+}
+void InstancedTriangleMesh::SetInstance(uint32_t instance, const FPoint3& position, const FVector3& forward)
+{
+	m_InstanceTransforms[instance] = MakeTransform(position, forward);
+
+	// Moving an instance can shrink the bounds, so they are rebuilt from scratch
+	m_InstancesAABB = AABB{};
+	for (const FMatrix4& instanceTransform : m_InstanceTransforms)
+	{
+		GrowInstanceBounds(instanceTransform);
+	}
+	UpdateInstanceBounds();
+}
+void InstancedTriangleMesh::ClearInstances()
+{
+	m_InstanceTransforms.clear();
+	m_InstancesAABB = AABB{};
+	UpdateInstanceBounds();
+}
+
+uint32_t InstancedTriangleMesh::GetInstanceCount() const
+{
+	return static_cast<uint32_t>(m_InstanceTransforms.size());
+}
+FMatrix4 InstancedTriangleMesh::GetInstanceTransform(uint32_t instance) const
+{
+	return GetTransform() * m_InstanceTransforms[instance];
+}
+bool InstancedTriangleMesh::IsInstanceVisible(uint32_t instance, const Frustum& frustum) const
+{
+	const TriangleMeshData& data{ *GetData() };
+	if (!IsValid(data.localAABB))
+	{
+		return true;
+	}
+
+	const FMatrix4 transform{ GetInstanceTransform(instance) };
+	return IsInsideFrustum(frustum, TransformBoundingSphere(transform, data.localBoundingSphere)) &&
+		IsInsideFrustum(frustum, TransformAABB(transform, data.localAABB));
+}
+
+void InstancedTriangleMesh::GrowInstanceBounds(const FMatrix4& instanceTransform)
+{
+	const AABB instanceAABB{ TransformAABB(instanceTransform, GetData()->localAABB) };
+	if (IsValid(instanceAABB))
+	{
+		Grow(m_InstancesAABB, instanceAABB);
+	}
+}
+void InstancedTriangleMesh::UpdateInstanceBounds()
+{
+	// The geometry bounds enclose all instances so a group that is entirely off screen is culled with one test
+	if (!IsValid(m_InstancesAABB))
+	{
+		SetLocalBounds(m_InstancesAABB, BoundingSphere{});
+		return;
+	}
+	SetLocalBounds(m_InstancesAABB, BoundingSphere{ GetCenter(m_InstancesAABB), Magnitude(GetExtent(m_InstancesAABB)) });
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include "TriangleMesh.h"
+
+// Draws one shared mesh once per instance, an instance only adds its transform
+class InstancedTriangleMesh final : public TriangleMesh
+{
+public:
+	explicit InstancedTriangleMesh(std::shared_ptr<const TriangleMeshData> pData, const FPoint3& position = FPoint3{ 0,0,0 });
+	~InstancedTriangleMesh() override = default;
+
+	uint32_t AddInstance(const FPoint3& position, const FVector3& forward = FVector3{ 0,0,1 });
+	void SetInstance(uint32_t instance, const FPoint3& position, const FVector3& forward = FVector3{ 0,0,1 });
+	void ClearInstances();
+
+	uint32_t GetInstanceCount() const override;
+	FMatrix4 GetInstanceTransform(uint32_t instance) const override;
+	bool IsInstanceVisible(uint32_t instance, const Frustum& frustum) const override;
+
+private:
+	// Relative to the transform of the geometry itself
+	std::vector<FMatrix4> m_InstanceTransforms;
+	AABB m_InstancesAABB;
+
+	void GrowInstanceBounds(const FMatrix4& instanceTransform);
+	void UpdateInstanceBounds();
+};
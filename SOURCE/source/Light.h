@@ -0,0 +1,27 @@
+#pragma once
+#include <cstdint>
+
+#include "EMath.h"
+#include "ERGBColor.h"
+
+enum class LightType : uint8_t
+{
+	Point,
+	Spot
+};
+
+// A local light of the scene, lit by the deferred software renderer. Its light falls off with the inverse square of the
+// distance and is smoothly windowed to nothing at the range, so every light only reaches the pixels within its sphere
+struct Light
+{
+	LightType type{ LightType::Point };
+	Elite::FPoint3 position{};
+	// Where a spot light points, normalized
+	Elite::FVector3 direction{ 0.f, -1.f, 0.f };
+	Elite::RGBColor color{ 1.f, 1.f, 1.f };
+	float intensity{ 1.f };
+	float range{ 10.f };
+	// Cosines of the half angles of a spot light, full light inside the inner cone and none outside the outer one
+	float cosInnerCone{ .9f };
+	float cosOuterCone{ .8f };
+};
@@ -0,0 +1,114 @@
+#include "pch.h"
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+MappedFile::MappedFile(const std::string& filename)
+{
+	m_FileHandle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (m_FileHandle == INVALID_HANDLE_VALUE)
+	{
+		m_FileHandle = nullptr;
+		return;
+	}
+
+	LARGE_INTEGER size{};
+	if (!GetFileSizeEx(m_FileHandle, &size))
+	{
+		return;
+	}
+	m_Size = static_cast<size_t>(size.QuadPart);
+
+	// An empty file can not be mapped, but is still a valid file
+	if (m_Size == 0)
+	{
+		m_IsOpen = true;
+		return;
+	}
+
+	m_MappingHandle = CreateFileMappingA(m_FileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!m_MappingHandle)
+	{
+		return;
+	}
+	m_pData = static_cast<const char*>(MapViewOfFile(m_MappingHandle, FILE_MAP_READ, 0, 0, 0));
+	m_IsOpen = m_pData != nullptr;
+}
+
+MappedFile::~MappedFile()
+{
+	if (m_pData)
+	{
+		UnmapViewOfFile(m_pData);
+	}
+	if (m_MappingHandle)
+	{
+		CloseHandle(m_MappingHandle);
+	}
+	if (m_FileHandle)
+	{
+		CloseHandle(m_FileHandle);
+	}
+}
+#else
+MappedFile::MappedFile(const std::string& filename)
+{
+	const int file{ open(filename.c_str(), O_RDONLY) };
+	if (file < 0)
+	{
+		return;
+	}
+
+	struct stat status{};
+	if (fstat(file, &status) == 0)
+	{
+		m_Size = static_cast<size_t>(status.st_size);
+		if (m_Size == 0)
+		{
+			m_IsOpen = true;
+		}
+		else
+		{
+			void* pData{ mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, file, 0) };
+			if (pData != MAP_FAILED)
+			{
+				m_pData = static_cast<const char*>(pData);
+				m_IsOpen = true;
+			}
+		}
+	}
+	close(file);
+}
+
+MappedFile::~MappedFile()
+{
+	if (m_pData)
+	{
+		munmap(const_cast<char*>(m_pData), m_Size);
+	}
+}
+#endif
+
+bool MappedFile::IsOpen() const
+{
+	return m_IsOpen;
+}
+
+const char* MappedFile::GetData() const
+{
+	return m_pData;
+}
+
+size_t MappedFile::GetSize() const
+{
+	return m_Size;
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <string>
+
+// Read only view of a whole file mapped into memory, valid for the lifetime of the object
+class MappedFile final
+{
+public:
+	explicit MappedFile(const std::string& filename);
+	MappedFile(const MappedFile& other) = delete;
+	MappedFile(MappedFile&& other) = delete;
+	MappedFile& operator=(const MappedFile& other) = delete;
+	MappedFile& operator=(MappedFile&& other) = delete;
+	~MappedFile();
+
+	bool IsOpen() const;
+	const char* GetData() const;
+	size_t GetSize() const;
+
+private:
+	bool m_IsOpen{ false };
+	const char* m_pData{ nullptr };
+	size_t m_Size{};
+
+#ifdef _WIN32
+	void* m_FileHandle{ nullptr };
+	void* m_MappingHandle{ nullptr };
+#endif
+};
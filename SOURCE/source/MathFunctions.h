@@ -76,50 +76,8 @@ inline bool InRange(Type value, Type minRange, Type maxRange)
 	return value >= minRange && value <= maxRange;
 }
 
-inline void TransformVertexPos(const Elite::FMatrix4& transform, std::vector<Vertex>& verticesToTransform)
-{
-	for (Vertex& vertex : verticesToTransform)
-	{
-		vertex.pos = transform * vertex.pos;
-	}
-}
-
-inline void TransformVertexNormals(const Elite::FMatrix3& transform, std::vector<Vertex>& verticesToTransform)
-{
-	for (Vertex& vertex : verticesToTransform)
-	{
-		vertex.normal = transform * vertex.normal;
-	}
-}
-
-inline void TransformVertexTangents(const Elite::FMatrix3& transform, std::vector<Vertex>& verticesToTransform)
-{
-	for (Vertex& vertex : verticesToTransform)
-	{
-		vertex.tangent = transform * vertex.tangent;
-	}
-}
-
-inline void PerspectiveDivide(std::vector<Vertex>& vertices)
-{
-	for (Vertex& vertex : vertices)
-	{
-		vertex.pos.x /= vertex.pos.w;
-		vertex.pos.y /= vertex.pos.w;
-		vertex.pos.z /= vertex.pos.w;
-	}
-}
-
-inline void VertsToSS(const int width, const int height, std::vector<Vertex>& vertices)
-{
-	for (Vertex& vertex : vertices)
-	{
-		vertex.pos.xy = Elite::FPoint2{ CalcSSX(vertex.pos.x, width), CalcSSY(vertex.pos.y, height) };
-	}
-
-}
-
-inline std::tuple<Elite::FPoint2, Elite::FPoint2> GetBoundingBox(float width, float height, const std::vector<Vertex>& vertices)
+template<typename VertexContainer>
+inline std::tuple<Elite::FPoint2, Elite::FPoint2> GetBoundingBox(float width, float height, const VertexContainer& vertices)
 {
 	if (vertices.empty())
 	{
@@ -143,3 +101,21 @@ inline std::tuple<Elite::FPoint2, Elite::FPoint2> GetBoundingBox(float width, fl
 
 	return std::make_tuple(topLeft, bottomRight);
 }
+
+
+inline uint32_t SpreadBits3D(uint32_t value)
+{
+	value &= 0x3ff;
+	value = (value | (value << 16)) & 0x030000ff;
+	value = (value | (value << 8)) & 0x0300f00f;
+	value = (value | (value << 4)) & 0x030c30c3;
+	value = (value | (value << 2)) & 0x09249249;
+	return value;
+}
+
+// Expects coordinates normalized to [0, 1]
+inline uint32_t MortonCode3D(float x, float y, float z)
+{
+	const auto quantize = [](float value) { return static_cast<uint32_t>(Elite::Clamp(value, 0.f, 1.f) * 1023.f); };
+	return SpreadBits3D(quantize(x)) | (SpreadBits3D(quantize(y)) << 1) | (SpreadBits3D(quantize(z)) << 2);
+}
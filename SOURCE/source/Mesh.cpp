@@ -4,6 +4,11 @@
 
 Mesh::Mesh(ID3D11Device* pDevice, const std::vector<IVertex>& verts, const std::vector<unsigned int>& indices, Material* pMaterial,
 	const Elite::FPoint3& position, const Elite::FVector3& forward)
+	: Mesh(pDevice, MeshView{ verts.data(), verts.size(), indices.data(), indices.size() }, pMaterial, position, forward)
+{
+}
+
+Mesh::Mesh(ID3D11Device* pDevice, const MeshView& mesh, Material* pMaterial, const Elite::FPoint3& position, const Elite::FVector3& forward)
 	: m_pMaterial(pMaterial)
 	, m_Pos(position)
 	, m_Forward(forward)
@@ -36,13 +41,13 @@ Mesh::Mesh(ID3D11Device* pDevice, const std::vector<IVertex>& verts, const std::
 	
 	D3D11_BUFFER_DESC buffDesc{};
 	buffDesc.Usage = D3D11_USAGE_IMMUTABLE;
-	buffDesc.ByteWidth = sizeof(IVertex) * static_cast<uint32_t>(verts.size());
+	buffDesc.ByteWidth = sizeof(IVertex) * static_cast<uint32_t>(mesh.vertexCount);
 	buffDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
 	buffDesc.CPUAccessFlags = 0;
 	buffDesc.MiscFlags = 0;
 
 	D3D11_SUBRESOURCE_DATA subData{nullptr};
-	subData.pSysMem = verts.data();
+	subData.pSysMem = mesh.pVertices;
 
 	result = pDevice->CreateBuffer(&buffDesc, &subData, &m_pVertexBuffer);
 	if (FAILED(result))
@@ -58,13 +63,13 @@ Mesh::Mesh(ID3D11Device* pDevice, const std::vector<IVertex>& verts, const std::
 		return;
 	}
 	
-	m_IndicesAmt = static_cast<uint32_t>(indices.size());
+	m_IndicesAmt = static_cast<uint32_t>(mesh.indexCount);
 	buffDesc.Usage = D3D11_USAGE_IMMUTABLE;
 	buffDesc.ByteWidth = sizeof(uint32_t) * m_IndicesAmt;
 	buffDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
 	buffDesc.CPUAccessFlags = 0;
 	buffDesc.MiscFlags = 0;
-	subData.pSysMem = indices.data();
+	subData.pSysMem = mesh.pIndices;
 	result = pDevice->CreateBuffer(&buffDesc, &subData, &m_pIndexBuffer);
 	if (FAILED(result))
 	{
@@ -9,6 +9,9 @@ class Mesh final
 public:
 	Mesh(ID3D11Device* pDevice, const std::vector<IVertex>& verts, const std::vector<uint32_t>& indices, Material* pMaterial, 
 		const Elite::FPoint3& position = {0,0,0}, const Elite::FVector3& forward = {0,0,1});
+	// Uploads straight from where the mesh is, like a mapped mesh cache
+	Mesh(ID3D11Device* pDevice, const MeshView& mesh, Material* pMaterial,
+		const Elite::FPoint3& position = {0,0,0}, const Elite::FVector3& forward = {0,0,1});
 	Mesh(Mesh& other) = delete;
 	Mesh(Mesh&& other) = delete;
 	Mesh operator=(Mesh& other) = delete;
@@ -0,0 +1,188 @@
+#include "pch.h"
+#include "MeshCache.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+MeshCacheFile::MeshCacheFile(const std::string& sourceFilename)
+	: m_File(GetCacheFilename(sourceFilename))
+{
+	if (!m_File.IsOpen() || m_File.GetSize() < sizeof(MeshCacheHeader))
+	{
+		return;
+	}
+
+	const auto pHeader{ reinterpret_cast<const MeshCacheHeader*>(m_File.GetData()) };
+	if (memcmp(pHeader->magic, "SRMC", 4) != 0 || pHeader->version != m_Version || pHeader->vertexSize != sizeof(IVertex))
+	{
+		return;
+	}
+
+	uint64_t sourceSize{};
+	int64_t sourceTime{};
+	if (!GetSourceStamp(sourceFilename, sourceSize, sourceTime) || sourceSize != pHeader->sourceSize)
+	{
+		return;
+	}
+
+	// Only a different write time costs a pass over the source, a copied or touched file keeps its cache
+	if (sourceTime != pHeader->sourceTime)
+	{
+		const MappedFile source{ sourceFilename };
+		if (!source.IsOpen() || CalcContentHash(source.GetData(), source.GetSize()) != pHeader->sourceHash)
+		{
+			return;
+		}
+		m_IsTimeOutdated = true;
+	}
+
+	// Last, since it reads every index
+	if (!IsInRange(*pHeader))
+	{
+		return;
+	}
+	m_pHeader = pHeader;
+}
+
+bool MeshCacheFile::IsValid() const
+{
+	return m_pHeader != nullptr;
+}
+
+bool MeshCacheFile::IsTimeOutdated() const
+{
+	return m_IsTimeOutdated;
+}
+
+MeshView MeshCacheFile::GetView() const
+{
+	return MeshView{ reinterpret_cast<const IVertex*>(m_File.GetData() + m_pHeader->vertexOffset), static_cast<size_t>(m_pHeader->vertexCount),
+		reinterpret_cast<const uint32_t*>(m_File.GetData() + m_pHeader->indexOffset), static_cast<size_t>(m_pHeader->indexCount) };
+}
+
+const AABB& MeshCacheFile::GetBounds() const
+{
+	return m_pHeader->bounds;
+}
+
+float MeshCacheFile::GetAcmrBefore() const
+{
+	return m_pHeader->acmrBefore;
+}
+
+float MeshCacheFile::GetAcmrAfter() const
+{
+	return m_pHeader->acmrAfter;
+}
+
+bool MeshCacheFile::Write(const std::string& sourceFilename, const MeshView& mesh, const AABB& bounds, float acmrBefore, float acmrAfter)
+{
+	MeshCacheHeader header{};
+	memcpy(header.magic, "SRMC", 4);
+	header.version = m_Version;
+	header.vertexSize = sizeof(IVertex);
+	if (!GetSourceStamp(sourceFilename, header.sourceSize, header.sourceTime))
+	{
+		return false;
+	}
+	{
+		const MappedFile source{ sourceFilename };
+		if (!source.IsOpen())
+		{
+			return false;
+		}
+		header.sourceHash = CalcContentHash(source.GetData(), source.GetSize());
+	}
+
+	header.vertexCount = mesh.vertexCount;
+	header.indexCount = mesh.indexCount;
+	header.vertexOffset = sizeof(MeshCacheHeader);
+	header.indexOffset = header.vertexOffset + mesh.vertexCount * sizeof(IVertex);
+	header.bounds = bounds;
+	header.acmrBefore = acmrBefore;
+	header.acmrAfter = acmrAfter;
+
+	// Written under a temporary name first, so a reader never maps a half written cache
+	const std::string cacheFilename{ GetCacheFilename(sourceFilename) };
+	const std::string temporaryFilename{ cacheFilename + ".tmp" };
+	{
+		std::ofstream file{ temporaryFilename, std::ios::binary | std::ios::trunc };
+		if (!file)
+		{
+			return false;
+		}
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(mesh.pVertices), static_cast<std::streamsize>(mesh.vertexCount * sizeof(IVertex)));
+		file.write(reinterpret_cast<const char*>(mesh.pIndices), static_cast<std::streamsize>(mesh.indexCount * sizeof(uint32_t)));
+		if (!file)
+		{
+			return false;
+		}
+	}
+
+	std::error_code error{};
+	std::filesystem::rename(temporaryFilename, cacheFilename, error);
+	return !error;
+}
+
+bool MeshCacheFile::IsInRange(const MeshCacheHeader& header) const
+{
+	// Counts are compared to what is left after the offset, so a corrupt count cannot wrap the size it would take
+	const uint64_t size{ m_File.GetSize() };
+	if (header.vertexOffset < sizeof(MeshCacheHeader) || header.vertexOffset > size || header.vertexOffset % alignof(IVertex) != 0 ||
+		header.indexOffset < sizeof(MeshCacheHeader) || header.indexOffset > size || header.indexOffset % alignof(uint32_t) != 0)
+	{
+		return false;
+	}
+	if (header.vertexCount > (size - header.vertexOffset) / sizeof(IVertex) || header.vertexCount > UINT32_MAX ||
+		header.indexCount > (size - header.indexOffset) / sizeof(uint32_t) || header.indexCount % 3 != 0)
+	{
+		return false;
+	}
+
+	const auto pIndices{ reinterpret_cast<const uint32_t*>(m_File.GetData() + header.indexOffset) };
+	const uint32_t vertexCount{ static_cast<uint32_t>(header.vertexCount) };
+	uint32_t maxIndex{ 0 };
+	for (uint64_t i{ 0 }; i < header.indexCount; ++i)
+	{
+		maxIndex = std::max(maxIndex, pIndices[i]);
+	}
+	return header.indexCount == 0 || maxIndex < vertexCount;
+}
+
+std::string MeshCacheFile::GetCacheFilename(const std::string& sourceFilename)
+{
+	return sourceFilename + ".meshcache";
+}
+
+uint64_t MeshCacheFile::CalcContentHash(const char* pData, size_t size)
+{
+	// FNV-1a over 8 byte words, the tail byte by byte
+	constexpr uint64_t prime{ 0x100000001b3ull };
+	uint64_t hash{ 0xcbf29ce484222325ull };
+	size_t i{ 0 };
+	for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+	{
+		uint64_t word{};
+		memcpy(&word, pData + i, sizeof(word));
+		hash = (hash ^ word) * prime;
+	}
+	for (; i < size; ++i)
+	{
+		hash = (hash ^ static_cast<uint8_t>(pData[i])) * prime;
+	}
+	return hash;
+}
+
+bool MeshCacheFile::GetSourceStamp(const std::string& sourceFilename, uint64_t& size, int64_t& time)
+{
+	std::error_code error{};
+	size = std::filesystem::file_size(sourceFilename, error);
+	if (error)
+	{
+		return false;
+	}
+	time = static_cast<int64_t>(std::filesystem::last_write_time(sourceFilename, error).time_since_epoch().count());
+	return !error;
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "Bounds.h"
+#include "MappedFile.h"
+
+// Binary copy of a loaded mesh, written next to its source file as <source>.meshcache.
+// It holds the mesh after vertex cache optimization, so a hit skips the parser and the optimizer. Vertices and indices are
+// stored exactly as they are in memory, so a mapped cache is used in place.
+struct MeshCacheHeader
+{
+	char magic[4];
+	uint32_t version;
+	// sizeof(IVertex) when written, a layout change invalidates every cache
+	uint32_t vertexSize;
+	uint32_t reserved;
+
+	// The cache belongs to the source with this size and write time, or else with this content hash
+	uint64_t sourceSize;
+	int64_t sourceTime;
+	uint64_t sourceHash;
+
+	uint64_t vertexCount;
+	uint64_t indexCount;
+	uint64_t vertexOffset;
+	uint64_t indexOffset;
+	AABB bounds;
+	// Average cache miss ratio of the parsed and of the optimized indices
+	float acmrBefore;
+	float acmrAfter;
+};
+
+class MeshCacheFile final
+{
+public:
+	// Maps the cache of sourceFilename, IsValid is false when there is none, it does not match the source anymore or any
+	// count, offset or index in it is out of range
+	explicit MeshCacheFile(const std::string& sourceFilename);
+
+	bool IsValid() const;
+	// The source changed write time but not content, Write again to make the next check cheap
+	bool IsTimeOutdated() const;
+
+	// Views into the mapping, valid for the lifetime of the object
+	MeshView GetView() const;
+	const AABB& GetBounds() const;
+	float GetAcmrBefore() const;
+	float GetAcmrAfter() const;
+
+	static bool Write(const std::string& sourceFilename, const MeshView& mesh, const AABB& bounds, float acmrBefore, float acmrAfter);
+
+private:
+	static constexpr uint32_t m_Version{ 3 };
+
+	const MappedFile m_File;
+	const MeshCacheHeader* m_pHeader{ nullptr };
+	bool m_IsTimeOutdated{ false };
+
+	// Every count fits the file after its offset, offsets are aligned and every index names a vertex
+	bool IsInRange(const MeshCacheHeader& header) const;
+
+	static std::string GetCacheFilename(const std::string& sourceFilename);
+	static uint64_t CalcContentHash(const char* pData, size_t size);
+	static bool GetSourceStamp(const std::string& sourceFilename, uint64_t& size, int64_t& time);
+};
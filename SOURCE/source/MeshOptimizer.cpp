@@ -0,0 +1,343 @@
+#include "pch.h"
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace
+{
+	// A vertex is in the FIFO cache when fewer than cacheSize vertices were added after it
+	uint32_t UpdateCache(const uint32_t* pTriangle, uint32_t cacheSize, std::vector<uint32_t>& timestamps, uint32_t& timestamp)
+	{
+		uint32_t misses{ 0 };
+		for (uint32_t corner{ 0 }; corner < 3; ++corner)
+		{
+			const uint32_t vertex{ pTriangle[corner] };
+			if (timestamp - timestamps[vertex] > cacheSize)
+			{
+				timestamps[vertex] = timestamp++;
+				++misses;
+			}
+		}
+		return misses;
+	}
+
+	// Triangles using each vertex, as offsets into one flat list
+	struct Adjacency
+	{
+		std::vector<uint32_t> offsets;
+		std::vector<uint32_t> triangles;
+	};
+
+	Adjacency BuildAdjacency(const std::vector<uint32_t>& indices, size_t vertexCount)
+	{
+		Adjacency adjacency{};
+		adjacency.offsets.assign(vertexCount + 1, 0);
+		for (const uint32_t index : indices)
+		{
+			++adjacency.offsets[index + 1];
+		}
+		std::partial_sum(adjacency.offsets.begin(), adjacency.offsets.end(), adjacency.offsets.begin());
+
+		std::vector<uint32_t> fill{ adjacency.offsets.begin(), adjacency.offsets.end() - 1 };
+		adjacency.triangles.resize(indices.size());
+		for (size_t i{ 0 }; i < indices.size(); ++i)
+		{
+			adjacency.triangles[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+		}
+		return adjacency;
+	}
+
+	// Triangles where none of the vertices is in the cache start a new, usually disjoint, patch
+	std::vector<uint32_t> FindHardBoundaries(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize)
+	{
+		std::vector<uint32_t> timestamps(vertexCount, 0);
+		uint32_t timestamp{ cacheSize + 1 };
+
+		std::vector<uint32_t> boundaries{};
+		const size_t triangleCount{ indices.size() / 3 };
+		for (size_t i{ 0 }; i < triangleCount; ++i)
+		{
+			const uint32_t misses{ UpdateCache(&indices[i * 3], cacheSize, timestamps, timestamp) };
+			if (i == 0 || misses == 3)
+			{
+				boundaries.push_back(static_cast<uint32_t>(i));
+			}
+		}
+		return boundaries;
+	}
+
+	// Cuts every hard patch further as soon as its running ACMR, with a cold cache, gets close to that of the whole patch
+	std::vector<uint32_t> FindSoftBoundaries(const std::vector<uint32_t>& indices, size_t vertexCount,
+		const std::vector<uint32_t>& hardBoundaries, uint32_t cacheSize, float threshold)
+	{
+		std::vector<uint32_t> timestamps(vertexCount, 0);
+		uint32_t timestamp{ 0 };
+		const uint32_t triangleCount{ static_cast<uint32_t>(indices.size() / 3) };
+
+		std::vector<uint32_t> boundaries{};
+		for (size_t patch{ 0 }; patch < hardBoundaries.size(); ++patch)
+		{
+			const uint32_t begin{ hardBoundaries[patch] };
+			const uint32_t end{ patch + 1 < hardBoundaries.size() ? hardBoundaries[patch + 1] : triangleCount };
+
+			timestamp += cacheSize + 1;
+			uint32_t patchMisses{ 0 };
+			for (uint32_t i{ begin }; i < end; ++i)
+			{
+				patchMisses += UpdateCache(&indices[i * 3], cacheSize, timestamps, timestamp);
+			}
+			const float targetACMR{ threshold * static_cast<float>(patchMisses) / static_cast<float>(end - begin) };
+
+			boundaries.push_back(begin);
+			timestamp += cacheSize + 1;
+			uint32_t runningMisses{ 0 };
+			uint32_t runningTriangles{ 0 };
+			for (uint32_t i{ begin }; i < end; ++i)
+			{
+				runningMisses += UpdateCache(&indices[i * 3], cacheSize, timestamps, timestamp);
+				++runningTriangles;
+				if (static_cast<float>(runningMisses) / static_cast<float>(runningTriangles) <= targetACMR)
+				{
+					boundaries.push_back(i + 1);
+					timestamp += cacheSize + 1;
+					runningMisses = 0;
+					runningTriangles = 0;
+				}
+			}
+
+			// The last cut can land on the end of the patch, which would leave an empty patch
+			if (boundaries.back() == end)
+			{
+				boundaries.pop_back();
+			}
+		}
+		return boundaries;
+	}
+}
+
+float CalcACMR(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize)
+{
+	const size_t triangleCount{ indices.size() / 3 };
+	if (triangleCount == 0)
+	{
+		return 0.f;
+	}
+
+	std::vector<uint32_t> timestamps(vertexCount, 0);
+	uint32_t timestamp{ cacheSize + 1 };
+	size_t misses{ 0 };
+	for (size_t i{ 0 }; i < triangleCount; ++i)
+	{
+		misses += UpdateCache(&indices[i * 3], cacheSize, timestamps, timestamp);
+	}
+	return static_cast<float>(misses) / static_cast<float>(triangleCount);
+}
+
+std::vector<uint32_t> OptimizeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize)
+{
+	const size_t triangleCount{ indices.size() / 3 };
+	std::vector<uint32_t> result{};
+	result.reserve(triangleCount * 3);
+	if (triangleCount == 0)
+	{
+		return result;
+	}
+
+	const Adjacency adjacency{ BuildAdjacency(indices, vertexCount) };
+	std::vector<uint32_t> liveTriangles(vertexCount);
+	for (size_t vertex{ 0 }; vertex < vertexCount; ++vertex)
+	{
+		liveTriangles[vertex] = adjacency.offsets[vertex + 1] - adjacency.offsets[vertex];
+	}
+
+	std::vector<uint32_t> timestamps(vertexCount, 0);
+	uint32_t timestamp{ cacheSize + 1 };
+	std::vector<bool> isEmitted(triangleCount, false);
+	std::vector<uint32_t> deadEnds{};
+	std::vector<uint32_t> candidates{};
+	uint32_t scanCursor{ 0 };
+
+	// Fan around the current vertex, then continue with the candidate that stays in the cache longest
+	// while it still has triangles left, or pick up a vertex the fan left behind when there is none
+	uint32_t fanVertex{ indices[0] };
+	while (fanVertex != UINT32_MAX)
+	{
+		candidates.clear();
+		for (uint32_t i{ adjacency.offsets[fanVertex] }; i < adjacency.offsets[fanVertex + 1]; ++i)
+		{
+			const uint32_t triangle{ adjacency.triangles[i] };
+			if (isEmitted[triangle])
+			{
+				continue;
+			}
+			isEmitted[triangle] = true;
+
+			for (uint32_t corner{ 0 }; corner < 3; ++corner)
+			{
+				const uint32_t vertex{ indices[triangle * 3 + corner] };
+				result.push_back(vertex);
+				deadEnds.push_back(vertex);
+				candidates.push_back(vertex);
+				--liveTriangles[vertex];
+				if (timestamp - timestamps[vertex] > cacheSize)
+				{
+					timestamps[vertex] = timestamp++;
+				}
+			}
+		}
+
+		uint32_t nextVertex{ UINT32_MAX };
+		int bestPriority{ -1 };
+		for (const uint32_t vertex : candidates)
+		{
+			if (liveTriangles[vertex] == 0)
+			{
+				continue;
+			}
+
+			// A fan of every live triangle adds up to two new vertices each, only worth it if this vertex stays cached
+			const uint32_t age{ timestamp - timestamps[vertex] };
+			const int priority{ age + 2 * liveTriangles[vertex] <= cacheSize ? static_cast<int>(age) : 0 };
+			if (priority > bestPriority)
+			{
+				bestPriority = priority;
+				nextVertex = vertex;
+			}
+		}
+
+		while (nextVertex == UINT32_MAX && !deadEnds.empty())
+		{
+			const uint32_t vertex{ deadEnds.back() };
+			deadEnds.pop_back();
+			if (liveTriangles[vertex] > 0)
+			{
+				nextVertex = vertex;
+			}
+		}
+		while (nextVertex == UINT32_MAX && scanCursor < vertexCount)
+		{
+			if (liveTriangles[scanCursor] > 0)
+			{
+				nextVertex = scanCursor;
+			}
+			++scanCursor;
+		}
+		fanVertex = nextVertex;
+	}
+	return result;
+}
+
+std::vector<uint32_t> OptimizeOverdraw(const std::vector<uint32_t>& indices, const std::vector<IVertex>& vertices, float threshold, uint32_t cacheSize)
+{
+	const size_t triangleCount{ indices.size() / 3 };
+	if (triangleCount == 0)
+	{
+		return indices;
+	}
+
+	const std::vector<uint32_t> hardBoundaries{ FindHardBoundaries(indices, vertices.size(), cacheSize) };
+	const std::vector<uint32_t> patches{ FindSoftBoundaries(indices, vertices.size(), hardBoundaries, cacheSize, threshold) };
+
+	Elite::FVector3 meshCenter{ 0.f, 0.f, 0.f };
+	float meshArea{ 0.f };
+	std::vector<Elite::FVector3> patchCenters(patches.size(), Elite::FVector3{ 0.f, 0.f, 0.f });
+	std::vector<Elite::FVector3> patchNormals(patches.size(), Elite::FVector3{ 0.f, 0.f, 0.f });
+	std::vector<float> patchAreas(patches.size(), 0.f);
+	for (size_t patch{ 0 }; patch < patches.size(); ++patch)
+	{
+		const uint32_t end{ patch + 1 < patches.size() ? patches[patch + 1] : static_cast<uint32_t>(triangleCount) };
+		for (uint32_t i{ patches[patch] }; i < end; ++i)
+		{
+			const Elite::FPoint3& p0{ vertices[indices[i * 3]].pos };
+			const Elite::FPoint3& p1{ vertices[indices[i * 3 + 1]].pos };
+			const Elite::FPoint3& p2{ vertices[indices[i * 3 + 2]].pos };
+
+			// Normal of the side the rasterizers keep, its length is twice the area
+			const Elite::FVector3 normal{ Elite::Cross(p1 - p0, p2 - p0) };
+			const float area{ Elite::Magnitude(normal) };
+			const Elite::FVector3 center{ (Elite::FVector3{ p0 } + Elite::FVector3{ p1 } + Elite::FVector3{ p2 }) / 3.f };
+
+			patchCenters[patch] += center * area;
+			patchNormals[patch] += normal;
+			patchAreas[patch] += area;
+		}
+
+		meshCenter += patchCenters[patch];
+		meshArea += patchAreas[patch];
+		if (patchAreas[patch] > 0.f)
+		{
+			patchCenters[patch] /= patchAreas[patch];
+		}
+	}
+	if (meshArea > 0.f)
+	{
+		meshCenter /= meshArea;
+	}
+
+	// Patches far out along their own normal are the most likely to occlude others
+	std::vector<float> occlusion(patches.size(), 0.f);
+	for (size_t patch{ 0 }; patch < patches.size(); ++patch)
+	{
+		const float normalLength{ Elite::Magnitude(patchNormals[patch]) };
+		if (normalLength > 0.f)
+		{
+			occlusion[patch] = Elite::Dot(patchCenters[patch] - meshCenter, patchNormals[patch] / normalLength);
+		}
+	}
+
+	std::vector<uint32_t> order(patches.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&occlusion](uint32_t a, uint32_t b)
+		{
+			return occlusion[a] > occlusion[b];
+		});
+
+	std::vector<uint32_t> result{};
+	result.reserve(indices.size());
+	for (const uint32_t patch : order)
+	{
+		const uint32_t end{ patch + 1 < patches.size() ? patches[patch + 1] : static_cast<uint32_t>(triangleCount) };
+		result.insert(result.end(), indices.begin() + patches[patch] * 3, indices.begin() + end * 3);
+	}
+	return result;
+}
+
+std::vector<uint32_t> RemapVertexFetch(std::vector<uint32_t>& indices, size_t vertexCount)
+{
+	std::vector<uint32_t> remap(vertexCount, UINT32_MAX);
+	uint32_t nextVertex{ 0 };
+	for (uint32_t& index : indices)
+	{
+		if (remap[index] == UINT32_MAX)
+		{
+			remap[index] = nextVertex++;
+		}
+		index = remap[index];
+	}
+	return remap;
+}
+
+void OptimizeVertexFetch(std::vector<IVertex>& vertices, std::vector<uint32_t>& indices)
+{
+	const std::vector<uint32_t> remap{ RemapVertexFetch(indices, vertices.size()) };
+
+	std::vector<IVertex> remappedVertices(vertices.size() - std::count(remap.begin(), remap.end(), UINT32_MAX));
+	for (size_t i{ 0 }; i < vertices.size(); ++i)
+	{
+		if (remap[i] != UINT32_MAX)
+		{
+			remappedVertices[remap[i]] = vertices[i];
+		}
+	}
+	vertices = std::move(remappedVertices);
+}
+
+void OptimizeMesh(std::vector<IVertex>& vertices, std::vector<uint32_t>& indices, float& acmrBefore, float& acmrAfter)
+{
+	acmrBefore = CalcACMR(indices, vertices.size());
+	indices = OptimizeVertexCache(indices, vertices.size());
+	indices = OptimizeOverdraw(indices, vertices);
+	OptimizeVertexFetch(vertices, indices);
+	acmrAfter = CalcACMR(indices, vertices.size());
+}
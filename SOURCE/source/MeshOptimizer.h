@@ -0,0 +1,26 @@
+#pragma once
+#include <vector>
+#include "Structs.h"
+
+// Load time reordering of index buffers (Sander, Nehab, Barczak: Fast Triangle Reordering, "Tipsify").
+// Works on plain indices so both TriangleMesh and the D3D11 Mesh can use it.
+
+constexpr uint32_t defaultVertexCacheSize{ 16 };
+
+// Average cache miss ratio, vertices transformed per triangle by a FIFO post transform cache. 3 is no reuse at all
+float CalcACMR(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize = defaultVertexCacheSize);
+
+// Reorders the triangles so consecutive triangles reuse the vertices still in the cache
+std::vector<uint32_t> OptimizeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize = defaultVertexCacheSize);
+
+// Splits cache optimized indices into patches and draws the patches facing outwards from the mesh center first, so they
+// tend to occlude the rest. A patch is closed once its ACMR is within threshold times the ACMR of the whole run it is in
+std::vector<uint32_t> OptimizeOverdraw(const std::vector<uint32_t>& indices, const std::vector<IVertex>& vertices,
+	float threshold = 1.05f, uint32_t cacheSize = defaultVertexCacheSize);
+
+// Renumbers the vertices in order of first use. Returns the new index of every old vertex, UINT32_MAX when unused
+std::vector<uint32_t> RemapVertexFetch(std::vector<uint32_t>& indices, size_t vertexCount);
+void OptimizeVertexFetch(std::vector<IVertex>& vertices, std::vector<uint32_t>& indices);
+
+// All of the above in order, acmrBefore and acmrAfter receive the ACMR of the input and the output
+void OptimizeMesh(std::vector<IVertex>& vertices, std::vector<uint32_t>& indices, float& acmrBefore, float& acmrAfter);
@@ -0,0 +1,368 @@
+#include "pch.h"
+#include "MeshSimplifier.h"
+
+#include <array>
+#include <cstring>
+#include <queue>
+#include <unordered_map>
+
+namespace
+{
+	// Symmetric 4x4 error quadric, only the upper triangle is stored
+	struct Quadric
+	{
+		double xx, xy, xz, xw, yy, yz, yw, zz, zw, ww;
+	};
+
+	Quadric MakePlaneQuadric(const Elite::FVector3& normal, double distance)
+	{
+		const double a{ normal.x }, b{ normal.y }, c{ normal.z }, d{ distance };
+		return Quadric{ a * a, a * b, a * c, a * d, b * b, b * c, b * d, c * c, c * d, d * d };
+	}
+
+	void AddQuadric(Quadric& quadric, const Quadric& other)
+	{
+		quadric.xx += other.xx; quadric.xy += other.xy; quadric.xz += other.xz; quadric.xw += other.xw;
+		quadric.yy += other.yy; quadric.yz += other.yz; quadric.yw += other.yw;
+		quadric.zz += other.zz; quadric.zw += other.zw;
+		quadric.ww += other.ww;
+	}
+
+	double EvaluateQuadric(const Quadric& q, const Elite::FPoint3& point)
+	{
+		const double x{ point.x }, y{ point.y }, z{ point.z };
+		const double result
+		{
+			q.xx * x * x + 2.0 * q.xy * x * y + 2.0 * q.xz * x * z + 2.0 * q.xw * x +
+			q.yy * y * y + 2.0 * q.yz * y * z + 2.0 * q.yw * y +
+			q.zz * z * z + 2.0 * q.zw * z +
+			q.ww
+		};
+		return std::max(result, 0.0);
+	}
+
+	struct PositionKey
+	{
+		uint32_t x, y, z;
+		bool operator==(const PositionKey& other) const { return x == other.x && y == other.y && z == other.z; }
+	};
+
+	struct PositionKeyHash
+	{
+		size_t operator()(const PositionKey& key) const
+		{
+			return (key.x * 73856093u) ^ (key.y * 19349663u) ^ (key.z * 83492791u);
+		}
+	};
+
+	struct Collapse
+	{
+		double cost;
+		uint32_t from;
+		uint32_t to;
+		uint32_t fromVersion;
+		uint32_t toVersion;
+
+		bool operator>(const Collapse& other) const { return cost > other.cost; }
+	};
+
+	uint64_t GetEdgeKey(uint32_t a, uint32_t b)
+	{
+		return a < b ? (static_cast<uint64_t>(a) << 32) | b : (static_cast<uint64_t>(b) << 32) | a;
+	}
+
+	Elite::FVector3 GetTriangleNormal(const Elite::FPoint3& p0, const Elite::FPoint3& p1, const Elite::FPoint3& p2)
+	{
+		return Elite::Cross(p1 - p0, p2 - p0);
+	}
+}
+
+std::vector<unsigned> SimplifyMesh(const VertexStreams& vertices, const std::vector<unsigned>& indices, size_t targetTriangleCount, float& error)
+{
+	error = 0.f;
+	const size_t triangleAmount{ indices.size() / 3 };
+
+	// Give every distinct position an id, collapses happen between positions
+	std::vector<uint32_t> vertexPositions(vertices.count);
+	std::vector<Elite::FPoint3> positions{};
+	std::vector<std::vector<uint32_t>> positionVertices{};
+	{
+		std::unordered_map<PositionKey, uint32_t, PositionKeyHash> positionIds{};
+		positionIds.reserve(vertices.count);
+		for (uint32_t i{ 0 }; i < vertices.count; ++i)
+		{
+			PositionKey key{};
+			std::memcpy(&key.x, &vertices.x[i], sizeof(float));
+			std::memcpy(&key.y, &vertices.y[i], sizeof(float));
+			std::memcpy(&key.z, &vertices.z[i], sizeof(float));
+
+			const auto result{ positionIds.emplace(key, static_cast<uint32_t>(positions.size())) };
+			if (result.second)
+			{
+				positions.emplace_back(vertices.x[i], vertices.y[i], vertices.z[i]);
+				positionVertices.emplace_back();
+			}
+			vertexPositions[i] = result.first->second;
+			positionVertices[result.first->second].push_back(i);
+		}
+	}
+	const size_t positionAmount{ positions.size() };
+
+	std::vector<std::array<uint32_t, 3>> triangles(triangleAmount);
+	std::vector<bool> isTriangleAlive(triangleAmount, false);
+	size_t aliveTriangleAmount{};
+	for (size_t t{ 0 }; t < triangleAmount; ++t)
+	{
+		std::array<uint32_t, 3>& triangle{ triangles[t] };
+		for (uint8_t corner{ 0 }; corner < 3; ++corner)
+		{
+			triangle[corner] = vertexPositions[indices[t * 3 + corner]];
+		}
+		if (triangle[0] != triangle[1] && triangle[1] != triangle[2] && triangle[2] != triangle[0])
+		{
+			isTriangleAlive[t] = true;
+			++aliveTriangleAmount;
+		}
+	}
+
+	// Plane quadrics of the surrounding triangles, plus planes perpendicular to open edges so borders keep their shape
+	std::vector<Quadric> quadrics(positionAmount, Quadric{});
+	std::vector<std::vector<uint32_t>> positionTriangles(positionAmount);
+	std::unordered_map<uint64_t, uint32_t> edgeUses{};
+	for (uint32_t t{ 0 }; t < triangleAmount; ++t)
+	{
+		if (!isTriangleAlive[t])
+		{
+			continue;
+		}
+
+		const std::array<uint32_t, 3>& triangle{ triangles[t] };
+		Elite::FVector3 normal{ GetTriangleNormal(positions[triangle[0]], positions[triangle[1]], positions[triangle[2]]) };
+		const float area{ Elite::Magnitude(normal) };
+		if (area > 0.f)
+		{
+			normal /= area;
+			const Quadric plane{ MakePlaneQuadric(normal, -Elite::Dot(normal, Elite::FVector3{ positions[triangle[0]] })) };
+			for (const uint32_t position : triangle)
+			{
+				AddQuadric(quadrics[position], plane);
+			}
+		}
+
+		for (uint8_t corner{ 0 }; corner < 3; ++corner)
+		{
+			positionTriangles[triangle[corner]].push_back(t);
+			++edgeUses[GetEdgeKey(triangle[corner], triangle[(corner + 1) % 3])];
+		}
+	}
+	for (uint32_t t{ 0 }; t < triangleAmount; ++t)
+	{
+		if (!isTriangleAlive[t])
+		{
+			continue;
+		}
+
+		const std::array<uint32_t, 3>& triangle{ triangles[t] };
+		const Elite::FVector3 normal{ Elite::GetNormalized(GetTriangleNormal(positions[triangle[0]], positions[triangle[1]], positions[triangle[2]])) };
+		for (uint8_t corner{ 0 }; corner < 3; ++corner)
+		{
+			const uint32_t a{ triangle[corner] };
+			const uint32_t b{ triangle[(corner + 1) % 3] };
+			if (edgeUses[GetEdgeKey(a, b)] != 1)
+			{
+				continue;
+			}
+
+			const Elite::FVector3 edgeNormal{ Elite::Cross(positions[b] - positions[a], normal) };
+			const float edgeLength{ Elite::Magnitude(edgeNormal) };
+			if (edgeLength > 0.f)
+			{
+				const Elite::FVector3 borderNormal{ edgeNormal / edgeLength };
+				const Quadric border{ MakePlaneQuadric(borderNormal, -Elite::Dot(borderNormal, Elite::FVector3{ positions[a] })) };
+				AddQuadric(quadrics[a], border);
+				AddQuadric(quadrics[b], border);
+			}
+		}
+	}
+
+	std::vector<uint32_t> versions(positionAmount, 0);
+	std::vector<bool> isRemoved(positionAmount, false);
+	std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> collapses{};
+	const auto pushCollapse = [&](uint32_t a, uint32_t b)
+	{
+		Quadric combined{ quadrics[a] };
+		AddQuadric(combined, quadrics[b]);
+		const double costToB{ EvaluateQuadric(combined, positions[b]) };
+		const double costToA{ EvaluateQuadric(combined, positions[a]) };
+		if (costToB <= costToA)
+		{
+			collapses.push(Collapse{ costToB, a, b, versions[a], versions[b] });
+		}
+		else
+		{
+			collapses.push(Collapse{ costToA, b, a, versions[b], versions[a] });
+		}
+	};
+	for (const std::pair<const uint64_t, uint32_t>& edge : edgeUses)
+	{
+		pushCollapse(static_cast<uint32_t>(edge.first >> 32), static_cast<uint32_t>(edge.first & 0xFFFFFFFF));
+	}
+
+	double maxCost{};
+	while (aliveTriangleAmount > targetTriangleCount && !collapses.empty())
+	{
+		const Collapse collapse{ collapses.top() };
+		collapses.pop();
+		if (isRemoved[collapse.from] || isRemoved[collapse.to] ||
+			versions[collapse.from] != collapse.fromVersion || versions[collapse.to] != collapse.toVersion)
+		{
+			continue;
+		}
+
+		// Reject collapses that would fold a remaining triangle over
+		bool isFlipping{ false };
+		for (const uint32_t t : positionTriangles[collapse.from])
+		{
+			const std::array<uint32_t, 3>& triangle{ triangles[t] };
+			if (!isTriangleAlive[t] || triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to)
+			{
+				continue;
+			}
+
+			std::array<Elite::FPoint3, 3> moved{ positions[triangle[0]], positions[triangle[1]], positions[triangle[2]] };
+			for (uint8_t corner{ 0 }; corner < 3; ++corner)
+			{
+				if (triangle[corner] == collapse.from)
+				{
+					moved[corner] = positions[collapse.to];
+				}
+			}
+			const Elite::FVector3 before{ GetTriangleNormal(positions[triangle[0]], positions[triangle[1]], positions[triangle[2]]) };
+			const Elite::FVector3 after{ GetTriangleNormal(moved[0], moved[1], moved[2]) };
+			if (Elite::Dot(before, after) <= 0.f)
+			{
+				isFlipping = true;
+				break;
+			}
+		}
+		if (isFlipping)
+		{
+			continue;
+		}
+
+		isRemoved[collapse.from] = true;
+		AddQuadric(quadrics[collapse.to], quadrics[collapse.from]);
+		++versions[collapse.to];
+		maxCost = std::max(maxCost, collapse.cost);
+
+		std::vector<uint32_t>& targetTriangles{ positionTriangles[collapse.to] };
+		for (const uint32_t t : positionTriangles[collapse.from])
+		{
+			if (!isTriangleAlive[t])
+			{
+				continue;
+			}
+
+			std::array<uint32_t, 3>& triangle{ triangles[t] };
+			if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to)
+			{
+				isTriangleAlive[t] = false;
+				--aliveTriangleAmount;
+				continue;
+			}
+			for (uint32_t& position : triangle)
+			{
+				if (position == collapse.from)
+				{
+					position = collapse.to;
+				}
+			}
+			targetTriangles.push_back(t);
+		}
+		positionTriangles[collapse.from].clear();
+
+		targetTriangles.erase(std::remove_if(targetTriangles.begin(), targetTriangles.end(),
+			[&isTriangleAlive](uint32_t t) { return !isTriangleAlive[t]; }), targetTriangles.end());
+		for (const uint32_t t : targetTriangles)
+		{
+			for (const uint32_t position : triangles[t])
+			{
+				if (position != collapse.to)
+				{
+					pushCollapse(collapse.to, position);
+				}
+			}
+		}
+	}
+	error = static_cast<float>(std::sqrt(maxCost));
+
+	// Corners that moved take the vertex at their new position whose attributes are closest to their own
+	const auto getAttributeDistance = [&vertices](uint32_t a, uint32_t b)
+	{
+		const float du{ vertices.u[a] - vertices.u[b] };
+		const float dv{ vertices.v[a] - vertices.v[b] };
+		const float dnx{ vertices.normalX[a] - vertices.normalX[b] };
+		const float dny{ vertices.normalY[a] - vertices.normalY[b] };
+		const float dnz{ vertices.normalZ[a] - vertices.normalZ[b] };
+		return du * du + dv * dv + dnx * dnx + dny * dny + dnz * dnz;
+	};
+
+	std::vector<unsigned> simplifiedIndices{};
+	simplifiedIndices.reserve(aliveTriangleAmount * 3);
+	for (size_t t{ 0 }; t < triangleAmount; ++t)
+	{
+		if (!isTriangleAlive[t])
+		{
+			continue;
+		}
+
+		for (uint8_t corner{ 0 }; corner < 3; ++corner)
+		{
+			const uint32_t vertex{ indices[t * 3 + corner] };
+			const uint32_t position{ triangles[t][corner] };
+			if (vertexPositions[vertex] == position)
+			{
+				simplifiedIndices.push_back(vertex);
+				continue;
+			}
+
+			uint32_t bestVertex{ positionVertices[position].front() };
+			float bestDistance{ FLT_MAX };
+			for (const uint32_t candidate : positionVertices[position])
+			{
+				const float distance{ getAttributeDistance(vertex, candidate) };
+				if (distance < bestDistance)
+				{
+					bestDistance = distance;
+					bestVertex = candidate;
+				}
+			}
+			simplifiedIndices.push_back(bestVertex);
+		}
+	}
+	return simplifiedIndices;
+}
+
+void CompactVertices(const VertexStreams& vertices, const std::vector<unsigned>& indices, VertexStreams& outVertices, std::vector<unsigned>& outIndices)
+{
+	constexpr unsigned unused{ UINT32_MAX };
+	std::vector<unsigned> remap(vertices.count, unused);
+	std::vector<unsigned> order{};
+	outIndices.resize(indices.size());
+	for (size_t i{ 0 }; i < indices.size(); ++i)
+	{
+		unsigned& newIndex{ remap[indices[i]] };
+		if (newIndex == unused)
+		{
+			newIndex = static_cast<unsigned>(order.size());
+			order.push_back(indices[i]);
+		}
+		outIndices[i] = newIndex;
+	}
+
+	outVertices.Resize(order.size());
+	for (size_t i{ 0 }; i < order.size(); ++i)
+	{
+		outVertices.CopyVertex(i, vertices, order[i]);
+	}
+}
@@ -0,0 +1,12 @@
+#pragma once
+#include <vector>
+#include "Structs.h"
+
+// Quadric error edge collapse (Garland-Heckbert). Vertices only collapse onto other existing vertices,
+// so the result indexes the same streams. Vertices sharing a position are treated as one, which keeps
+// unwelded meshes connected. Stops at targetTriangleCount or when no valid collapse is left;
+// error receives the largest collapse error as a distance in model units.
+std::vector<unsigned> SimplifyMesh(const VertexStreams& vertices, const std::vector<unsigned>& indices, size_t targetTriangleCount, float& error);
+
+// Copies only the vertices referenced by indices, in order of first use
+void CompactVertices(const VertexStreams& vertices, const std::vector<unsigned>& indices, VertexStreams& outVertices, std::vector<unsigned>& outIndices);
@@ -5,8 +5,8 @@ float4x4 gViewInverseMatrix : ViewInverseMatrix;
 
 Texture2D gDiffuseMap : DiffuseMap;
 Texture2D gNormalMap : NormalMap;
-Texture2D gSpecularMap : SpecularMap;
-Texture2D gGlossinessMap : GlossinessMap;
+// Specular in red and glossiness in green
+Texture2D gSpecularGlossinessMap : SpecularGlossinessMap;
 
 float3 gLightDirection : LightDirection = float3(0.577f, -0.577f, 0.577f);
 float gPI					= 3.1415f;
@@ -118,25 +118,27 @@ VS_OUTPUT VS(VS_INPUT input)
 
 // ===== ===== Pixel Shader Functions ===== =====
 
-float CalculatePhong(float3 specular, float phongExponent, float3 view, float3 normal)
+float CalculatePhong(float specular, float phongExponent, float3 view, float3 normal)
 {
     float3 reflect								= gLightDirection - 2.f * dot(normal, gLightDirection) * normal;
     float angleBetweenReflectAndLightDirection	= abs(dot(reflect, view));
-    float phongValue							= specular.r * pow(angleBetweenReflectAndLightDirection, phongExponent);
+    float phongValue							= specular * pow(angleBetweenReflectAndLightDirection, phongExponent);
     return phongValue;
 }
 float3 Phong(SamplerState state, VS_OUTPUT input)
 {
 	float3 binormal 							= normalize(cross(input.Normal, input.Tangent));
 	float3x3 tangentSpaceAxis 					= float3x3(normalize(input.Tangent),binormal,input.Normal);
-	float3 normalMapSample 						= gNormalMap.Sample(state, input.UV).xyz;
-	float3 newNormal 							= 2.f * normalMapSample - 1.f;
+	// The normal map is BC5, which only keeps x and y, z is the rest of the unit length
+	float2 normalMapSample 						= 2.f * gNormalMap.Sample(state, input.UV).xy - 1.f;
+	float3 newNormal 							= float3(normalMapSample, sqrt(saturate(1.f - dot(normalMapSample, normalMapSample))));
 	float3 tangentSpaceNormal					= normalize(mul(newNormal, tangentSpaceAxis));
 	
 	float observedArea							= dot(-tangentSpaceNormal, gLightDirection);
 	observedArea								= saturate(observedArea);
 	
-    float phongValue = CalculatePhong(gSpecularMap.Sample(state, input.UV).xyz, gGlossinessMap.Sample(state, input.UV).x * gShininess,
+	float2 specularGlossiness					= gSpecularGlossinessMap.Sample(state, input.UV).xy;
+    float phongValue = CalculatePhong(specularGlossiness.x, specularGlossiness.y * gShininess,
 					normalize(input.Worldposition.xyz - gViewInverseMatrix[3].xyz), tangentSpaceNormal);
 	
     return float3(gLightIntensity * (observedArea / gPI) * (gDiffuseMap.Sample(state, input.UV).xyz + phongValue));
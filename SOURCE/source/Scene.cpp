@@ -22,12 +22,27 @@ Scene::~Scene()
 void Scene::AddGeometry(Geometry* geometry)
 {
 	m_pGeos.push_back(geometry);
+	m_IsBVHDirty = true;
 }
 const std::vector<Geometry*>& Scene::GetGeometries() const
 {
 	return m_pGeos;
 }
 
+const SceneBVH& Scene::GetBVH()
+{
+	if (m_IsBVHDirty)
+	{
+		m_BVH.Build(m_pGeos);
+		m_IsBVHDirty = false;
+	}
+	return m_BVH;
+}
+const Geometry* Scene::Raycast(const Ray& ray, float& distance)
+{
+	return GetBVH().Raycast(ray, distance);
+}
+
 void Scene::AddMesh(Mesh* geometry)
 {
 	m_pMeshes.push_back(geometry);
@@ -37,6 +52,15 @@ const std::vector<Mesh*>& Scene::GetMeshes() const
 	return m_pMeshes;
 }
 
+void Scene::AddLight(const Light& light)
+{
+	m_Lights.push_back(light);
+}
+const std::vector<Light>& Scene::GetLights() const
+{
+	return m_Lights;
+}
+
 void Scene::SetCamera(Camera* pCamera)
 {
 	if (m_pCamera != pCamera)
@@ -3,6 +3,8 @@
 #include "Mesh.h"
 #include "ECamera.h"
 #include "Geometry.h"
+#include "Light.h"
+#include "SceneBVH.h"
 
 using namespace Elite;
 
@@ -14,15 +16,24 @@ public:
 
 	void AddGeometry(Geometry* geometry);
 	void AddMesh(Mesh* geometry);
+	void AddLight(const Light& light);
 
 	const std::vector<Geometry*>& GetGeometries() const;
 	const std::vector<Mesh*>& GetMeshes() const;
+	const std::vector<Light>& GetLights() const;
 	Camera* GetCamera() const;
 
+	// Rebuilt on first use after geometry was added
+	const SceneBVH& GetBVH();
+	const Geometry* Raycast(const Ray& ray, float& distance);
+
 	void SetCamera(Camera* pCamera);
 
 private:
 	std::vector<Geometry*> m_pGeos{};
+	SceneBVH m_BVH{};
+	bool m_IsBVHDirty{ true };
 	std::vector<Mesh*> m_pMeshes{};
+	std::vector<Light> m_Lights{};
 	Camera* m_pCamera{ nullptr };
 };
\ No newline at end of file
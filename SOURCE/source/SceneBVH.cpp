@@ -0,0 +1,252 @@
+#include "pch.h"
+#include "SceneBVH.h"
+#include "Geometry.h"
+
+#include <algorithm>
+#include <utility>
+
+void SceneBVH::Build(const std::vector<Geometry*>& geometries)
+{
+	m_Nodes.clear();
+	m_Items.assign(geometries.begin(), geometries.end());
+	m_ItemLeaves.assign(m_Items.size(), m_InvalidNode);
+	if (m_Items.empty())
+	{
+		return;
+	}
+
+	m_Nodes.reserve(2 * m_Items.size());
+	m_Nodes.push_back(Node{ AABB{}, m_InvalidNode, 0, 0 });
+	BuildNode(0, 0, static_cast<uint32_t>(m_Items.size()));
+
+	for (uint32_t nodeIndex{ 0 }; nodeIndex < m_Nodes.size(); ++nodeIndex)
+	{
+		const Node& node{ m_Nodes[nodeIndex] };
+		for (uint32_t item{ node.first }; item < node.first + node.itemCount; ++item)
+		{
+			m_ItemLeaves[item] = nodeIndex;
+		}
+	}
+
+	for (Geometry* geometry : geometries)
+	{
+		geometry->m_pBVH = nullptr;
+	}
+	for (uint32_t item{ 0 }; item < m_Items.size(); ++item)
+	{
+		Geometry* geometry{ const_cast<Geometry*>(m_Items[item]) };
+		geometry->m_pBVH = this;
+		geometry->m_BVHProxy = item;
+	}
+}
+
+void SceneBVH::Refit(uint32_t proxy)
+{
+	uint32_t nodeIndex{ m_ItemLeaves[proxy] };
+	while (nodeIndex != m_InvalidNode)
+	{
+		CalcNodeBounds(nodeIndex);
+		nodeIndex = m_Nodes[nodeIndex].parent;
+	}
+}
+
+void SceneBVH::QueryFrustum(const Frustum& frustum, std::vector<const Geometry*>& outGeometries) const
+{
+	if (m_Nodes.empty())
+	{
+		return;
+	}
+
+	// Every node carries the planes its parent was not yet completely inside of
+	std::vector<std::pair<uint32_t, uint8_t>> stack{};
+	stack.emplace_back(0, static_cast<uint8_t>(0x3F));
+	while (!stack.empty())
+	{
+		const uint32_t nodeIndex{ stack.back().first };
+		uint8_t planeMask{ stack.back().second };
+		stack.pop_back();
+
+		const Node& node{ m_Nodes[nodeIndex] };
+		const FrustumTest result{ TestFrustum(frustum, node.bounds, planeMask) };
+		if (result == FrustumTest::Outside)
+		{
+			continue;
+		}
+		if (result == FrustumTest::Inside)
+		{
+			AddItems(nodeIndex, outGeometries);
+			continue;
+		}
+
+		if (node.itemCount == 0)
+		{
+			stack.emplace_back(node.first, planeMask);
+			stack.emplace_back(node.first + 1, planeMask);
+			continue;
+		}
+
+		for (uint32_t item{ node.first }; item < node.first + node.itemCount; ++item)
+		{
+			if (m_Items[item]->IsVisible(frustum))
+			{
+				outGeometries.push_back(m_Items[item]);
+			}
+		}
+	}
+}
+
+const Geometry* SceneBVH::Raycast(const Ray& ray, float& distance) const
+{
+	const Geometry* pClosest{ nullptr };
+	float closestDistance{ FLT_MAX };
+
+	float nodeDistance{};
+	if (m_Nodes.empty() || !IntersectRay(m_Nodes[0].bounds, ray, closestDistance, nodeDistance))
+	{
+		return nullptr;
+	}
+
+	std::vector<std::pair<uint32_t, float>> stack{};
+	stack.emplace_back(0, nodeDistance);
+	while (!stack.empty())
+	{
+		const uint32_t nodeIndex{ stack.back().first };
+		const float entryDistance{ stack.back().second };
+		stack.pop_back();
+		if (entryDistance >= closestDistance)
+		{
+			continue;
+		}
+
+		const Node& node{ m_Nodes[nodeIndex] };
+		if (node.itemCount > 0)
+		{
+			for (uint32_t item{ node.first }; item < node.first + node.itemCount; ++item)
+			{
+				float hitDistance{};
+				if (m_Items[item]->GetIsActive() && m_Items[item]->Raycast(ray, hitDistance) && hitDistance < closestDistance)
+				{
+					closestDistance = hitDistance;
+					pClosest = m_Items[item];
+				}
+			}
+			continue;
+		}
+
+		// Push the nearer child last so it is visited first
+		float leftDistance{}, rightDistance{};
+		const bool hitLeft{ IntersectRay(m_Nodes[node.first].bounds, ray, closestDistance, leftDistance) };
+		const bool hitRight{ IntersectRay(m_Nodes[node.first + 1].bounds, ray, closestDistance, rightDistance) };
+		if (hitLeft && hitRight)
+		{
+			if (leftDistance < rightDistance)
+			{
+				stack.emplace_back(node.first + 1, rightDistance);
+				stack.emplace_back(node.first, leftDistance);
+			}
+			else
+			{
+				stack.emplace_back(node.first, leftDistance);
+				stack.emplace_back(node.first + 1, rightDistance);
+			}
+		}
+		else if (hitLeft)
+		{
+			stack.emplace_back(node.first, leftDistance);
+		}
+		else if (hitRight)
+		{
+			stack.emplace_back(node.first + 1, rightDistance);
+		}
+	}
+
+	distance = closestDistance;
+	return pClosest;
+}
+
+AABB SceneBVH::GetBounds() const
+{
+	return m_Nodes.empty() ? AABB{} : m_Nodes.front().bounds;
+}
+
+size_t SceneBVH::GetNodeCount() const
+{
+	return m_Nodes.size();
+}
+
+void SceneBVH::BuildNode(uint32_t nodeIndex, uint32_t first, uint32_t count)
+{
+	if (count <= m_MaxLeafSize)
+	{
+		m_Nodes[nodeIndex].first = first;
+		m_Nodes[nodeIndex].itemCount = count;
+		CalcNodeBounds(nodeIndex);
+		return;
+	}
+
+	// Median split along the longest axis of the item centers
+	AABB centerBounds{};
+	for (uint32_t item{ first }; item < first + count; ++item)
+	{
+		Grow(centerBounds, GetCenter(m_Items[item]->GetWorldAABB()));
+	}
+	const FVector3 extent{ GetExtent(centerBounds) };
+	uint8_t axis{ 0 };
+	if (extent.y > extent[axis])
+	{
+		axis = 1;
+	}
+	if (extent.z > extent[axis])
+	{
+		axis = 2;
+	}
+
+	const uint32_t half{ count / 2 };
+	const auto itemsBegin{ m_Items.begin() + first };
+	std::nth_element(itemsBegin, itemsBegin + half, itemsBegin + count, [axis](const Geometry* pA, const Geometry* pB)
+		{
+			return GetCenter(pA->GetWorldAABB())[axis] < GetCenter(pB->GetWorldAABB())[axis];
+		});
+
+	const uint32_t firstChild{ static_cast<uint32_t>(m_Nodes.size()) };
+	m_Nodes[nodeIndex].first = firstChild;
+	m_Nodes[nodeIndex].itemCount = 0;
+	m_Nodes.push_back(Node{ AABB{}, nodeIndex, 0, 0 });
+	m_Nodes.push_back(Node{ AABB{}, nodeIndex, 0, 0 });
+
+	BuildNode(firstChild, first, half);
+	BuildNode(firstChild + 1, first + half, count - half);
+	CalcNodeBounds(nodeIndex);
+}
+
+void SceneBVH::CalcNodeBounds(uint32_t nodeIndex)
+{
+	// Geometry without bounds grows the node to infinity, so like in Geometry::IsVisible it is never culled
+	Node& node{ m_Nodes[nodeIndex] };
+	AABB bounds{};
+	if (node.itemCount == 0)
+	{
+		Grow(bounds, m_Nodes[node.first].bounds);
+		Grow(bounds, m_Nodes[node.first + 1].bounds);
+	}
+	else
+	{
+		for (uint32_t item{ node.first }; item < node.first + node.itemCount; ++item)
+		{
+			Grow(bounds, m_Items[item]->GetWorldAABB());
+		}
+	}
+	node.bounds = bounds;
+}
+
+void SceneBVH::AddItems(uint32_t nodeIndex, std::vector<const Geometry*>& outGeometries) const
+{
+	const Node& node{ m_Nodes[nodeIndex] };
+	if (node.itemCount > 0)
+	{
+		outGeometries.insert(outGeometries.end(), m_Items.begin() + node.first, m_Items.begin() + node.first + node.itemCount);
+		return;
+	}
+	AddItems(node.first, outGeometries);
+	AddItems(node.first + 1, outGeometries);
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+
+#include "Bounds.h"
+
+class Geometry;
+
+// Bounding volume hierarchy over the world bounds of the scene geometry.
+// Geometry that moves refits its path to the root, adding or removing geometry needs a rebuild.
+class SceneBVH final
+{
+public:
+	void Build(const std::vector<Geometry*>& geometries);
+	void Refit(uint32_t proxy);
+
+	void QueryFrustum(const Frustum& frustum, std::vector<const Geometry*>& outGeometries) const;
+	const Geometry* Raycast(const Ray& ray, float& distance) const;
+	// World bounds of all the geometry, invalid while there is none
+	AABB GetBounds() const;
+
+	size_t GetNodeCount() const;
+
+private:
+	struct Node
+	{
+		AABB bounds;
+		uint32_t parent;
+		// First child for inner nodes, the second child directly follows it. First item for leaves.
+		uint32_t first;
+		uint32_t itemCount;
+	};
+
+	static constexpr uint32_t m_MaxLeafSize{ 4 };
+	static constexpr uint32_t m_InvalidNode{ UINT32_MAX };
+
+	std::vector<Node> m_Nodes;
+	std::vector<const Geometry*> m_Items;
+	std::vector<uint32_t> m_ItemLeaves;
+
+	void BuildNode(uint32_t nodeIndex, uint32_t first, uint32_t count);
+	void CalcNodeBounds(uint32_t nodeIndex);
+	void AddItems(uint32_t nodeIndex, std::vector<const Geometry*>& outGeometries) const;
+};
@@ -0,0 +1,351 @@
+#include "pch.h"
+#include "ShadowMap.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#include <cmath>
+
+#include "ECamera.h"
+
+namespace
+{
+	constexpr float unorm16Max{ 65535.f };
+
+	// Keeps the nearest of the stored depth and the triangle depth along one row of texels. The depth of the triangle
+	// starts at depth and grows by depthStep per texel
+	void WriteSpan(float* pDepth, uint32_t count, float depth, float depthStep)
+	{
+		uint32_t i{ 0 };
+#if defined(__AVX2__)
+		const __m256 lanes{ _mm256_setr_ps(0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f) };
+		const __m256 startDepth{ _mm256_set1_ps(depth) };
+		const __m256 stepDepth{ _mm256_set1_ps(depthStep) };
+		const __m256 zero{ _mm256_setzero_ps() };
+		const __m256 one{ _mm256_set1_ps(1.f) };
+		for (; i + 8 <= count; i += 8)
+		{
+			const __m256 texel{ _mm256_add_ps(lanes, _mm256_set1_ps(static_cast<float>(i))) };
+			const __m256 spanDepth{ _mm256_min_ps(_mm256_max_ps(_mm256_fmadd_ps(texel, stepDepth, startDepth), zero), one) };
+			_mm256_storeu_ps(pDepth + i, _mm256_min_ps(_mm256_loadu_ps(pDepth + i), spanDepth));
+		}
+#endif
+		for (; i < count; ++i)
+		{
+			const float spanDepth{ std::min(std::max(static_cast<float>(i) * depthStep + depth, 0.f), 1.f) };
+			pDepth[i] = std::min(pDepth[i], spanDepth);
+		}
+	}
+
+	void WriteSpan(uint16_t* pDepth, uint32_t count, float depth, float depthStep)
+	{
+		// In steps of the format with half a step added, so truncating rounds to the nearest
+		depth = depth * unorm16Max + .5f;
+		depthStep *= unorm16Max;
+
+		uint32_t i{ 0 };
+#if defined(__AVX2__)
+		const __m256 lanes{ _mm256_setr_ps(0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f) };
+		const __m256 startDepth{ _mm256_set1_ps(depth) };
+		const __m256 stepDepth{ _mm256_set1_ps(depthStep) };
+		const __m256 zero{ _mm256_setzero_ps() };
+		const __m256 maxDepth{ _mm256_set1_ps(unorm16Max) };
+		for (; i + 8 <= count; i += 8)
+		{
+			const __m256 texel{ _mm256_add_ps(lanes, _mm256_set1_ps(static_cast<float>(i))) };
+			const __m256 spanDepth{ _mm256_min_ps(_mm256_max_ps(_mm256_fmadd_ps(texel, stepDepth, startDepth), zero), maxDepth) };
+			const __m256i depth32{ _mm256_cvttps_epi32(spanDepth) };
+			const __m128i depth16{ _mm_packus_epi32(_mm256_castsi256_si128(depth32), _mm256_extracti128_si256(depth32, 1)) };
+			__m128i* pTexels{ reinterpret_cast<__m128i*>(pDepth + i) };
+			_mm_storeu_si128(pTexels, _mm_min_epu16(_mm_loadu_si128(pTexels), depth16));
+		}
+#endif
+		for (; i < count; ++i)
+		{
+			const float spanDepth{ std::min(std::max(static_cast<float>(i) * depthStep + depth, 0.f), unorm16Max) };
+			pDepth[i] = std::min(pDepth[i], static_cast<uint16_t>(spanDepth));
+		}
+	}
+
+	// Nine bilinear comparisons around the position share a 4x4 block of texels, the outer texels of the block only count
+	// for the part of a texel the position is away from the middle. Depth is in the units of the texels, and texels
+	// outside of the map repeat its border
+	template<typename Texel>
+	float FilterShadow(const Texel* pTexels, uint32_t width, uint32_t height, float col, float row, float depth)
+	{
+		const float floorCol{ std::floor(col) };
+		const float floorRow{ std::floor(row) };
+		const float colFraction{ col - floorCol };
+		const float rowFraction{ row - floorRow };
+		const float colWeights[4]{ 1.f - colFraction, 1.f, 1.f, colFraction };
+		const float rowWeights[4]{ 1.f - rowFraction, 1.f, 1.f, rowFraction };
+
+		const auto clampTexel{ [](float texel, uint32_t size) { return static_cast<uint32_t>(std::min(std::max(texel, 0.f), static_cast<float>(size - 1))); } };
+		uint32_t cols[4]{};
+		for (uint32_t i{ 0 }; i < 4; ++i)
+		{
+			cols[i] = clampTexel(floorCol + static_cast<float>(i) - 1.f, width);
+		}
+
+		float lit{};
+		for (uint32_t i{ 0 }; i < 4; ++i)
+		{
+			const Texel* pRow{ pTexels + static_cast<size_t>(clampTexel(floorRow + static_cast<float>(i) - 1.f, height)) * width };
+			float rowLit{};
+			for (uint32_t j{ 0 }; j < 4; ++j)
+			{
+				rowLit += static_cast<float>(pRow[cols[j]]) >= depth ? colWeights[j] : 0.f;
+			}
+			lit += rowLit * rowWeights[i];
+		}
+		return lit / 9.f;
+	}
+}
+
+void DepthTarget::Resize(uint32_t targetWidth, uint32_t targetHeight, DepthFormat targetFormat)
+{
+	width = targetWidth;
+	height = targetHeight;
+	format = targetFormat;
+	depth.clear();
+	depth16.clear();
+	if (format == DepthFormat::Unorm16)
+	{
+		depth16.resize(static_cast<size_t>(width) * height, UINT16_MAX);
+	}
+	else
+	{
+		depth.resize(static_cast<size_t>(width) * height, 1.f);
+	}
+}
+
+void DepthTarget::SetViewProjection(const Elite::FMatrix4& targetViewProjection)
+{
+	viewProjection = targetViewProjection;
+	frustum = ExtractFrustum(viewProjection);
+}
+
+void DepthTarget::Clear()
+{
+	std::fill(depth.begin(), depth.end(), 1.f);
+	std::fill(depth16.begin(), depth16.end(), static_cast<uint16_t>(UINT16_MAX));
+}
+
+void DepthTarget::RasterizeTriangle(const Elite::FPoint3& v0, const Elite::FPoint3& v1, const Elite::FPoint3& v2)
+{
+	// Counterclockwise from here on, so the texels inside are where all three edge functions are 0 or more
+	const float signedArea{ (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y) };
+	if (!(signedArea != 0.f))
+	{
+		return;
+	}
+	const Elite::FPoint3& a{ v0 };
+	const Elite::FPoint3& b{ signedArea > 0.f ? v1 : v2 };
+	const Elite::FPoint3& c{ signedArea > 0.f ? v2 : v1 };
+	const float area{ std::abs(signedArea) };
+
+	const float minCol{ std::max(std::ceil(std::min(a.x, std::min(b.x, c.x))), 0.f) };
+	const float maxCol{ std::min(std::floor(std::max(a.x, std::max(b.x, c.x))), static_cast<float>(width) - 1.f) };
+	const float minRow{ std::max(std::ceil(std::min(a.y, std::min(b.y, c.y))), 0.f) };
+	const float maxRow{ std::min(std::floor(std::max(a.y, std::max(b.y, c.y))), static_cast<float>(height) - 1.f) };
+	if (minCol > maxCol || minRow > maxRow)
+	{
+		return;
+	}
+
+	// Depth is a plane over the target, z / w is linear in screen space for any projection
+	const float depthPerCol{ ((b.z - a.z) * (c.y - a.y) - (c.z - a.z) * (b.y - a.y)) / area };
+	const float depthPerRow{ ((c.z - a.z) * (b.x - a.x) - (b.z - a.z) * (c.x - a.x)) / area };
+
+	// Edge functions as edgeX * col + edgeY * row + edgeOffset. Per row every edge bounds the span on one side, so the
+	// span is found directly and the texels in it need no coverage test at all
+	const Elite::FPoint3* edges[3][2]{ { &a, &b }, { &b, &c }, { &c, &a } };
+	float edgeX[3]{};
+	float edgeY[3]{};
+	float edgeOffset[3]{};
+	for (uint32_t edge{ 0 }; edge < 3; ++edge)
+	{
+		const Elite::FPoint3& from{ *edges[edge][0] };
+		const Elite::FPoint3& to{ *edges[edge][1] };
+		edgeX[edge] = from.y - to.y;
+		edgeY[edge] = to.x - from.x;
+		edgeOffset[edge] = -edgeX[edge] * from.x - edgeY[edge] * from.y;
+	}
+
+	for (float row{ minRow }; row <= maxRow; ++row)
+	{
+		float firstCol{ minCol };
+		float lastCol{ maxCol };
+		for (uint32_t edge{ 0 }; edge < 3; ++edge)
+		{
+			const float rest{ edgeY[edge] * row + edgeOffset[edge] };
+			if (edgeX[edge] > 0.f)
+			{
+				firstCol = std::max(firstCol, std::ceil(-rest / edgeX[edge]));
+			}
+			else if (edgeX[edge] < 0.f)
+			{
+				lastCol = std::min(lastCol, std::floor(-rest / edgeX[edge]));
+			}
+			else if (rest < 0.f)
+			{
+				lastCol = firstCol - 1.f;
+			}
+		}
+		if (firstCol > lastCol)
+		{
+			continue;
+		}
+
+		const uint32_t count{ static_cast<uint32_t>(lastCol - firstCol) + 1 };
+		const size_t first{ static_cast<size_t>(firstCol) + static_cast<size_t>(row) * width };
+		const float spanDepth{ a.z + depthPerCol * (firstCol - a.x) + depthPerRow * (row - a.y) };
+		if (format == DepthFormat::Unorm16)
+		{
+			WriteSpan(depth16.data() + first, count, spanDepth, depthPerCol);
+		}
+		else
+		{
+			WriteSpan(depth.data() + first, count, spanDepth, depthPerCol);
+		}
+	}
+}
+
+CascadedShadowMap::CascadedShadowMap(uint32_t size, uint32_t cascadeCount, DepthFormat format)
+	: m_Size(size)
+	, m_CascadeCount(std::min(std::max(cascadeCount, 1u), maxCascadeCount))
+{
+	SetFormat(format);
+}
+
+void CascadedShadowMap::Fit(const Elite::Camera& camera, const Elite::FVector3& lightDirection, const AABB& sceneBounds)
+{
+	const Elite::FMatrix4& viewToWorld{ camera.GetRHViewToWorld() };
+	const Elite::FPoint3 eye{ viewToWorld[3].xyz };
+	const Elite::FVector3 right{ viewToWorld[0].xyz * (camera.GetAspectRatio() * camera.GetFov()) };
+	const Elite::FVector3 up{ viewToWorld[1].xyz * camera.GetFov() };
+	const Elite::FVector3 forward{ -viewToWorld[2].xyz };
+	const float nearClip{ camera.GetNearClip() };
+	const float farClip{ camera.GetFarClip() };
+
+	// The light looks along its direction, any up that is not parallel to it will do
+	const Elite::FVector3 lightForward{ Elite::GetNormalized(lightDirection) };
+	const Elite::FVector3 lightRight{ Elite::GetNormalized(Elite::Cross(std::abs(lightForward.y) < .99f ? Elite::FVector3{ 0.f, 1.f, 0.f }
+		: Elite::FVector3{ 1.f, 0.f, 0.f }, lightForward)) };
+	const Elite::FVector3 lightUp{ Elite::Cross(lightForward, lightRight) };
+
+	float sliceStart{ nearClip };
+	for (uint32_t cascade{ 0 }; cascade < m_CascadeCount; ++cascade)
+	{
+		const float fraction{ static_cast<float>(cascade + 1) / static_cast<float>(m_CascadeCount) };
+		const float uniformSplit{ nearClip + (farClip - nearClip) * fraction };
+		const float logarithmicSplit{ nearClip * std::pow(farClip / nearClip, fraction) };
+		const float sliceEnd{ uniformSplit + (logarithmicSplit - uniformSplit) * m_LogarithmicSplit };
+
+		// The sphere around the corners of the slice has the same size whichever way the camera turns, so the texels
+		// keep their world size and only move in whole texels below
+		Elite::FPoint3 corners[8]{};
+		Elite::FVector3 cornerSum{};
+		for (uint32_t corner{ 0 }; corner < 8; ++corner)
+		{
+			const float depth{ corner < 4 ? sliceStart : sliceEnd };
+			const float horizontal{ corner & 1 ? 1.f : -1.f };
+			const float vertical{ corner & 2 ? 1.f : -1.f };
+			corners[corner] = eye + (forward + right * horizontal + up * vertical) * depth;
+			cornerSum += Elite::FVector3{ corners[corner] };
+		}
+		const Elite::FPoint3 center{ cornerSum / 8.f };
+		float radius{};
+		for (const Elite::FPoint3& corner : corners)
+		{
+			radius = std::max(radius, Elite::Magnitude(corner - center));
+		}
+		radius = std::ceil(radius * 16.f) / 16.f;
+		const float texelSize{ 2.f * radius / static_cast<float>(m_Size) };
+
+		const Elite::FVector3 centerVector{ center };
+		const float centerX{ std::floor(Elite::Dot(centerVector, lightRight) / texelSize) * texelSize };
+		const float centerY{ std::floor(Elite::Dot(centerVector, lightUp) / texelSize) * texelSize };
+		const float centerDepth{ Elite::Dot(centerVector, lightForward) };
+
+		// Casters between the light and the slice are outside of the sphere, so depth starts where the scene does
+		float nearDepth{ centerDepth - radius };
+		if (IsValid(sceneBounds))
+		{
+			for (uint32_t corner{ 0 }; corner < 8; ++corner)
+			{
+				const Elite::FVector3 boundsCorner{ corner & 1 ? sceneBounds.max.x : sceneBounds.min.x, corner & 2 ? sceneBounds.max.y : sceneBounds.min.y,
+					corner & 4 ? sceneBounds.max.z : sceneBounds.min.z };
+				nearDepth = std::min(nearDepth, Elite::Dot(boundsCorner, lightForward));
+			}
+		}
+		const float depthRange{ centerDepth + radius - nearDepth };
+
+		Elite::FMatrix4 viewProjection{ Elite::FMatrix4::Identity() };
+		for (uint8_t axis{ 0 }; axis < 3; ++axis)
+		{
+			viewProjection(0, axis) = lightRight[axis] / radius;
+			viewProjection(1, axis) = lightUp[axis] / radius;
+			viewProjection(2, axis) = lightForward[axis] / depthRange;
+		}
+		viewProjection(0, 3) = -centerX / radius;
+		viewProjection(1, 3) = -centerY / radius;
+		viewProjection(2, 3) = -nearDepth / depthRange;
+
+		DepthTarget& target{ m_Cascades[cascade] };
+		target.SetViewProjection(viewProjection);
+		target.texelSize = texelSize;
+		m_CascadeEnds[cascade] = sliceEnd;
+		sliceStart = sliceEnd;
+	}
+}
+
+void CascadedShadowMap::SetFormat(DepthFormat format)
+{
+	for (uint32_t cascade{ 0 }; cascade < m_CascadeCount; ++cascade)
+	{
+		m_Cascades[cascade].Resize(m_Size, m_Size, format);
+	}
+}
+
+DepthFormat CascadedShadowMap::GetFormat() const
+{
+	return m_Cascades[0].format;
+}
+
+uint32_t CascadedShadowMap::GetCascadeCount() const
+{
+	return m_CascadeCount;
+}
+
+DepthTarget& CascadedShadowMap::GetCascade(uint32_t cascade)
+{
+	return m_Cascades[cascade];
+}
+
+float CascadedShadowMap::Sample(const Elite::FPoint3& position, const Elite::FVector3& normal, float viewDepth) const
+{
+	uint32_t cascade{ 0 };
+	while (cascade < m_CascadeCount && viewDepth > m_CascadeEnds[cascade])
+	{
+		++cascade;
+	}
+	if (cascade == m_CascadeCount)
+	{
+		return 1.f;
+	}
+
+	const DepthTarget& target{ m_Cascades[cascade] };
+	const Elite::FPoint3 offsetPosition{ position + normal * (m_NormalOffset * target.texelSize) };
+	const Elite::FPoint4 clip{ target.viewProjection * Elite::FPoint4{ offsetPosition } };
+
+	// Texels sit at integer coordinates like the rasterizer covers them
+	const float col{ (clip.x + 1.f) * .5f * static_cast<float>(target.width) };
+	const float row{ (1.f - clip.y) * .5f * static_cast<float>(target.height) };
+	const float depth{ std::min(clip.z, 1.f) - m_DepthBias };
+	if (target.format == DepthFormat::Unorm16)
+	{
+		return FilterShadow(target.depth16.data(), target.width, target.height, col, row, depth * unorm16Max);
+	}
+	return FilterShadow(target.depth.data(), target.width, target.height, col, row, depth);
+}
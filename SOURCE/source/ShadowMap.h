@@ -0,0 +1,78 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "EMath.h"
+#include "Bounds.h"
+
+namespace Elite
+{
+	class Camera;
+}
+
+enum class DepthFormat : uint8_t
+{
+	Float32,
+	// Unsigned normalized, half the memory and bandwidth for steps of 1 / 65535
+	Unorm16
+};
+
+// A render target with only depth, for the depth only rasterizer. Geometry is placed by the view projection alone, z / w
+// lands in [0, 1] and the target keeps the nearest, cleared to 1. Only the array of its format is used
+struct DepthTarget
+{
+	Elite::FMatrix4 viewProjection;
+	Frustum frustum;
+	uint32_t width{};
+	uint32_t height{};
+	DepthFormat format{ DepthFormat::Float32 };
+	std::vector<float> depth;
+	std::vector<uint16_t> depth16;
+	// World size of a texel under an orthographic projection, picks the level of detail of the geometry.
+	// 0 keeps every mesh at full detail
+	float texelSize{};
+
+	void Resize(uint32_t targetWidth, uint32_t targetHeight, DepthFormat targetFormat);
+	void SetViewProjection(const Elite::FMatrix4& targetViewProjection);
+	void Clear();
+
+	// Both windings, texels at integer coordinates covered by the triangle or on its edges keep the nearest depth.
+	// Positions are in the screen space of the target, depth is clamped to [0, 1] instead of clipped
+	void RasterizeTriangle(const Elite::FPoint3& v0, const Elite::FPoint3& v1, const Elite::FPoint3& v2);
+};
+
+// Shadow of the directional light over the view, split along the view depth into cascades that each get a shadow map of
+// their own. Near cascades cover a small part of the view and so get more texels per world unit than far ones
+class CascadedShadowMap final
+{
+public:
+	static constexpr uint32_t maxCascadeCount{ 4 };
+
+	CascadedShadowMap(uint32_t size, uint32_t cascadeCount, DepthFormat format);
+
+	// Once per frame before the cascades are rendered. Every cascade covers the bounding sphere of its slice of the view
+	// and reaches back to the light far enough to take in every caster of the scene bounds
+	void Fit(const Elite::Camera& camera, const Elite::FVector3& lightDirection, const AABB& sceneBounds);
+	void SetFormat(DepthFormat format);
+	DepthFormat GetFormat() const;
+
+	uint32_t GetCascadeCount() const;
+	DepthTarget& GetCascade(uint32_t cascade);
+
+	// How much of the light reaches the world position, from 0 in shadow to 1 lit. The cascade is picked by view depth and
+	// filtered with 3x3 bilinear comparisons. The normal moves the position off the surface by about a texel against acne
+	float Sample(const Elite::FPoint3& position, const Elite::FVector3& normal, float viewDepth) const;
+
+private:
+	// Share of the practical split scheme that is logarithmic, the rest is uniform
+	static constexpr float m_LogarithmicSplit{ .75f };
+	// Texels of normal offset and a constant bias in depth
+	static constexpr float m_NormalOffset{ 1.5f };
+	static constexpr float m_DepthBias{ .0005f };
+
+	uint32_t m_Size;
+	uint32_t m_CascadeCount;
+	DepthTarget m_Cascades[maxCascadeCount];
+	// View depth where every cascade ends
+	float m_CascadeEnds[maxCascadeCount]{};
+};
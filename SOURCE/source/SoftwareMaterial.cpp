@@ -0,0 +1,133 @@
+#include "pch.h"
+#include "SoftwareMaterial.h"
+
+namespace
+{
+	// Weight of a transparent fragment by its view depth, equation 7 of McGuire and Bavoil's weighted blended order
+	// independent transparency. Near layers outweigh far ones, so the average color leans towards what is in front
+	float CalcTransparencyWeight(float alpha, float viewDepth)
+	{
+		const float near{ viewDepth / 5.f };
+		const float far{ viewDepth / 200.f };
+		const float far3{ far * far * far };
+		return alpha * std::min(std::max(10.f / (1e-5f + near * near + far3 * far3), 1e-2f), 3e3f);
+	}
+
+	Elite::RGBColor ReadPixel(uint32_t pixel, const SDL_PixelFormat* pFormat)
+	{
+		Uint8 red{};
+		Uint8 green{};
+		Uint8 blue{};
+		SDL_GetRGB(pixel, pFormat, &red, &green, &blue);
+		return Elite::RGBColor{ red / 255.f, green / 255.f, blue / 255.f };
+	}
+
+	uint32_t MakePixel(const Elite::RGBColor& color, const SDL_PixelFormat* pFormat)
+	{
+		return SDL_MapRGB(pFormat,
+			static_cast<Uint8>(std::min(color.r, 1.f) * 255.f),
+			static_cast<Uint8>(std::min(color.g, 1.f) * 255.f),
+			static_cast<Uint8>(std::min(color.b, 1.f) * 255.f));
+	}
+}
+
+SoftwareMaterial::SoftwareMaterial(BlendMode blendMode)
+	: m_BlendMode(blendMode)
+{
+}
+
+BlendMode SoftwareMaterial::GetBlendMode() const
+{
+	return m_BlendMode;
+}
+
+void FragmentTarget::Write(const FragmentBatch& batch) const
+{
+	switch (blendMode)
+	{
+	case BlendMode::Alpha:
+		for (size_t i{ 0 }; i < batch.count; ++i)
+		{
+			const uint32_t pixelIndex{ batch.pixelIndices[i] };
+			const float alpha{ batch.alpha[i] };
+			if (pAccumulation != nullptr)
+			{
+				const float weight{ CalcTransparencyWeight(alpha, batch.pFragments[i]->pos.w) };
+				float* pAccumulated{ pAccumulation + pixelIndex * 4 };
+				pAccumulated[0] += batch.red[i] * weight;
+				pAccumulated[1] += batch.green[i] * weight;
+				pAccumulated[2] += batch.blue[i] * weight;
+				pAccumulated[3] += weight;
+				pRevealage[pixelIndex] *= 1.f - alpha;
+				continue;
+			}
+
+			const Elite::RGBColor source{ batch.red[i], batch.green[i], batch.blue[i] };
+			pPixels[pixelIndex] = MakePixel(source * alpha + ReadPixel(pPixels[pixelIndex], pFormat) * (1.f - alpha), pFormat);
+		}
+		break;
+	case BlendMode::Additive:
+		for (size_t i{ 0 }; i < batch.count; ++i)
+		{
+			const uint32_t pixelIndex{ batch.pixelIndices[i] };
+			const Elite::RGBColor source{ batch.red[i], batch.green[i], batch.blue[i] };
+			pPixels[pixelIndex] = MakePixel(ReadPixel(pPixels[pixelIndex], pFormat) + source * batch.alpha[i], pFormat);
+		}
+		break;
+	default:
+		if (pGBuffer != nullptr)
+		{
+			// A final color for the G-buffer, its alpha of 0 keeps the lighting pass away from it
+			for (size_t i{ 0 }; i < batch.count; ++i)
+			{
+				pGBuffer->albedo[batch.pixelIndices[i]] = static_cast<uint32_t>(std::min(batch.red[i], 1.f) * 255.f)
+					| static_cast<uint32_t>(std::min(batch.green[i], 1.f) * 255.f) << 8
+					| static_cast<uint32_t>(std::min(batch.blue[i], 1.f) * 255.f) << 16;
+			}
+			break;
+		}
+		for (size_t i{ 0 }; i < batch.count; ++i)
+		{
+			pPixels[batch.pixelIndices[i]] = SDL_MapRGB(pFormat,
+				static_cast<Uint8>(batch.red[i] * 255.f),
+				static_cast<Uint8>(batch.green[i] * 255.f),
+				static_cast<Uint8>(batch.blue[i] * 255.f));
+		}
+		break;
+	}
+}
+
+void FragmentTarget::WriteSurface(const FragmentBatch& batch) const
+{
+	const auto toByte{ [](float value) { return static_cast<uint32_t>(std::min(std::max(value, 0.f), 1.f) * 255.f + .5f); } };
+	for (size_t i{ 0 }; i < batch.count; ++i)
+	{
+		const uint32_t pixelIndex{ batch.pixelIndices[i] };
+		pGBuffer->normals[pixelIndex] = GBuffer::EncodeNormal(batch.normalX[i], batch.normalY[i], batch.normalZ[i]);
+		pGBuffer->albedo[pixelIndex] = toByte(batch.red[i]) | toByte(batch.green[i]) << 8 | toByte(batch.blue[i]) << 16 | 0xFF000000;
+		pGBuffer->specularGlossiness[pixelIndex] = static_cast<uint16_t>(toByte(batch.specular[i]) | toByte(batch.glossiness[i]) << 8);
+	}
+}
+
+void FragmentTarget::Resolve(uint32_t resolveFirstRow, uint32_t resolveEndRow) const
+{
+	// The weighted average of every layer covers the back buffer by all their alphas together
+	for (uint32_t pixelIndex{ resolveFirstRow * width }; pixelIndex < resolveEndRow * width; ++pixelIndex)
+	{
+		float* pAccumulated{ pAccumulation + pixelIndex * 4 };
+		if (pAccumulated[3] == 0.f)
+		{
+			continue;
+		}
+
+		const float revealage{ pRevealage[pixelIndex] };
+		const Elite::RGBColor average{ Elite::RGBColor{ pAccumulated[0], pAccumulated[1], pAccumulated[2] } / pAccumulated[3] };
+		pPixels[pixelIndex] = MakePixel(average * (1.f - revealage) + ReadPixel(pPixels[pixelIndex], pFormat) * revealage, pFormat);
+
+		pAccumulated[0] = 0.f;
+		pAccumulated[1] = 0.f;
+		pAccumulated[2] = 0.f;
+		pAccumulated[3] = 0.f;
+		pRevealage[pixelIndex] = 1.f;
+	}
+}
@@ -0,0 +1,313 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#include "EMath.h"
+#include "GBuffer.h"
+#include "ShadowMap.h"
+#include "Structs.h"
+#include "Texture.h"
+#include "VertexTransform.h"
+
+struct SDL_PixelFormat;
+
+// How the pixel stage output lands on the back buffer, the blend states of the effects. Blended geometry does not write depth
+// and is drawn from both sides like the exhaust of Exhaust.fx
+enum class BlendMode : uint8_t
+{
+	Opaque,
+	// Source alpha over the back buffer
+	Alpha,
+	// Color times source alpha added to the back buffer
+	Additive
+};
+
+// What the vertex stage needs of one instance
+struct VertexConstants
+{
+	Elite::FMatrix4 worldViewProjection;
+	Elite::FMatrix4 world;
+	float screenWidth;
+	float screenHeight;
+};
+
+// Up to 8 visible fragments as structure of arrays. The pixel stage reads the interpolated attributes, samples through
+// the fragments and writes red, green and blue in [0, 1], alpha starts at 1 and only blended materials need to write it.
+// Lanes from count on keep whatever they held and are never written out
+struct FragmentBatch
+{
+	static constexpr size_t size{ 8 };
+
+	size_t count{};
+	std::array<const Vertex*, size> pFragments{};
+	std::array<uint32_t, size> pixelIndices{};
+
+	alignas(32) float depth[size]{};
+	alignas(32) float normalX[size]{};
+	alignas(32) float normalY[size]{};
+	alignas(32) float normalZ[size]{};
+	alignas(32) float tangentX[size]{};
+	alignas(32) float tangentY[size]{};
+	alignas(32) float tangentZ[size]{};
+	// Camera to fragment in world space, not normalized
+	alignas(32) float viewX[size]{};
+	alignas(32) float viewY[size]{};
+	alignas(32) float viewZ[size]{};
+
+	alignas(32) float red[size]{};
+	alignas(32) float green[size]{};
+	alignas(32) float blue[size]{};
+	alignas(32) float alpha[size]{};
+	// Only written by the surface stage for deferred shading, which also puts the shading normal in the normal arrays
+	// and the diffuse color in red, green and blue
+	alignas(32) float specular[size]{};
+	alignas(32) float glossiness[size]{};
+	// How much of the directional light reaches the fragment, 1 unless the pixel stage receives shadows and the target has
+	// a shadow map
+	alignas(32) float shadow[size]{};
+};
+
+// The pixels the pixel stage writes to, and the camera rays through them
+struct FragmentTarget
+{
+	uint32_t* pPixels{};
+	const SDL_PixelFormat* pFormat{};
+	const float* pDepthBuffer{};
+	uint32_t width{};
+	// Ray through pixel (0, 0) in world space, pixels are at integer coordinates like the rasterizer tests them,
+	// and how the ray changes one pixel to the right and one pixel down
+	Elite::FVector3 viewOrigin{};
+	Elite::FVector3 viewPerColumn{};
+	Elite::FVector3 viewPerRow{};
+	// The ray times the view depth of a fragment leads from here to the fragment
+	Elite::FPoint3 eye{};
+
+	BlendMode blendMode{ BlendMode::Opaque };
+	// Weighted blended order independent transparency when set: alpha fragments add their weighted premultiplied color and
+	// weight to the 4 floats of their pixel and multiply the revealage, how much of the back buffer still shows, by 1 - alpha.
+	// Nothing reaches the back buffer before Resolve
+	float* pAccumulation{};
+	float* pRevealage{};
+	// Opaque fragments go here instead of the back buffer when set, lit later by the tiled lighting pass
+	GBuffer* pGBuffer{};
+	// Shadow of the directional light for the pixel stages that receive it, forward and deferred
+	const CascadedShadowMap* pShadowMap{};
+
+	void Write(const FragmentBatch& batch) const;
+	// The output of a surface stage to the G-buffer
+	void WriteSurface(const FragmentBatch& batch) const;
+	// Composites the accumulated transparency of the rows over the back buffer and clears it again
+	void Resolve(uint32_t resolveFirstRow, uint32_t resolveEndRow) const;
+};
+
+// Shading of geometry on the software renderer, the counterpart of the effect based Material
+class SoftwareMaterial
+{
+public:
+	explicit SoftwareMaterial(BlendMode blendMode = BlendMode::Opaque);
+	SoftwareMaterial(const SoftwareMaterial& other) = delete;
+	SoftwareMaterial(SoftwareMaterial&& other) = delete;
+	SoftwareMaterial& operator=(const SoftwareMaterial& other) = delete;
+	SoftwareMaterial& operator=(SoftwareMaterial&& other) = delete;
+	virtual ~SoftwareMaterial() = default;
+
+	// Vertex stage for part of the model vertices, projectedVertices already has their size. Positions have to end up in
+	// screen space, the range may be widened to whole batches
+	virtual void ShadeVertices(const VertexConstants& constants, const VertexStreams& modelVertices, VertexStreams& projectedVertices,
+		size_t firstVertex, size_t vertexCount) const = 0;
+	// Pixel stage for rasterized fragments on the rows of the target. For opaque materials only the fragment that holds the
+	// depth of its pixel gets shaded, fragments of one draw never share a pixel that way, so parts of them can be shaded on
+	// different threads at once. Blended materials shade every fragment in the order it was rasterized
+	virtual void ShadePixels(FilterMode filterMode, const FragmentTarget& target, const Vertex* pFirst, const Vertex* pLast) const = 0;
+
+	BlendMode GetBlendMode() const;
+
+private:
+	const BlendMode m_BlendMode;
+};
+
+// A material made of a vertex stage and a pixel stage type. The loops over vertices and fragments are compiled for the
+// two types, so the stages inline into them and only a draw pays for the virtual call. The vertex stage is called as
+//		void operator()(const VertexConstants& constants, const VertexStreams& modelVertices, VertexStreams& projectedVertices,
+//			size_t firstVertex, size_t vertexCount) const
+// and the pixel stage with the filter mode of the renderer as
+//		template<FilterMode filterMode> void Shade(FragmentBatch& batch) const
+// A pixel stage that can also be lit deferred has a surface stage, it writes the diffuse color, shading normal, specular
+// and glossiness instead of a lit color
+//		template<FilterMode filterMode> void ShadeSurface(FragmentBatch& batch) const
+// Without one the pixel stage output goes to the G-buffer as a color that is not lit any further
+template<typename PixelShader, typename = void>
+struct HasSurfaceStage : std::false_type
+{
+};
+
+template<typename PixelShader>
+struct HasSurfaceStage<PixelShader, std::void_t<decltype(std::declval<const PixelShader&>().template ShadeSurface<FilterMode::Point>(
+	std::declval<FragmentBatch&>()))>> : std::true_type
+{
+};
+
+// A pixel stage lit by the directional light declares
+//		static constexpr bool receivesShadows{ true };
+// to get the shadow of every fragment before it runs, the others never pay for the lookups
+template<typename PixelShader, typename = void>
+struct ReceivesShadows : std::false_type
+{
+};
+
+template<typename PixelShader>
+struct ReceivesShadows<PixelShader, std::enable_if_t<PixelShader::receivesShadows>> : std::true_type
+{
+};
+
+template<typename VertexShader, typename PixelShader>
+class SoftwareEffect final : public SoftwareMaterial
+{
+public:
+	SoftwareEffect(VertexShader vertexShader, PixelShader pixelShader, BlendMode blendMode = BlendMode::Opaque);
+
+	void ShadeVertices(const VertexConstants& constants, const VertexStreams& modelVertices, VertexStreams& projectedVertices,
+		size_t firstVertex, size_t vertexCount) const override;
+	void ShadePixels(FilterMode filterMode, const FragmentTarget& target, const Vertex* pFirst, const Vertex* pLast) const override;
+
+private:
+	VertexShader m_VertexShader;
+	PixelShader m_PixelShader;
+
+	template<FilterMode filterMode>
+	void ShadeFragments(const FragmentTarget& target, const Vertex* pFirst, const Vertex* pLast) const;
+	template<FilterMode filterMode>
+	void ShadeBatch(const FragmentTarget& target, FragmentBatch& batch) const;
+};
+
+template<typename VertexShader, typename PixelShader>
+std::shared_ptr<SoftwareMaterial> MakeSoftwareMaterial(VertexShader vertexShader, PixelShader pixelShader, BlendMode blendMode = BlendMode::Opaque)
+{
+	return std::make_shared<SoftwareEffect<VertexShader, PixelShader>>(std::move(vertexShader), std::move(pixelShader), blendMode);
+}
+
+// The vertex stage of the effects: positions to screen space, normals and tangents to world space
+struct TransformVertexShader
+{
+	void operator()(const VertexConstants& constants, const VertexStreams& modelVertices, VertexStreams& projectedVertices,
+		size_t firstVertex, size_t vertexCount) const
+	{
+		TransformVertexRange(constants.worldViewProjection, constants.world, constants.screenWidth, constants.screenHeight,
+			modelVertices, projectedVertices, firstVertex, vertexCount);
+	}
+};
+
+template<typename VertexShader, typename PixelShader>
+SoftwareEffect<VertexShader, PixelShader>::SoftwareEffect(VertexShader vertexShader, PixelShader pixelShader, BlendMode blendMode)
+	: SoftwareMaterial(blendMode)
+	, m_VertexShader(std::move(vertexShader))
+	, m_PixelShader(std::move(pixelShader))
+{
+}
+
+template<typename VertexShader, typename PixelShader>
+void SoftwareEffect<VertexShader, PixelShader>::ShadeVertices(const VertexConstants& constants, const VertexStreams& modelVertices,
+	VertexStreams& projectedVertices, size_t firstVertex, size_t vertexCount) const
+{
+	m_VertexShader(constants, modelVertices, projectedVertices, firstVertex, vertexCount);
+}
+
+template<typename VertexShader, typename PixelShader>
+void SoftwareEffect<VertexShader, PixelShader>::ShadePixels(FilterMode filterMode, const FragmentTarget& target, const Vertex* pFirst,
+	const Vertex* pLast) const
+{
+	// Every filter mode is its own loop, so the sampler is picked once per call instead of for every pixel
+	switch (filterMode)
+	{
+	case FilterMode::Point:
+		ShadeFragments<FilterMode::Point>(target, pFirst, pLast);
+		break;
+	case FilterMode::Anisotropic:
+		ShadeFragments<FilterMode::Anisotropic>(target, pFirst, pLast);
+		break;
+	default:
+		ShadeFragments<FilterMode::Linear>(target, pFirst, pLast);
+		break;
+	}
+}
+
+template<typename VertexShader, typename PixelShader>
+template<FilterMode filterMode>
+void SoftwareEffect<VertexShader, PixelShader>::ShadeFragments(const FragmentTarget& target, const Vertex* pFirst, const Vertex* pLast) const
+{
+	const bool isOpaque{ GetBlendMode() == BlendMode::Opaque };
+	FragmentBatch batch{};
+	for (const Vertex* pVertex{ pFirst }; pVertex < pLast; ++pVertex)
+	{
+		const Vertex& vertex{ *pVertex };
+		const float col{ vertex.pos.x };
+		const float row{ vertex.pos.y };
+		const uint32_t pixelIndex{ static_cast<uint32_t>(col) + static_cast<uint32_t>(row) * target.width };
+		if (isOpaque && vertex.pos.z != target.pDepthBuffer[pixelIndex])
+		{
+			continue;
+		}
+
+		const Elite::FVector3 view{ target.viewOrigin + target.viewPerColumn * col + target.viewPerRow * row };
+		const size_t i{ batch.count };
+		batch.pFragments[i] = pVertex;
+		batch.pixelIndices[i] = pixelIndex;
+		batch.depth[i] = vertex.pos.z;
+		batch.normalX[i] = vertex.normal.x;
+		batch.normalY[i] = vertex.normal.y;
+		batch.normalZ[i] = vertex.normal.z;
+		batch.tangentX[i] = vertex.tangent.x;
+		batch.tangentY[i] = vertex.tangent.y;
+		batch.tangentZ[i] = vertex.tangent.z;
+		batch.viewX[i] = view.x;
+		batch.viewY[i] = view.y;
+		batch.viewZ[i] = view.z;
+		batch.alpha[i] = 1.f;
+		batch.shadow[i] = 1.f;
+
+		if (++batch.count == FragmentBatch::size)
+		{
+			ShadeBatch<filterMode>(target, batch);
+			batch.count = 0;
+		}
+	}
+
+	if (batch.count > 0)
+	{
+		ShadeBatch<filterMode>(target, batch);
+	}
+}
+
+template<typename VertexShader, typename PixelShader>
+template<FilterMode filterMode>
+void SoftwareEffect<VertexShader, PixelShader>::ShadeBatch(const FragmentTarget& target, FragmentBatch& batch) const
+{
+	if constexpr (HasSurfaceStage<PixelShader>::value)
+	{
+		if (target.pGBuffer != nullptr)
+		{
+			m_PixelShader.template ShadeSurface<filterMode>(batch);
+			target.WriteSurface(batch);
+			return;
+		}
+	}
+	if constexpr (ReceivesShadows<PixelShader>::value)
+	{
+		if (target.pShadowMap != nullptr)
+		{
+			// Offset along the interpolated normal, the pixel stage has not bent it with a normal map yet
+			for (size_t i{ 0 }; i < batch.count; ++i)
+			{
+				const float viewDepth{ batch.pFragments[i]->pos.w };
+				const Elite::FVector3 view{ batch.viewX[i], batch.viewY[i], batch.viewZ[i] };
+				const Elite::FVector3 normal{ Elite::GetNormalized(Elite::FVector3{ batch.normalX[i], batch.normalY[i], batch.normalZ[i] }) };
+				batch.shadow[i] = target.pShadowMap->Sample(target.eye + view * viewDepth, normal, viewDepth);
+			}
+		}
+	}
+	m_PixelShader.template Shade<filterMode>(batch);
+	target.Write(batch);
+}
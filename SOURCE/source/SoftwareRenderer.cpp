@@ -4,16 +4,43 @@
 //External includes
 #include "SDL.h"
 #include "SDL_surface.h"
+#include <atomic>
+#include <functional>
 
 //Project includes
 #include "ERGBColor.h"
 #include "SceneManager.h"
 #include "MathFunctions.h"
+#include "SoftwareShaders.h"
 
-SoftwareRenderer::SoftwareRenderer(SDL_Window* pWindow, Texture* pDiffuse, Texture* pNormal)
+namespace
+{
+	// The vertex stage and binning of all draws with one material are not worth splitting below this much work per thread
+	constexpr size_t minVerticesPerTask{ 2048 };
+	constexpr size_t minTrianglesPerTask{ 4096 };
+
+	// Runs task(0) up to task(taskCount - 1), the last one on this thread while it waits for the others
+	template<typename Task>
+	void RunTasks(ThreadPool& threadPool, size_t taskCount, const Task& task)
+	{
+		std::vector<std::future<void>> tasks{};
+		for (size_t i{ 0 }; i + 1 < taskCount; ++i)
+		{
+			tasks.push_back(threadPool.Submit([&task, i]() { task(i); }));
+		}
+		task(taskCount - 1);
+
+		for (std::future<void>& pending : tasks)
+		{
+			pending.get();
+		}
+	}
+}
+
+SoftwareRenderer::SoftwareRenderer(SDL_Window* pWindow)
 	: Renderer(pWindow)
-	, m_pTexture(pDiffuse)
-	, m_pNormalMap(pNormal)
+	, m_pDefaultMaterial(MakeSoftwareMaterial(TransformVertexShader{}, VertexColorPixelShader{}))
+	, m_pDepthMaterial(MakeSoftwareMaterial(TransformVertexShader{}, DepthPixelShader{}))
 {
 	//Initialize
 	m_pFrontBuffer = SDL_GetWindowSurface(pWindow);
@@ -21,19 +48,288 @@ SoftwareRenderer::SoftwareRenderer(SDL_Window* pWindow, Texture* pDiffuse, Textu
 	m_pBackBufferPixels = static_cast<uint32_t*>(m_pBackBuffer->pixels);
 
 	m_DepthBuffer.resize(m_Width * m_Height, 1.0f);
+	m_TransparencyAccumulation.resize(m_Width * m_Height * 4, 0.f);
+	m_TransparencyRevealage.resize(m_Width * m_Height, 1.f);
+	m_GBuffer.Resize(m_Width * m_Height);
+	m_TileLights.resize(m_ThreadPool.GetThreadCount() + 1);
+	m_TileBins.resize(std::max<size_t>(1, m_ThreadPool.GetThreadCount()));
+	m_TaskFragments.resize(std::max<size_t>(1, m_ThreadPool.GetThreadCount()));
+	for (TileBins& bins : m_TileBins)
+	{
+		bins.Resize(m_Width, m_Height);
+	}
+	m_ShadowCasters.resize(m_ShadowMap.GetCascadeCount());
+	m_ShadowProjections.resize(m_ShadowMap.GetCascadeCount());
+}
+
+SoftwareRenderer::~SoftwareRenderer() = default;
+
+void SoftwareRenderer::ProjectDraws(size_t firstDraw, size_t endDraw)
+{
+	// Culling and the level of detail are cheap and done on this thread
+	const size_t drawCount{ endDraw - firstDraw };
+	if (m_ProjectedGeometries.size() < drawCount)
+	{
+		m_ProjectedGeometries.resize(drawCount);
+	}
+	size_t vertexCount{ 0 };
+	for (size_t draw{ 0 }; draw < drawCount; ++draw)
+	{
+		const DrawItem& drawItem{ m_DrawList[firstDraw + draw] };
+		ProjectedGeometry& projected{ m_ProjectedGeometries[draw] };
+		projected.lod = *drawItem.pLod;
+		drawItem.pGeometry->Project(drawItem.instance, projected, m_RasterizerState);
+		*drawItem.pLod = static_cast<uint8_t>(projected.lod);
+		for (const IndexRange& range : projected.vertexRanges)
+		{
+			vertexCount += range.count;
+		}
+	}
+
+	// The vertex ranges of all draws are gathered into parts of about the same size that the threads take one by one
+	m_DrawRanges.clear();
+	for (uint32_t draw{ 0 }; draw < drawCount; ++draw)
+	{
+		const std::vector<IndexRange>& ranges{ m_ProjectedGeometries[draw].vertexRanges };
+		size_t partVertices{ 0 };
+		for (size_t range{ 0 }; range < ranges.size(); ++range)
+		{
+			if (partVertices == 0)
+			{
+				m_DrawRanges.push_back(DrawRanges{ 0, draw, range, range });
+			}
+			++m_DrawRanges.back().endRange;
+			partVertices += ranges[range].count;
+			if (partVertices >= minVerticesPerTask)
+			{
+				partVertices = 0;
+			}
+		}
+	}
+
+	const size_t partCount{ m_DrawRanges.size() };
+	const size_t taskCount{ std::max<size_t>(1, std::min({ m_ThreadPool.GetThreadCount(), partCount, vertexCount / minVerticesPerTask })) };
+	std::atomic<size_t> nextPart{ 0 };
+	RunTasks(m_ThreadPool, taskCount, [this, firstDraw, partCount, &nextPart](size_t)
+		{
+			for (size_t part{ nextPart++ }; part < partCount; part = nextPart++)
+			{
+				const DrawRanges& ranges{ m_DrawRanges[part] };
+				const DrawItem& drawItem{ m_DrawList[firstDraw + ranges.draw] };
+				drawItem.pGeometry->ShadeVertices(drawItem.instance, m_ProjectedGeometries[ranges.draw], ranges.firstRange, ranges.endRange);
+			}
+		});
+}
+
+void SoftwareRenderer::BinDraws(size_t firstDraw, size_t endDraw)
+{
+	// Every task bins its own consecutive part of the triangle ranges of all draws into its own bins. Tiles read the bins of
+	// the tasks in order, so they get the triangles in the order of the draws and their clusters
+	const uint32_t drawCount{ static_cast<uint32_t>(endDraw - firstDraw) };
+	size_t triangleCount{ 0 };
+	for (uint32_t draw{ 0 }; draw < drawCount; ++draw)
+	{
+		for (const IndexRange& range : m_ProjectedGeometries[draw].triangleRanges)
+		{
+			triangleCount += range.count;
+		}
+	}
+	const size_t taskCount{ std::max<size_t>(1, std::min(m_TileBins.size(), triangleCount / minTrianglesPerTask)) };
+	const size_t trianglesPerTask{ std::max<size_t>(1, (triangleCount + taskCount - 1) / taskCount) };
+
+	m_DrawRanges.clear();
+	size_t binnedTriangles{ 0 };
+	for (uint32_t draw{ 0 }; draw < drawCount; ++draw)
+	{
+		const std::vector<IndexRange>& ranges{ m_ProjectedGeometries[draw].triangleRanges };
+		for (size_t range{ 0 }; range < ranges.size(); ++range)
+		{
+			const size_t task{ std::min(binnedTriangles / trianglesPerTask, taskCount - 1) };
+			if (m_DrawRanges.empty() || m_DrawRanges.back().task != task || m_DrawRanges.back().draw != draw)
+			{
+				m_DrawRanges.push_back(DrawRanges{ task, draw, range, range });
+			}
+			++m_DrawRanges.back().endRange;
+			binnedTriangles += ranges[range].count;
+		}
+	}
+
+	m_BinTaskCount = taskCount;
+	RunTasks(m_ThreadPool, taskCount, [this, firstDraw](size_t task)
+		{
+			TileBins& bins{ m_TileBins[task] };
+			bins.Clear();
+			for (const DrawRanges& ranges : m_DrawRanges)
+			{
+				if (ranges.task == task)
+				{
+					m_DrawList[firstDraw + ranges.draw].pGeometry->BinTriangles(m_ProjectedGeometries[ranges.draw], ranges.firstRange, ranges.endRange,
+						ranges.draw, m_RasterizerState, bins);
+				}
+			}
+		});
+}
+
+void SoftwareRenderer::RasterizeTile(size_t firstDraw, uint32_t tile, std::vector<Vertex>& fragments, RasterizerState& state)
+{
+	const ScreenTile screenTile{ m_TileBins.front().GetTile(tile) };
+	for (size_t task{ 0 }; task < m_BinTaskCount; ++task)
+	{
+		// Consecutive triangles of one draw go to its geometry together
+		const std::vector<BinnedTriangle>& triangles{ m_TileBins[task].tiles[tile] };
+		for (size_t first{ 0 }; first < triangles.size();)
+		{
+			const uint32_t draw{ triangles[first].draw };
+			size_t last{ first + 1 };
+			while (last < triangles.size() && triangles[last].draw == draw)
+			{
+				++last;
+			}
+			m_DrawList[firstDraw + draw].pGeometry->Rasterize(m_ProjectedGeometries[draw], triangles.data() + first, triangles.data() + last,
+				screenTile, m_DepthBuffer, fragments, state);
+			first = last;
+		}
+	}
+}
+
+void SoftwareRenderer::RasterizeTiles(size_t firstDraw, const SoftwareMaterial& material, const FragmentTarget& target)
+{
+	// Tiles share no pixels, so every thread takes the next tile, rasterizes it into fragments of its own and shades those
+	// while the tile is still in its cache. Depth is final once the tile is rasterized, so every opaque fragment that holds
+	// it gets shaded like before. The fragments of a pixel keep the order they were rasterized in, which blending and the
+	// transparency accumulation need
+	const uint32_t tileCount{ static_cast<uint32_t>(m_TileBins.front().tiles.size()) };
+	const size_t taskCount{ std::max<size_t>(1, std::min<size_t>(m_ThreadPool.GetThreadCount(), tileCount)) };
+	const FilterMode filterMode{ m_FilterMode };
+	std::atomic<uint32_t> nextTile{ 0 };
+	std::atomic<uint64_t> testedFragments{ 0 };
+	std::atomic<uint64_t> rejectedFragments{ 0 };
+	RunTasks(m_ThreadPool, taskCount, [&](size_t task)
+		{
+			RasterizerState state{ m_RasterizerState };
+			state.testedFragments = 0;
+			state.rejectedFragments = 0;
+			std::vector<Vertex>& fragments{ m_TaskFragments[task] };
+			for (uint32_t tile{ nextTile++ }; tile < tileCount; tile = nextTile++)
+			{
+				fragments.clear();
+				RasterizeTile(firstDraw, tile, fragments, state);
+				material.ShadePixels(filterMode, target, fragments.data(), fragments.data() + fragments.size());
+			}
+			testedFragments += state.testedFragments;
+			rejectedFragments += state.rejectedFragments;
+		});
+	m_RasterizerState.testedFragments += testedFragments;
+	m_RasterizerState.rejectedFragments += rejectedFragments;
+}
+
+void SoftwareRenderer::ResolveTransparency(const FragmentTarget& target)
+{
+	// Pixels only read their own accumulation, so the rows are split evenly over the threads
+	const size_t taskCount{ std::max<size_t>(1, m_ThreadPool.GetThreadCount()) };
+	const uint32_t rowsPerTask{ static_cast<uint32_t>((m_Height + taskCount - 1) / taskCount) };
+	const uint32_t height{ m_Height };
+
+	m_ShadingTasks.clear();
+	for (size_t task{ 0 }; task + 1 < taskCount; ++task)
+	{
+		const uint32_t firstRow{ std::min(static_cast<uint32_t>(task) * rowsPerTask, height) };
+		m_ShadingTasks.push_back(m_ThreadPool.Submit([&target, firstRow, endRow = std::min(firstRow + rowsPerTask, height)]()
+			{
+				target.Resolve(firstRow, endRow);
+			}));
+	}
+	target.Resolve(std::min(static_cast<uint32_t>(taskCount - 1) * rowsPerTask, height), height);
+
+	for (std::future<void>& task : m_ShadingTasks)
+	{
+		task.get();
+	}
+}
+
+void SoftwareRenderer::ShadeLights(const FragmentTarget& target)
+{
+	// Rows of tiles are split evenly over the threads, each with its own list of tile lights
+	const uint32_t tileRows{ (m_Height + TiledLighting::tileSize - 1) / TiledLighting::tileSize };
+	const size_t taskCount{ std::max<size_t>(1, std::min<size_t>(m_ThreadPool.GetThreadCount(), tileRows)) };
+	const uint32_t rowsPerTask{ static_cast<uint32_t>((tileRows + taskCount - 1) / taskCount) };
+	const auto shadeTask{ [this, &target, tileRows, rowsPerTask](size_t task)
+		{
+			const uint32_t firstTileRow{ std::min(static_cast<uint32_t>(task) * rowsPerTask, tileRows) };
+			return m_TiledLighting.ShadeTiles(target, m_Height, firstTileRow, std::min(firstTileRow + rowsPerTask, tileRows), m_TileLights[task]);
+		} };
+
+	std::vector<std::future<uint64_t>> tasks{};
+	for (size_t task{ 0 }; task + 1 < taskCount; ++task)
+	{
+		tasks.push_back(m_ThreadPool.Submit([&shadeTask, task]() { return shadeTask(task); }));
+	}
+	m_RasterizerState.tileLights += shadeTask(taskCount - 1);
+	m_RasterizerState.lightTiles += static_cast<uint64_t>(tileRows) * ((m_Width + TiledLighting::tileSize - 1) / TiledLighting::tileSize);
+
+	for (std::future<uint64_t>& task : tasks)
+	{
+		m_RasterizerState.tileLights += task.get();
+	}
 }
 
-SoftwareRenderer::~SoftwareRenderer()
+void SoftwareRenderer::RenderShadows(Scene& scene)
 {
-	delete m_pTexture;
-	delete m_pNormalMap;
+	// The cascades only share the scene, so each one is rendered on a thread of its own with its own counters
+	const SceneBVH& bvh{ scene.GetBVH() };
+	m_ShadowMap.Fit(*scene.GetCamera(), FVector3{ PosCol3D::lightDirectionX, PosCol3D::lightDirectionY, PosCol3D::lightDirectionZ }, bvh.GetBounds());
+	const bool useLods{ m_RasterizerState.useLods };
+	const auto renderTask{ [this, &bvh, useLods](uint32_t cascade)
+		{
+			DepthTarget& target{ m_ShadowMap.GetCascade(cascade) };
+			std::vector<const Geometry*>& casters{ m_ShadowCasters[cascade] };
+			RasterizerState state{};
+			state.useLods = useLods;
+
+			target.Clear();
+			casters.clear();
+			bvh.QueryFrustum(target.frustum, casters);
+			for (const Geometry* pGeometry : casters)
+			{
+				// Blended geometry writes no depth, so it casts no shadow either
+				const SoftwareMaterial* pMaterial{ pGeometry->GetMaterial() };
+				if (!pGeometry->GetIsActive() || (pMaterial != nullptr && pMaterial->GetBlendMode() != BlendMode::Opaque))
+				{
+					continue;
+				}
+
+				const uint32_t instanceCount{ pGeometry->GetInstanceCount() };
+				for (uint32_t instance{ 0 }; instance < instanceCount; ++instance)
+				{
+					if (pGeometry->IsInstanceVisible(instance, target.frustum))
+					{
+						pGeometry->RasterizeDepth(instance, target, m_ShadowProjections[cascade], state);
+					}
+				}
+			}
+			return state.depthTriangles;
+		} };
+
+	const uint32_t cascadeCount{ m_ShadowMap.GetCascadeCount() };
+	std::vector<std::future<uint64_t>> tasks{};
+	for (uint32_t cascade{ 0 }; cascade + 1 < cascadeCount; ++cascade)
+	{
+		tasks.push_back(m_ThreadPool.Submit([&renderTask, cascade]() { return renderTask(cascade); }));
+	}
+	m_RasterizerState.depthTriangles += renderTask(cascadeCount - 1);
+
+	for (std::future<uint64_t>& task : tasks)
+	{
+		m_RasterizerState.depthTriangles += task.get();
+	}
 }
 
 void SoftwareRenderer::Render()
 {
 	SDL_LockSurface(m_pBackBuffer);
 
-	const Scene& activeScene{ SceneManager::GetInstance().GetScene() };
+	Scene& activeScene{ SceneManager::GetInstance().GetScene() };
+	++m_RasterizerState.renderedFrames;
 	
 	for (uint32_t row = 0; row < m_Height; ++row)
 	{
@@ -46,39 +342,143 @@ void SoftwareRenderer::Render()
 		}
 	}
 
-	for (const Geometry* geometry : activeScene.GetGeometries())
+	// Geometry outside the view frustum is skipped by the scene hierarchy, then single instances before projection
+	const Frustum& frustum{ activeScene.GetCamera()->GetRHFrustum() };
+	const FMatrix4& worldToView{ activeScene.GetCamera()->GetRHWorldToView() };
+	m_VisibleGeometries.clear();
+	activeScene.GetBVH().QueryFrustum(frustum, m_VisibleGeometries);
+	m_RasterizerState.culledGeometries += activeScene.GetGeometries().size() - m_VisibleGeometries.size();
+
+	m_DrawList.clear();
+	for (const Geometry* geometry : m_VisibleGeometries)
+	{
+		if (!geometry->GetIsActive())
+		{
+			continue;
+		}
+		const SoftwareMaterial* pMaterial{ geometry->GetMaterial() != nullptr ? geometry->GetMaterial() : m_pDefaultMaterial.get() };
+
+		const uint32_t instanceCount{ geometry->GetInstanceCount() };
+		InstanceLods& instanceLods{ m_InstanceLods[geometry] };
+		instanceLods.isVisited = true;
+		if (instanceLods.lods.size() < instanceCount)
+		{
+			instanceLods.lods.resize(instanceCount, 0);
+		}
+		for (uint32_t instance{ 0 }; instance < instanceCount; ++instance)
+		{
+			if (!geometry->IsInstanceVisible(instance, frustum))
+			{
+				++m_RasterizerState.culledInstances;
+				continue;
+			}
+
+			const FMatrix4 transform{ geometry->GetInstanceTransform(instance) };
+			const float viewDepth{ -(worldToView * FPoint4{ transform[3].x, transform[3].y, transform[3].z }).z };
+			m_DrawList.push_back(DrawItem{ geometry, pMaterial, instance, viewDepth, &instanceLods.lods[instance] });
+		}
+	}
+	for (auto it{ m_InstanceLods.begin() }; it != m_InstanceLods.end();)
 	{
-		std::vector<Vertex> geometryVertices{ geometry->GetModelVerts() };
-		geometry->Project(geometryVertices);
+		if (!it->second.isVisited)
+		{
+			it = m_InstanceLods.erase(it);
+			continue;
+		}
+		it->second.isVisited = false;
+		++it;
+	}
+	m_RasterizerState.drawnInstances += m_DrawList.size();
 
-		std::vector<Vertex> outVertices{};
-		geometry->Rasterize(geometryVertices, m_DepthBuffer, outVertices);
+	if (m_Shadows)
+	{
+		RenderShadows(activeScene);
+	}
 
-		for (const Vertex& vertex : outVertices)
+	// Draws are grouped by material, so every material shades all of its fragments at once with its textures in the cache.
+	// Within a material near instances come first, so the depth test rejects as many hidden fragments as possible.
+	// Blended draws come after every opaque one. With order independent transparency their order does not matter, so they
+	// are grouped by material too, otherwise they go from far to near so every layer blends over the ones behind it
+	const bool frontToBack{ m_RasterizerState.frontToBack };
+	const bool isOrderIndependent{ m_OrderIndependentTransparency };
+	std::sort(m_DrawList.begin(), m_DrawList.end(), [frontToBack, isOrderIndependent](const DrawItem& a, const DrawItem& b)
 		{
-			RGBColor finalPixelColor;
-			if (m_RenderDepthBuffer)
+			const bool isOpaqueA{ a.pMaterial->GetBlendMode() == BlendMode::Opaque };
+			const bool isOpaqueB{ b.pMaterial->GetBlendMode() == BlendMode::Opaque };
+			if (isOpaqueA != isOpaqueB)
 			{
-				finalPixelColor = RGBColor{ vertex.pos.z, vertex.pos.z , vertex.pos.z };
+				return isOpaqueA;
 			}
-			else
+			if (!isOpaqueA && !isOrderIndependent && a.viewDepth != b.viewDepth)
 			{
-				finalPixelColor = m_pTexture->Sample(vertex.uv);
+				return a.viewDepth > b.viewDepth;
 			}
+			if (a.pMaterial != b.pMaterial)
+			{
+				return std::less<const SoftwareMaterial*>{}(a.pMaterial, b.pMaterial);
+			}
+			return frontToBack && a.viewDepth < b.viewDepth;
+		});
+
+	const FMatrix4& viewToWorld{ activeScene.GetCamera()->GetRHViewToWorld() };
+	const float halfViewWidth{ activeScene.GetCamera()->GetAspectRatio() * activeScene.GetCamera()->GetFov() };
+	const float halfViewHeight{ activeScene.GetCamera()->GetFov() };
+	FragmentTarget target{};
+	target.pPixels = m_pBackBufferPixels;
+	target.pFormat = m_pBackBuffer->format;
+	target.pDepthBuffer = m_DepthBuffer.data();
+	target.width = m_Width;
+	target.viewOrigin = viewToWorld[0].xyz * -halfViewWidth + viewToWorld[1].xyz * halfViewHeight - viewToWorld[2].xyz;
+	target.viewPerColumn = viewToWorld[0].xyz * (2.f * halfViewWidth / static_cast<float>(m_Width));
+	target.viewPerRow = viewToWorld[1].xyz * (-2.f * halfViewHeight / static_cast<float>(m_Height));
+	target.eye = FPoint3{ viewToWorld[3].xyz };
+	target.pShadowMap = m_Shadows ? &m_ShadowMap : nullptr;
+	target.pAccumulation = isOrderIndependent ? m_TransparencyAccumulation.data() : nullptr;
+	target.pRevealage = isOrderIndependent ? m_TransparencyRevealage.data() : nullptr;
+	// Deferred shading writes the opaque draws to the G-buffer and lights it before the first blended draw
+	target.pGBuffer = m_DeferredShading ? &m_GBuffer : nullptr;
+	if (m_DeferredShading)
+	{
+		m_TiledLighting.SetView(activeScene.GetLights(), viewToWorld, activeScene.GetCamera()->GetRHProjection());
+	}
 
-			m_pBackBufferPixels
-				[
-					PixelToBufferIndex
-					(
-						static_cast<unsigned int>(roundf(vertex.pos.x)),
-						static_cast<unsigned int>(roundf(vertex.pos.y)),
-						m_Width
-					)
-				] = SDL_MapRGB(m_pBackBuffer->format,
-					static_cast<Uint8>(finalPixelColor.r * 255.f),
-					static_cast<Uint8>(finalPixelColor.g * 255.f),
-					static_cast<Uint8>(finalPixelColor.b * 255.f));
+	bool hasAccumulated{ false };
+	for (size_t first{ 0 }; first < m_DrawList.size();)
+	{
+		const SoftwareMaterial* pMaterial{ m_DrawList[first].pMaterial };
+		const bool isOpaque{ pMaterial->GetBlendMode() == BlendMode::Opaque };
+		if (!isOpaque && target.pGBuffer != nullptr)
+		{
+			ShadeLights(target);
+			target.pGBuffer = nullptr;
+		}
+		m_RasterizerState.depthWrite = isOpaque;
+		m_RasterizerState.cullBackFaces = isOpaque;
+		size_t last{ first };
+		while (last < m_DrawList.size() && m_DrawList[last].pMaterial == pMaterial)
+		{
+			++last;
 		}
+		ProjectDraws(first, last);
+		BinDraws(first, last);
+
+		// The depth view only replaces the pixel stage, the vertex stage of the material still places the geometry
+		const SoftwareMaterial& shadingMaterial{ m_RenderDepthBuffer ? *m_pDepthMaterial : *pMaterial };
+		target.blendMode = shadingMaterial.GetBlendMode();
+		hasAccumulated = hasAccumulated || (isOrderIndependent && target.blendMode == BlendMode::Alpha);
+		RasterizeTiles(first, shadingMaterial, target);
+		first = last;
+	}
+	m_RasterizerState.depthWrite = true;
+	m_RasterizerState.cullBackFaces = true;
+	if (target.pGBuffer != nullptr)
+	{
+		ShadeLights(target);
+	}
+
+	if (hasAccumulated)
+	{
+		ResolveTransparency(target);
 	}
 
 	std::fill(m_DepthBuffer.begin(), m_DepthBuffer.end(), 1.0f);
@@ -93,21 +493,106 @@ bool SoftwareRenderer::SaveBackbufferToImage() const
 	return SDL_SaveBMP(m_pBackBuffer, "BackbufferRender.bmp");
 }
 
-RGBColor SoftwareRenderer::ShadePixel(const Vertex& outVertex) const
+void SoftwareRenderer::ToggleRenderDepthBuffer()
 {
-	const FVector3 lightDirection{ .577f, -.577f, -.577f };
-	const RGBColor lightColor{ 1.f, 1.f, 1.f };
-	constexpr float intensity{ 2.f };
+	m_RenderDepthBuffer = !m_RenderDepthBuffer;
+}
 
+bool SoftwareRenderer::ToggleFrontToBack()
+{
+	m_RasterizerState.frontToBack = !m_RasterizerState.frontToBack;
+	return m_RasterizerState.frontToBack;
+}
 
-	const float observedArea{ Dot(-outVertex.normal, lightDirection) };
+void SoftwareRenderer::SetFilterMode(FilterMode filterMode)
+{
+	m_FilterMode = filterMode;
+}
 
-	const RGBColor diffuseColor{ m_pTexture->Sample(outVertex.uv) };
+bool SoftwareRenderer::ToggleLods()
+{
+	m_RasterizerState.useLods = !m_RasterizerState.useLods;
+	return m_RasterizerState.useLods;
+}
 
-	return lightColor * intensity * diffuseColor * observedArea;
+bool SoftwareRenderer::ToggleDeferredShading()
+{
+	m_DeferredShading = !m_DeferredShading;
+	return m_DeferredShading;
 }
 
-void SoftwareRenderer::ToggleRenderDepthBuffer()
+bool SoftwareRenderer::ToggleShadows()
 {
-	m_RenderDepthBuffer = !m_RenderDepthBuffer;
+	m_Shadows = !m_Shadows;
+	return m_Shadows;
+}
+
+bool SoftwareRenderer::ToggleShadowUnorm16Depth()
+{
+	const bool isUnorm16{ m_ShadowMap.GetFormat() != DepthFormat::Unorm16 };
+	m_ShadowMap.SetFormat(isUnorm16 ? DepthFormat::Unorm16 : DepthFormat::Float32);
+	return isUnorm16;
+}
+
+bool SoftwareRenderer::ToggleOrderIndependentTransparency()
+{
+	m_OrderIndependentTransparency = !m_OrderIndependentTransparency;
+	return m_OrderIndependentTransparency;
+}
+
+void SoftwareRenderer::PrintStatistics()
+{
+	if (m_RasterizerState.testedFragments > 0)
+	{
+		const double rejectedRatio{ static_cast<double>(m_RasterizerState.rejectedFragments) / static_cast<double>(m_RasterizerState.testedFragments) };
+		std::cout << "Rejected fragments: " << rejectedRatio * 100.0 << "% (" << m_RasterizerState.rejectedFragments << " / "
+			<< m_RasterizerState.testedFragments << ")\n";
+	}
+	std::cout << "Instances drawn: " << m_RasterizerState.drawnInstances << ", culled: " << m_RasterizerState.culledInstances
+		<< ", geometries culled: " << m_RasterizerState.culledGeometries << "\n";
+	if (m_RasterizerState.renderedFrames > 0)
+	{
+		const uint64_t fullDetailTriangles{ m_RasterizerState.drawnTriangles + m_RasterizerState.savedTriangles };
+		std::cout << "Triangles per frame: " << m_RasterizerState.drawnTriangles / m_RasterizerState.renderedFrames
+			<< ", saved by LOD: " << m_RasterizerState.savedTriangles / m_RasterizerState.renderedFrames;
+		if (fullDetailTriangles > 0)
+		{
+			std::cout << " (" << static_cast<double>(m_RasterizerState.savedTriangles) / static_cast<double>(fullDetailTriangles) * 100.0 << "%)";
+		}
+		std::cout << "\n";
+	}
+	const uint64_t testedClusters
+	{
+		m_RasterizerState.drawnClusters + m_RasterizerState.frustumCulledClusters + m_RasterizerState.backfaceCulledClusters
+	};
+	if (testedClusters > 0)
+	{
+		std::cout << "Clusters drawn: " << m_RasterizerState.drawnClusters << " / " << testedClusters
+			<< ", culled by frustum: " << m_RasterizerState.frustumCulledClusters
+			<< ", back facing: " << m_RasterizerState.backfaceCulledClusters << "\n";
+	}
+	if (m_RasterizerState.depthTriangles > 0 && m_RasterizerState.renderedFrames > 0)
+	{
+		std::cout << "Shadow triangles per frame: " << m_RasterizerState.depthTriangles / m_RasterizerState.renderedFrames << "\n";
+	}
+	if (m_RasterizerState.lightTiles > 0)
+	{
+		std::cout << "Lights per tile: " << static_cast<double>(m_RasterizerState.tileLights) / static_cast<double>(m_RasterizerState.lightTiles)
+			<< " of " << SceneManager::GetInstance().GetScene().GetLights().size() << "\n";
+	}
+
+	m_RasterizerState.testedFragments = 0;
+	m_RasterizerState.rejectedFragments = 0;
+	m_RasterizerState.drawnInstances = 0;
+	m_RasterizerState.culledInstances = 0;
+	m_RasterizerState.culledGeometries = 0;
+	m_RasterizerState.drawnTriangles = 0;
+	m_RasterizerState.savedTriangles = 0;
+	m_RasterizerState.drawnClusters = 0;
+	m_RasterizerState.frustumCulledClusters = 0;
+	m_RasterizerState.backfaceCulledClusters = 0;
+	m_RasterizerState.lightTiles = 0;
+	m_RasterizerState.tileLights = 0;
+	m_RasterizerState.depthTriangles = 0;
+	m_RasterizerState.renderedFrames = 0;
 }
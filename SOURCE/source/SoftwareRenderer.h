@@ -4,20 +4,28 @@
 
 #include "Renderer.h"
 #include <cstdint>
+#include <memory>
+#include <unordered_map>
 #include <vector>
 
 #include "Texture.h"
 #include "Structs.h"
+#include "Geometry.h"
+#include "SoftwareMaterial.h"
+#include "ShadowMap.h"
+#include "ThreadPool.h"
+#include "TiledLighting.h"
 
 struct SDL_Window;
 struct SDL_Surface;
+class Scene;
 
 namespace Elite
 {
 	class SoftwareRenderer final : public Renderer
 	{
 	public:
-		explicit SoftwareRenderer(SDL_Window* pWindow, Texture* pDiffuse, Texture* pNormal);
+		explicit SoftwareRenderer(SDL_Window* pWindow);
 		~SoftwareRenderer() override;
 
 		SoftwareRenderer(const SoftwareRenderer&) = delete;
@@ -28,21 +36,104 @@ namespace Elite
 		void Render() override;
 		bool SaveBackbufferToImage() const;
 
-		RGBColor ShadePixel(const Vertex& outVertex) const;
-
 		void ToggleRenderDepthBuffer();
+		bool ToggleFrontToBack();
+		bool ToggleLods();
+		bool ToggleOrderIndependentTransparency();
+		// Opaque geometry goes to the G-buffer and is lit per tile with the lights of the scene
+		bool ToggleDeferredShading();
+		// Shadow of the directional light, forward and deferred. Off until toggled, the cascades cost every frame
+		bool ToggleShadows();
+		// The shadow maps store 16 bit unsigned normalized depth instead of floats
+		bool ToggleShadowUnorm16Depth();
+		// Same modes as the techniques of the DirectX materials
+		void SetFilterMode(FilterMode filterMode);
+		void PrintStatistics();
 
 	private:
+		struct DrawItem
+		{
+			const Geometry* pGeometry;
+			const SoftwareMaterial* pMaterial;
+			uint32_t instance;
+			float viewDepth;
+			// Level of detail of the instance in the previous frame, then in this one
+			uint8_t* pLod;
+		};
+
+		// Levels of detail of every instance of a geometry, kept only while the geometry is drawn
+		struct InstanceLods
+		{
+			std::vector<uint8_t> lods;
+			bool isVisited;
+		};
+
+		// Vertex or triangle ranges [firstRange, endRange) of a draw, and the task that works on them
+		struct DrawRanges
+		{
+			size_t task;
+			uint32_t draw;
+			size_t firstRange;
+			size_t endRange;
+		};
+
 		SDL_Surface* m_pFrontBuffer = nullptr;
 		SDL_Surface* m_pBackBuffer = nullptr;
 		uint32_t* m_pBackBufferPixels = nullptr;
 
 		std::vector<float> m_DepthBuffer;
+		std::vector<const Geometry*> m_VisibleGeometries;
+		std::vector<DrawItem> m_DrawList;
+		// Level of detail of every instance drawn in the previous frame, by geometry, for the hysteresis between frames.
+		// Geometry that is not drawn for a frame loses its entry, so the map does not grow and a geometry created at the
+		// address of a deleted one does not inherit its levels
+		std::unordered_map<const Geometry*, InstanceLods> m_InstanceLods;
+		// One for every draw with the current material
+		std::vector<ProjectedGeometry> m_ProjectedGeometries;
+		RasterizerState m_RasterizerState;
+		std::vector<DrawRanges> m_DrawRanges;
+		// Bins of every binning task, the tasks that binned the current material come first
+		std::vector<TileBins> m_TileBins;
+		size_t m_BinTaskCount{};
 
-		Texture* m_pTexture;
-		Texture* m_pNormalMap;
+		// For geometry without a material of its own
+		std::shared_ptr<SoftwareMaterial> m_pDefaultMaterial;
+		// Its pixel stage replaces that of every material while the depth buffer is shown
+		std::shared_ptr<SoftwareMaterial> m_pDepthMaterial;
+		// Fragments of the tile every task rasterizes
+		std::vector<std::vector<Vertex>> m_TaskFragments;
+		// Weighted blended transparency, 4 floats per pixel and the revealage, cleared again by every resolve
+		std::vector<float> m_TransparencyAccumulation;
+		std::vector<float> m_TransparencyRevealage;
+		GBuffer m_GBuffer;
+		TiledLighting m_TiledLighting;
+		// Lights of one tile, for every thread
+		std::vector<std::vector<uint32_t>> m_TileLights;
+		// Cascades of 1024x1024 over the view, drawn by the depth only rasterizer at the start of every frame
+		CascadedShadowMap m_ShadowMap{ 1024, 4, DepthFormat::Float32 };
+		// Casters of every cascade and their projected positions
+		std::vector<std::vector<const Geometry*>> m_ShadowCasters;
+		std::vector<ProjectedGeometry> m_ShadowProjections;
 
 		bool m_RenderDepthBuffer = false;
+		bool m_OrderIndependentTransparency = true;
+		bool m_DeferredShading = false;
+		bool m_Shadows = false;
+		FilterMode m_FilterMode = FilterMode::Point;
+
+		ThreadPool m_ThreadPool{};
+		std::vector<std::future<void>> m_ShadingTasks;
+
+		// Culls the draws [firstDraw, endDraw) and runs their vertex stage, then bins their triangles
+		void ProjectDraws(size_t firstDraw, size_t endDraw);
+		void BinDraws(size_t firstDraw, size_t endDraw);
+		// The binned triangles of the tile, draws are counted from firstDraw like they were binned
+		void RasterizeTile(size_t firstDraw, uint32_t tile, std::vector<Vertex>& fragments, RasterizerState& state);
+		// Rasterizes and shades the tiles of the draws on the threads
+		void RasterizeTiles(size_t firstDraw, const SoftwareMaterial& material, const FragmentTarget& target);
+		void ResolveTransparency(const FragmentTarget& target);
+		void ShadeLights(const FragmentTarget& target);
+		void RenderShadows(Scene& scene);
 	};
 }
 
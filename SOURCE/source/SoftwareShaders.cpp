@@ -0,0 +1,212 @@
+#include "pch.h"
+#include "SoftwareShaders.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#include <cstring>
+
+namespace
+{
+	using namespace PosCol3D;
+
+	// pow(x, y) is exp2(y * log2(x)) like the shader compiler expands it. The polynomials are minimax fits over the mantissa
+	// and the fraction, log2 is within 6e-5 and exp2 within 1e-7 relative, far below what the 8 bit target can show
+	constexpr float log2Coefficients[5]{ 2.88827045f, -2.52074963f, 1.48116648f, -.465725644f, .0596515483f };
+	constexpr float exp2Coefficients[6]{ .99999994f, .69315308f, .24015361f, .055826318f, .0089893397f, .0018775767f };
+
+#if defined(__AVX2__)
+	__m256 Log2(__m256 x)
+	{
+		const __m256i bits{ _mm256_castps_si256(x) };
+		const __m256 exponent{ _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(127))) };
+		const __m256 mantissa{ _mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(0x007FFFFF)), _mm256_set1_epi32(0x3F800000))) };
+
+		__m256 polynomial{ _mm256_set1_ps(log2Coefficients[4]) };
+		for (int i{ 3 }; i >= 0; --i)
+		{
+			polynomial = _mm256_fmadd_ps(polynomial, mantissa, _mm256_set1_ps(log2Coefficients[i]));
+		}
+		return _mm256_fmadd_ps(polynomial, _mm256_sub_ps(mantissa, _mm256_set1_ps(1.f)), exponent);
+	}
+
+	__m256 Exp2(__m256 x)
+	{
+		x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(-126.f)), _mm256_set1_ps(127.f));
+		const __m256 whole{ _mm256_floor_ps(x) };
+		const __m256 fraction{ _mm256_sub_ps(x, whole) };
+		const __m256i exponent{ _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(whole), _mm256_set1_epi32(127)), 23) };
+
+		__m256 polynomial{ _mm256_set1_ps(exp2Coefficients[5]) };
+		for (int i{ 4 }; i >= 0; --i)
+		{
+			polynomial = _mm256_fmadd_ps(polynomial, fraction, _mm256_set1_ps(exp2Coefficients[i]));
+		}
+		return _mm256_mul_ps(polynomial, _mm256_castsi256_ps(exponent));
+	}
+
+	__m256 Dot(__m256 ax, __m256 ay, __m256 az, __m256 bx, __m256 by, __m256 bz)
+	{
+		return _mm256_fmadd_ps(ax, bx, _mm256_fmadd_ps(ay, by, _mm256_mul_ps(az, bz)));
+	}
+
+	void Normalize(__m256& x, __m256& y, __m256& z)
+	{
+		const __m256 inverseLength{ _mm256_div_ps(_mm256_set1_ps(1.f), _mm256_sqrt_ps(Dot(x, y, z, x, y, z))) };
+		x = _mm256_mul_ps(x, inverseLength);
+		y = _mm256_mul_ps(y, inverseLength);
+		z = _mm256_mul_ps(z, inverseLength);
+	}
+#else
+	float Log2(float x)
+	{
+		uint32_t bits{};
+		std::memcpy(&bits, &x, sizeof(bits));
+		const float exponent{ static_cast<float>(static_cast<int32_t>(bits >> 23) - 127) };
+		bits = (bits & 0x007FFFFF) | 0x3F800000;
+		float mantissa{};
+		std::memcpy(&mantissa, &bits, sizeof(mantissa));
+
+		float polynomial{ log2Coefficients[4] };
+		for (int i{ 3 }; i >= 0; --i)
+		{
+			polynomial = polynomial * mantissa + log2Coefficients[i];
+		}
+		return polynomial * (mantissa - 1.f) + exponent;
+	}
+
+	float Exp2(float x)
+	{
+		x = std::min(std::max(x, -126.f), 127.f);
+		const float whole{ std::floor(x) };
+		const float fraction{ x - whole };
+		const uint32_t bits{ static_cast<uint32_t>(static_cast<int32_t>(whole) + 127) << 23 };
+		float exponent{};
+		std::memcpy(&exponent, &bits, sizeof(exponent));
+
+		float polynomial{ exp2Coefficients[5] };
+		for (int i{ 4 }; i >= 0; --i)
+		{
+			polynomial = polynomial * fraction + exp2Coefficients[i];
+		}
+		return polynomial * exponent;
+	}
+#endif
+}
+
+PhongPixelShader::PhongPixelShader(std::shared_ptr<Texture> pDiffuse, std::shared_ptr<Texture> pNormalMap, std::shared_ptr<Texture> pSpecularGlossinessMap)
+	: m_pDiffuse(std::move(pDiffuse))
+	, m_pNormalMap(std::move(pNormalMap))
+	, m_pSpecularGlossinessMap(std::move(pSpecularGlossinessMap))
+{
+}
+
+DiffusePixelShader::DiffusePixelShader(std::shared_ptr<Texture> pDiffuse)
+	: m_pDiffuse(std::move(pDiffuse))
+{
+}
+
+void PhongPixelShader::MapNormals(FragmentBatch& batch, const Samples& samples)
+{
+#if defined(__AVX2__)
+	const __m256 one{ _mm256_set1_ps(1.f) };
+	const __m256 two{ _mm256_set1_ps(2.f) };
+	const __m256 zero{ _mm256_setzero_ps() };
+
+	// Like the shader the binormal uses the tangent before it is normalized, and the normal is not normalized at all
+	const __m256 normalX{ _mm256_load_ps(batch.normalX) };
+	const __m256 normalY{ _mm256_load_ps(batch.normalY) };
+	const __m256 normalZ{ _mm256_load_ps(batch.normalZ) };
+	__m256 tangentX{ _mm256_load_ps(batch.tangentX) };
+	__m256 tangentY{ _mm256_load_ps(batch.tangentY) };
+	__m256 tangentZ{ _mm256_load_ps(batch.tangentZ) };
+	__m256 binormalX{ _mm256_fmsub_ps(normalY, tangentZ, _mm256_mul_ps(normalZ, tangentY)) };
+	__m256 binormalY{ _mm256_fmsub_ps(normalZ, tangentX, _mm256_mul_ps(normalX, tangentZ)) };
+	__m256 binormalZ{ _mm256_fmsub_ps(normalX, tangentY, _mm256_mul_ps(normalY, tangentX)) };
+	Normalize(binormalX, binormalY, binormalZ);
+	Normalize(tangentX, tangentY, tangentZ);
+
+	// The normal map only keeps x and y, z is the rest of the unit length
+	const __m256 mapX{ _mm256_fmsub_ps(_mm256_load_ps(samples.normalX), two, one) };
+	const __m256 mapY{ _mm256_fmsub_ps(_mm256_load_ps(samples.normalY), two, one) };
+	const __m256 mapZ{ _mm256_sqrt_ps(_mm256_max_ps(_mm256_fnmadd_ps(mapY, mapY, _mm256_fnmadd_ps(mapX, mapX, one)), zero)) };
+
+	__m256 x{ _mm256_fmadd_ps(mapX, tangentX, _mm256_fmadd_ps(mapY, binormalX, _mm256_mul_ps(mapZ, normalX))) };
+	__m256 y{ _mm256_fmadd_ps(mapX, tangentY, _mm256_fmadd_ps(mapY, binormalY, _mm256_mul_ps(mapZ, normalY))) };
+	__m256 z{ _mm256_fmadd_ps(mapX, tangentZ, _mm256_fmadd_ps(mapY, binormalZ, _mm256_mul_ps(mapZ, normalZ))) };
+	Normalize(x, y, z);
+	_mm256_store_ps(batch.normalX, x);
+	_mm256_store_ps(batch.normalY, y);
+	_mm256_store_ps(batch.normalZ, z);
+#else
+	for (size_t i{ 0 }; i < FragmentBatch::size; ++i)
+	{
+		const Elite::FVector3 normal{ batch.normalX[i], batch.normalY[i], batch.normalZ[i] };
+		const Elite::FVector3 tangent{ batch.tangentX[i], batch.tangentY[i], batch.tangentZ[i] };
+		const Elite::FVector3 binormal{ GetNormalized(Cross(normal, tangent)) };
+
+		const float mapX{ samples.normalX[i] * 2.f - 1.f };
+		const float mapY{ samples.normalY[i] * 2.f - 1.f };
+		const float mapZ{ std::sqrt(std::max(1.f - mapX * mapX - mapY * mapY, 0.f)) };
+		const Elite::FVector3 mappedNormal{ GetNormalized(GetNormalized(tangent) * mapX + binormal * mapY + normal * mapZ) };
+		batch.normalX[i] = mappedNormal.x;
+		batch.normalY[i] = mappedNormal.y;
+		batch.normalZ[i] = mappedNormal.z;
+	}
+#endif
+}
+
+void PhongPixelShader::ShadeBatch(FragmentBatch& batch, const Samples& samples)
+{
+	MapNormals(batch, samples);
+
+#if defined(__AVX2__)
+	const __m256 one{ _mm256_set1_ps(1.f) };
+	const __m256 two{ _mm256_set1_ps(2.f) };
+	const __m256 zero{ _mm256_setzero_ps() };
+	const __m256 lightX{ _mm256_set1_ps(lightDirectionX) };
+	const __m256 lightY{ _mm256_set1_ps(lightDirectionY) };
+	const __m256 lightZ{ _mm256_set1_ps(lightDirectionZ) };
+	const __m256 x{ _mm256_load_ps(batch.normalX) };
+	const __m256 y{ _mm256_load_ps(batch.normalY) };
+	const __m256 z{ _mm256_load_ps(batch.normalZ) };
+
+	const __m256 normalDotLight{ Dot(x, y, z, lightX, lightY, lightZ) };
+	const __m256 observedArea{ _mm256_min_ps(_mm256_max_ps(_mm256_sub_ps(zero, normalDotLight), zero), one) };
+
+	const __m256 twoNormalDotLight{ _mm256_mul_ps(two, normalDotLight) };
+	const __m256 reflectX{ _mm256_fnmadd_ps(twoNormalDotLight, x, lightX) };
+	const __m256 reflectY{ _mm256_fnmadd_ps(twoNormalDotLight, y, lightY) };
+	const __m256 reflectZ{ _mm256_fnmadd_ps(twoNormalDotLight, z, lightZ) };
+	__m256 viewX{ _mm256_load_ps(batch.viewX) };
+	__m256 viewY{ _mm256_load_ps(batch.viewY) };
+	__m256 viewZ{ _mm256_load_ps(batch.viewZ) };
+	Normalize(viewX, viewY, viewZ);
+	const __m256 reflectDotView{ _mm256_andnot_ps(_mm256_set1_ps(-0.f), Dot(reflectX, reflectY, reflectZ, viewX, viewY, viewZ)) };
+	const __m256 exponent{ _mm256_mul_ps(_mm256_load_ps(samples.glossiness), _mm256_set1_ps(shininess)) };
+	const __m256 phong{ _mm256_mul_ps(_mm256_load_ps(samples.specular), Exp2(_mm256_mul_ps(exponent, Log2(reflectDotView)))) };
+
+	const __m256 scale{ _mm256_mul_ps(_mm256_mul_ps(observedArea, _mm256_load_ps(batch.shadow)), _mm256_set1_ps(lightIntensity / pi)) };
+	_mm256_store_ps(batch.red, _mm256_min_ps(_mm256_mul_ps(scale, _mm256_add_ps(_mm256_load_ps(batch.red), phong)), one));
+	_mm256_store_ps(batch.green, _mm256_min_ps(_mm256_mul_ps(scale, _mm256_add_ps(_mm256_load_ps(batch.green), phong)), one));
+	_mm256_store_ps(batch.blue, _mm256_min_ps(_mm256_mul_ps(scale, _mm256_add_ps(_mm256_load_ps(batch.blue), phong)), one));
+#else
+	for (size_t i{ 0 }; i < FragmentBatch::size; ++i)
+	{
+		const Elite::FVector3 mappedNormal{ batch.normalX[i], batch.normalY[i], batch.normalZ[i] };
+		const Elite::FVector3 lightDirection{ lightDirectionX, lightDirectionY, lightDirectionZ };
+		const float normalDotLight{ Dot(mappedNormal, lightDirection) };
+		// In this order a degenerate tangent frame ends up black like in the AVX2 path
+		const float observedArea{ std::max(0.f, std::min(-normalDotLight, 1.f)) };
+
+		const Elite::FVector3 reflect{ lightDirection - 2.f * normalDotLight * mappedNormal };
+		const Elite::FVector3 view{ GetNormalized(Elite::FVector3{ batch.viewX[i], batch.viewY[i], batch.viewZ[i] }) };
+		const float phong{ samples.specular[i] * Exp2(samples.glossiness[i] * shininess * Log2(std::abs(Dot(reflect, view)))) };
+
+		const float scale{ observedArea * batch.shadow[i] * lightIntensity / pi };
+		batch.red[i] = std::min(scale * (batch.red[i] + phong), 1.f);
+		batch.green[i] = std::min(scale * (batch.green[i] + phong), 1.f);
+		batch.blue[i] = std::min(scale * (batch.blue[i] + phong), 1.f);
+	}
+#endif
+}
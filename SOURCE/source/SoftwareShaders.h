@@ -0,0 +1,157 @@
+#pragma once
+#include <algorithm>
+#include <iterator>
+#include <memory>
+
+#include "SoftwareMaterial.h"
+#include "Texture.h"
+
+// Pixel stages for SoftwareEffect
+
+// The constants of PosCol3D.fx, so both renderers and the deferred lighting light the scene the same way
+namespace PosCol3D
+{
+	constexpr float lightDirectionX{ .577f };
+	constexpr float lightDirectionY{ -.577f };
+	constexpr float lightDirectionZ{ .577f };
+	constexpr float pi{ 3.1415f };
+	constexpr float lightIntensity{ 7.f };
+	constexpr float shininess{ 25.f };
+}
+
+// The Phong function of PosCol3D.fx: the normal map bent into the interpolated tangent frame, Lambert with the directional
+// light and a specular highlight with an exponent of glossiness * shininess, clamped to [0, 1]. Both fade with the shadow
+class PhongPixelShader final
+{
+public:
+	static constexpr bool receivesShadows{ true };
+
+	// The specular and glossiness map keeps specular in red and glossiness in green
+	PhongPixelShader(std::shared_ptr<Texture> pDiffuse, std::shared_ptr<Texture> pNormalMap, std::shared_ptr<Texture> pSpecularGlossinessMap);
+
+	template<FilterMode filterMode>
+	void Shade(FragmentBatch& batch) const;
+	// Everything up to the lighting, for the deferred lighting to light later
+	template<FilterMode filterMode>
+	void ShadeSurface(FragmentBatch& batch) const;
+
+private:
+	// Red and green of the normal map, and the specular and glossiness map
+	struct Samples
+	{
+		alignas(32) float normalX[FragmentBatch::size]{};
+		alignas(32) float normalY[FragmentBatch::size]{};
+		alignas(32) float specular[FragmentBatch::size]{};
+		alignas(32) float glossiness[FragmentBatch::size]{};
+	};
+
+	std::shared_ptr<Texture> m_pDiffuse;
+	std::shared_ptr<Texture> m_pNormalMap;
+	std::shared_ptr<Texture> m_pSpecularGlossinessMap;
+
+	// Per pixel, the diffuse color goes to red, green and blue
+	template<FilterMode filterMode>
+	void Sample(FragmentBatch& batch, Samples& samples) const;
+	// The normal map bent into the tangent frame, written over the interpolated normals of all 8 lanes
+	static void MapNormals(FragmentBatch& batch, const Samples& samples);
+	// Everything after the sampling, on all 8 lanes at once. The diffuse color is in red, green and blue
+	static void ShadeBatch(FragmentBatch& batch, const Samples& samples);
+};
+
+// The pixel shader of Exhaust.fx, the diffuse map with its alpha and no lighting. Meant for a blended material
+class DiffusePixelShader final
+{
+public:
+	explicit DiffusePixelShader(std::shared_ptr<Texture> pDiffuse);
+
+	template<FilterMode filterMode>
+	void Shade(FragmentBatch& batch) const;
+
+private:
+	std::shared_ptr<Texture> m_pDiffuse;
+};
+
+// Geometry without a material of its own, the interpolated vertex color
+struct VertexColorPixelShader
+{
+	template<FilterMode filterMode>
+	void Shade(FragmentBatch& batch) const
+	{
+		for (size_t i{ 0 }; i < batch.count; ++i)
+		{
+			const Elite::RGBColor& color{ batch.pFragments[i]->color };
+			batch.red[i] = std::min(color.r, 1.f);
+			batch.green[i] = std::min(color.g, 1.f);
+			batch.blue[i] = std::min(color.b, 1.f);
+		}
+	}
+};
+
+// The depth buffer as gray
+struct DepthPixelShader
+{
+	template<FilterMode filterMode>
+	void Shade(FragmentBatch& batch) const
+	{
+		for (size_t i{ 0 }; i < batch.count; ++i)
+		{
+			batch.red[i] = batch.depth[i];
+			batch.green[i] = batch.depth[i];
+			batch.blue[i] = batch.depth[i];
+		}
+	}
+};
+
+template<FilterMode filterMode>
+void PhongPixelShader::Shade(FragmentBatch& batch) const
+{
+	// Sampling stays per pixel, everything after it runs on the whole batch
+	Samples samples{};
+	Sample<filterMode>(batch, samples);
+	ShadeBatch(batch, samples);
+}
+
+template<FilterMode filterMode>
+void PhongPixelShader::ShadeSurface(FragmentBatch& batch) const
+{
+	Samples samples{};
+	Sample<filterMode>(batch, samples);
+	MapNormals(batch, samples);
+	std::copy(std::begin(samples.specular), std::end(samples.specular), std::begin(batch.specular));
+	std::copy(std::begin(samples.glossiness), std::end(samples.glossiness), std::begin(batch.glossiness));
+}
+
+template<FilterMode filterMode>
+void PhongPixelShader::Sample(FragmentBatch& batch, Samples& samples) const
+{
+	for (size_t i{ 0 }; i < batch.count; ++i)
+	{
+		const Vertex& vertex{ *batch.pFragments[i] };
+		const Elite::RGBColor diffuse{ m_pDiffuse->SampleGrad<AddressMode::Wrap, filterMode>(vertex.uv, vertex.uvDdx, vertex.uvDdy) };
+		const Elite::RGBColor normal{ m_pNormalMap->SampleGrad<AddressMode::Wrap, filterMode>(vertex.uv, vertex.uvDdx, vertex.uvDdy) };
+		const Elite::RGBColor specularGlossiness{ m_pSpecularGlossinessMap->SampleGrad<AddressMode::Wrap, filterMode>(vertex.uv, vertex.uvDdx, vertex.uvDdy) };
+
+		samples.normalX[i] = normal.r;
+		samples.normalY[i] = normal.g;
+		samples.specular[i] = specularGlossiness.r;
+		samples.glossiness[i] = specularGlossiness.g;
+		batch.red[i] = diffuse.r;
+		batch.green[i] = diffuse.g;
+		batch.blue[i] = diffuse.b;
+	}
+}
+
+template<FilterMode filterMode>
+void DiffusePixelShader::Shade(FragmentBatch& batch) const
+{
+	// Clamped like the texture coordinates along the flame in Exhaust.fx
+	for (size_t i{ 0 }; i < batch.count; ++i)
+	{
+		const Vertex& vertex{ *batch.pFragments[i] };
+		const RGBAColor diffuse{ m_pDiffuse->SampleGrad<AddressMode::Clamp, filterMode, RGBAColor>(vertex.uv, vertex.uvDdx, vertex.uvDdy) };
+		batch.red[i] = diffuse.rgb.r;
+		batch.green[i] = diffuse.rgb.g;
+		batch.blue[i] = diffuse.rgb.b;
+		batch.alpha[i] = diffuse.a;
+	}
+}
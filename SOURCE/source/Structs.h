@@ -1,4 +1,9 @@
 #pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
 struct IVertex
 {
 	Elite::FPoint3 pos;
@@ -7,6 +12,15 @@ struct IVertex
 	Elite::FVector3 tangent;
 };
 
+// Vertices and indices owned by someone else, like vectors or a mapped mesh cache, valid as long as the owner is
+struct MeshView
+{
+	const IVertex* pVertices{};
+	size_t vertexCount{};
+	const uint32_t* pIndices{};
+	size_t indexCount{};
+};
+
 struct Vertex
 {
 	Elite::FPoint4 pos{};
@@ -15,4 +29,210 @@ struct Vertex
 	Elite::FVector3 normal{};
 	Elite::FVector3 tangent{};
 	float weight{};
-};
\ No newline at end of file
+	// Change in uv to the next pixel on the right and below, shared by the 2x2 quad of the pixel
+	Elite::FVector2 uvDdx{};
+	Elite::FVector2 uvDdy{};
+};
+
+// Structure-of-arrays vertex storage. Every stream is padded to a multiple of 8 so SIMD kernels can process
+// whole batches; padding entries hold a valid dummy vertex.
+struct VertexStreams
+{
+	static constexpr size_t batchSize{ 8 };
+
+	std::vector<float> x, y, z, w;
+	std::vector<float> u, v;
+	std::vector<float> normalX, normalY, normalZ;
+	std::vector<float> tangentX, tangentY, tangentZ;
+	size_t count{};
+
+	size_t GetPaddedCount() const
+	{
+		return (count + batchSize - 1) / batchSize * batchSize;
+	}
+
+	void Resize(size_t vertexCount)
+	{
+		count = vertexCount;
+		const size_t paddedCount{ GetPaddedCount() };
+		for (std::vector<float>* pStream : { &x, &y, &z, &u, &v, &normalX, &normalY, &normalZ, &tangentX, &tangentY, &tangentZ })
+		{
+			pStream->resize(paddedCount, 0.f);
+		}
+		w.resize(paddedCount, 1.f);
+	}
+
+	void SetVertex(size_t index, const IVertex& vertex)
+	{
+		x[index] = vertex.pos.x;
+		y[index] = vertex.pos.y;
+		z[index] = vertex.pos.z;
+		w[index] = 1.f;
+		u[index] = vertex.uv.x;
+		v[index] = vertex.uv.y;
+		normalX[index] = vertex.normal.x;
+		normalY[index] = vertex.normal.y;
+		normalZ[index] = vertex.normal.z;
+		tangentX[index] = vertex.tangent.x;
+		tangentY[index] = vertex.tangent.y;
+		tangentZ[index] = vertex.tangent.z;
+	}
+
+	void CopyVertex(size_t index, const VertexStreams& source, size_t sourceIndex)
+	{
+		x[index] = source.x[sourceIndex];
+		y[index] = source.y[sourceIndex];
+		z[index] = source.z[sourceIndex];
+		w[index] = source.w[sourceIndex];
+		u[index] = source.u[sourceIndex];
+		v[index] = source.v[sourceIndex];
+		normalX[index] = source.normalX[sourceIndex];
+		normalY[index] = source.normalY[sourceIndex];
+		normalZ[index] = source.normalZ[sourceIndex];
+		tangentX[index] = source.tangentX[sourceIndex];
+		tangentY[index] = source.tangentY[sourceIndex];
+		tangentZ[index] = source.tangentZ[sourceIndex];
+	}
+
+	Vertex GetVertex(size_t index) const
+	{
+		return Vertex{
+			Elite::FPoint4{ x[index], y[index], z[index], w[index] },
+			Elite::RGBColor{ 1.f, 1.f, 1.f },
+			Elite::FVector2{ u[index], v[index] },
+			Elite::FVector3{ normalX[index], normalY[index], normalZ[index] },
+			Elite::FVector3{ tangentX[index], tangentY[index], tangentZ[index] },
+			0
+		};
+	}
+};
+
+// Consecutive vertices or triangles
+struct IndexRange
+{
+	uint32_t first;
+	uint32_t count;
+};
+
+// Output of Geometry::Project for one instance, read back by ShadeVertices, BinTriangles and Rasterize
+struct ProjectedGeometry
+{
+	VertexStreams vertices;
+	// Level of detail of the instance in the previous frame going in, the one Project picked coming out
+	uint32_t lod{};
+	// Vertices the vertex stage still has to shade. No two ranges reach into the same batch of the streams, so different
+	// ranges can be shaded on different threads at once
+	std::vector<IndexRange> vertexRanges;
+	// Triangles that survived culling, in the order they get rasterized
+	std::vector<IndexRange> triangleRanges;
+	// Clusters that survived culling
+	std::vector<uint32_t> visibleClusters;
+	std::vector<uint8_t> clusterVisibility;
+};
+
+// Pixels [firstCol, endCol) on the rows [firstRow, endRow)
+struct ScreenTile
+{
+	uint32_t firstCol;
+	uint32_t firstRow;
+	uint32_t endCol;
+	uint32_t endRow;
+};
+
+// A triangle of one of the draws that are binned together
+struct BinnedTriangle
+{
+	uint32_t draw;
+	uint32_t triangle;
+};
+
+// Triangles sorted into the screen tiles their bounding box overlaps, in the order they were added. Tiles start on even
+// pixels, so no 2x2 quad of the rasterizer reaches into two of them
+struct TileBins
+{
+	static constexpr uint32_t tileSize{ 64 };
+
+	uint32_t width{};
+	uint32_t height{};
+	uint32_t columns{};
+	uint32_t rows{};
+	std::vector<std::vector<BinnedTriangle>> tiles;
+
+	void Resize(uint32_t screenWidth, uint32_t screenHeight)
+	{
+		width = screenWidth;
+		height = screenHeight;
+		columns = (width + tileSize - 1) / tileSize;
+		rows = (height + tileSize - 1) / tileSize;
+		tiles.resize(static_cast<size_t>(columns) * rows);
+	}
+
+	void Clear()
+	{
+		for (std::vector<BinnedTriangle>& tile : tiles)
+		{
+			tile.clear();
+		}
+	}
+
+	ScreenTile GetTile(uint32_t tile) const
+	{
+		const uint32_t firstCol{ tile % columns * tileSize };
+		const uint32_t firstRow{ tile / columns * tileSize };
+		return ScreenTile{ firstCol, firstRow, std::min(firstCol + tileSize, width), std::min(firstRow + tileSize, height) };
+	}
+
+	// The bounding box in screen space covers the pixels from its ceiling up to the ceiling of its end, clamped to the
+	// screen like the rasterizer does
+	void Add(const BinnedTriangle& triangle, float minX, float minY, float maxX, float maxY)
+	{
+		const auto toPixel{ [](float value, uint32_t size)
+			{
+				return static_cast<uint32_t>(std::ceil(std::min(std::max(value, 0.f), static_cast<float>(size) - 1.f)));
+			} };
+		const uint32_t beginCol{ toPixel(minX, width) };
+		const uint32_t endCol{ toPixel(maxX, width) };
+		const uint32_t beginRow{ toPixel(minY, height) };
+		const uint32_t endRow{ toPixel(maxY, height) };
+		if (beginCol >= endCol || beginRow >= endRow)
+		{
+			return;
+		}
+
+		for (uint32_t row{ beginRow / tileSize }; row <= (endRow - 1) / tileSize; ++row)
+		{
+			for (uint32_t col{ beginCol / tileSize }; col <= (endCol - 1) / tileSize; ++col)
+			{
+				tiles[col + row * columns].push_back(triangle);
+			}
+		}
+	}
+};
+
+struct RasterizerState
+{
+	bool frontToBack{ true };
+	bool useLods{ true };
+	// Set per draw from its blend mode, blended geometry tests depth without writing it and is seen from both sides
+	bool depthWrite{ true };
+	bool cullBackFaces{ true };
+
+	uint64_t testedFragments{};
+	uint64_t rejectedFragments{};
+
+	uint64_t drawnInstances{};
+	uint64_t culledInstances{};
+	uint64_t culledGeometries{};
+
+	uint64_t drawnTriangles{};
+	uint64_t savedTriangles{};
+
+	uint64_t drawnClusters{};
+	uint64_t frustumCulledClusters{};
+	uint64_t backfaceCulledClusters{};
+
+	uint64_t lightTiles{};
+	uint64_t tileLights{};
+	uint64_t depthTriangles{};
+	uint64_t renderedFrames{};
+};
@@ -1,25 +1,644 @@
 #include "pch.h"
 #include "Texture.h"
 
-#include "MathFunctions.h"
+#include <atomic>
+#include <cstring>
 
-Texture::Texture(const std::string& path, ID3D11Device* pDevice)
+#include "BlockCompression.h"
+#include "MappedFile.h"
+
+namespace
+{
+	constexpr uint32_t ddsMagic{ 0x20534444 };
+	constexpr uint32_t ddsFourCCFlag{ 0x4 };
+	constexpr uint32_t ddsMipMapCountFlag{ 0x20000 };
+	constexpr uint32_t ddsCubemapFlag{ 0x200 };
+	constexpr uint32_t ddsVolumeFlag{ 0x200000 };
+	constexpr uint32_t dx10Texture2D{ 3 };
+	constexpr size_t ddsHeaderSize{ 128 };
+	constexpr size_t dx10HeaderSize{ 20 };
+	constexpr uint8_t ktx2Identifier[12]{ 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+	constexpr size_t ktx2HeaderSize{ 80 };
+	constexpr size_t ktx2LevelSize{ 24 };
+
+	std::atomic<uint64_t> nextTextureId{ 1 };
+
+	constexpr uint32_t MakeFourCC(char a, char b, char c, char d)
+	{
+		return static_cast<uint32_t>(static_cast<uint8_t>(a)) | (static_cast<uint32_t>(static_cast<uint8_t>(b)) << 8)
+			| (static_cast<uint32_t>(static_cast<uint8_t>(c)) << 16) | (static_cast<uint32_t>(static_cast<uint8_t>(d)) << 24);
+	}
+
+	template<typename Type>
+	Type Read(const char* pData, size_t offset)
+	{
+		Type value{};
+		memcpy(&value, pData + offset, sizeof(Type));
+		return value;
+	}
+
+	bool HasExtension(const std::string& path, const std::string& extension)
+	{
+		return path.size() >= extension.size() && path.compare(path.size() - extension.size(), extension.size(), extension) == 0;
+	}
+
+	// The BC formats a .dds file can hold, from the four character code of old files or the DXGI format of a DX10 header
+	bool GetDDSFormat(uint32_t fourCC, uint32_t dxgiFormat, TextureFormat& format)
+	{
+		if (fourCC == MakeFourCC('D', 'X', 'T', '1') || dxgiFormat == DXGI_FORMAT_BC1_UNORM)
+			format = TextureFormat::BC1;
+		else if (fourCC == MakeFourCC('D', 'X', 'T', '5') || dxgiFormat == DXGI_FORMAT_BC3_UNORM)
+			format = TextureFormat::BC3;
+		else if (fourCC == MakeFourCC('A', 'T', 'I', '1') || fourCC == MakeFourCC('B', 'C', '4', 'U') || dxgiFormat == DXGI_FORMAT_BC4_UNORM)
+			format = TextureFormat::BC4;
+		else if (fourCC == MakeFourCC('A', 'T', 'I', '2') || fourCC == MakeFourCC('B', 'C', '5', 'U') || dxgiFormat == DXGI_FORMAT_BC5_UNORM)
+			format = TextureFormat::BC5;
+		else
+			return false;
+		return true;
+	}
+
+	// The BC formats a .ktx2 file can hold, by their VkFormat
+	bool GetKTX2Format(uint32_t vkFormat, TextureFormat& format)
+	{
+		switch (vkFormat)
+		{
+		case 131: // VK_FORMAT_BC1_RGB_UNORM_BLOCK
+		case 133: // VK_FORMAT_BC1_RGBA_UNORM_BLOCK
+			format = TextureFormat::BC1;
+			return true;
+		case 137: // VK_FORMAT_BC3_UNORM_BLOCK
+			format = TextureFormat::BC3;
+			return true;
+		case 139: // VK_FORMAT_BC4_UNORM_BLOCK
+			format = TextureFormat::BC4;
+			return true;
+		case 141: // VK_FORMAT_BC5_UNORM_BLOCK
+			format = TextureFormat::BC5;
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	// Bilinear sample of an RGBA32 surface, x and y in texels from the center of the first one, clamped to the edges
+	uint32_t SampleSurface(const SDL_Surface* pSurface, float x, float y)
+	{
+		x = std::clamp(x, 0.f, static_cast<float>(pSurface->w - 1));
+		y = std::clamp(y, 0.f, static_cast<float>(pSurface->h - 1));
+		const int x0{ static_cast<int>(x) };
+		const int y0{ static_cast<int>(y) };
+		const int x1{ std::min(x0 + 1, pSurface->w - 1) };
+		const int y1{ std::min(y0 + 1, pSurface->h - 1) };
+		const float fx{ x - static_cast<float>(x0) };
+		const float fy{ y - static_cast<float>(y0) };
+		const auto getRow{ [pSurface](int row) { return reinterpret_cast<const uint32_t*>(static_cast<const uint8_t*>(pSurface->pixels) + row * pSurface->pitch); } };
+		const uint32_t* pRow0{ getRow(y0) };
+		const uint32_t* pRow1{ getRow(y1) };
+
+		uint32_t result{};
+		for (uint32_t shift{ 0 }; shift < 32; shift += 8)
+		{
+			const auto channel{ [shift](uint32_t texel) { return static_cast<float>((texel >> shift) & 0xFF); } };
+			const float top{ channel(pRow0[x0]) + (channel(pRow0[x1]) - channel(pRow0[x0])) * fx };
+			const float bottom{ channel(pRow1[x0]) + (channel(pRow1[x1]) - channel(pRow1[x0])) * fx };
+			result |= static_cast<uint32_t>(top + (bottom - top) * fy + .5f) << shift;
+		}
+		return result;
+	}
+
+	DXGI_FORMAT GetDXGIFormat(TextureFormat format)
+	{
+		switch (format)
+		{
+		case TextureFormat::R8:
+			return DXGI_FORMAT_R8_UNORM;
+		case TextureFormat::RG8:
+			return DXGI_FORMAT_R8G8_UNORM;
+		case TextureFormat::BC1:
+			return DXGI_FORMAT_BC1_UNORM;
+		case TextureFormat::BC3:
+			return DXGI_FORMAT_BC3_UNORM;
+		case TextureFormat::BC4:
+			return DXGI_FORMAT_BC4_UNORM;
+		case TextureFormat::BC5:
+			return DXGI_FORMAT_BC5_UNORM;
+		default:
+			return DXGI_FORMAT_R8G8B8A8_UNORM;
+		}
+	}
+}
+
+Texture::Texture(const std::string& path, ID3D11Device* pDevice, TextureResidency residency, TextureFormat format)
+	: m_Path(path)
+	, m_Id(nextTextureId++)
+	, m_Format(format)
+{
+	AddResidency(residency, pDevice);
+}
+
+Texture::Texture(const std::vector<std::string>& channelPaths, ID3D11Device* pDevice, TextureResidency residency, TextureFormat format)
+	: m_Path(GetPackedPath(channelPaths))
+	, m_ChannelPaths(channelPaths)
+	, m_Id(nextTextureId++)
+	, m_Format(format)
+{
+	AddResidency(residency, pDevice);
+}
+
+Texture::~Texture()
+{
+	if (m_pTextureResourceView != nullptr)
+		m_pTextureResourceView->Release();
+
+	if (m_pTexture != nullptr)
+		m_pTexture->Release();
+
+}
+
+void Texture::AddResidency(TextureResidency residency, ID3D11Device* pDevice)
+{
+	const bool needsCpu{ HasResidency(residency, TextureResidency::Cpu) && !HasResidency(m_Residency, TextureResidency::Cpu) };
+	const bool needsGpu{ HasResidency(residency, TextureResidency::Gpu) && !HasResidency(m_Residency, TextureResidency::Gpu) };
+	if ((!needsCpu && !needsGpu) || (m_Texels.empty() && !LoadTexels()))
+		return;
+
+	if (needsGpu && CreateResourceView(pDevice))
+		m_Residency = m_Residency | TextureResidency::Gpu;
+	if (needsCpu)
+		m_Residency = m_Residency | TextureResidency::Cpu;
+
+	// The decoded texels are only kept around for the software samplers
+	if (!HasResidency(m_Residency, TextureResidency::Cpu))
+	{
+		m_Texels.clear();
+		m_Texels.shrink_to_fit();
+	}
+}
+
+TextureResidency Texture::GetResidency() const
+{
+	return m_Residency;
+}
+
+size_t Texture::GetCpuMemory() const
+{
+	return m_Texels.size() * sizeof(uint32_t);
+}
+
+size_t Texture::GetGpuMemory() const
+{
+	if (!m_pTexture)
+		return 0;
+
+	size_t memory{ 0 };
+	for (const MipLevel& level : m_MipLevels)
+	{
+		memory += GetLevelPitch(level) * GetLevelRowCount(level);
+	}
+	return memory;
+}
+
+TextureFormat Texture::GetFormat() const
+{
+	return m_Format;
+}
+
+std::string Texture::GetPackedPath(const std::vector<std::string>& channelPaths)
+{
+	std::string path{};
+	for (const std::string& channelPath : channelPaths)
+	{
+		path += path.empty() ? channelPath : "|" + channelPath;
+	}
+	return path;
+}
+
+void Texture::SetBorderColor(uint32_t borderColor)
+{
+	m_BorderColor = borderColor;
+}
+
+void Texture::SetMaxAnisotropy(uint32_t maxAnisotropy)
+{
+	m_MaxAnisotropy = std::max(maxAnisotropy, 1u);
+}
+
+int Texture::GetWidth() const
+{
+	return m_Width;
+}
+
+int Texture::GetHeight() const
+{
+	return m_Height;
+}
+
+uint32_t Texture::GetMipLevelCount() const
+{
+	return static_cast<uint32_t>(m_MipLevels.size());
+}
+
+bool Texture::LoadTexels()
+{
+	if (!HasExtension(m_Path, ".dds") && !HasExtension(m_Path, ".ktx2"))
+		return LoadImageTexels();
+
+	const MappedFile file{ m_Path };
+	if (!file.IsOpen())
+	{
+		std::cout << "Error opening texture with path: " << m_Path << std::endl;
+		return false;
+	}
+
+	const bool isLoaded{ HasExtension(m_Path, ".dds") ? LoadDDS(file.GetData(), file.GetSize()) : LoadKTX2(file.GetData(), file.GetSize()) };
+	if (!isLoaded)
+	{
+		std::cout << "Error reading block compressed texture with path: " << m_Path << std::endl;
+		m_MipLevels.clear();
+		m_Texels.clear();
+	}
+	return isLoaded;
+}
+
+bool Texture::LoadImageTexels()
+{
+	// The mip chain is built from the texels before they are compressed
+	const TextureFormat format{ m_Format };
+	m_Format = TextureFormat::RGBA8;
+
+	const bool isPacked{ !m_ChannelPaths.empty() };
+	const size_t imageCount{ isPacked ? std::min(m_ChannelPaths.size(), size_t{ 4 }) : 1 };
+	int surfaceWidth{};
+	int surfaceHeight{};
+	for (size_t image{ 0 }; image < imageCount; ++image)
+	{
+		SDL_Surface* pSurface{ LoadSurface(isPacked ? m_ChannelPaths[image] : m_Path) };
+		if (pSurface == nullptr || (image > 0 && (pSurface->w != surfaceWidth || pSurface->h != surfaceHeight)))
+		{
+			if (pSurface != nullptr)
+				std::cout << "Error packing texture with a different size, path: " << m_ChannelPaths[image] << std::endl;
+			SDL_FreeSurface(pSurface);
+			m_Format = format;
+			m_MipLevels.clear();
+			m_Texels.clear();
+			return false;
+		}
+
+		if (image == 0)
+		{
+			// DirectX only takes BC textures that are whole 4x4 blocks at full size. Other sizes are resampled up to the next
+			// whole block, which keeps the texture coordinates where padding the image would stretch them
+			surfaceWidth = pSurface->w;
+			surfaceHeight = pSurface->h;
+			const bool isWholeBlocks{ (surfaceWidth & 3) == 0 && (surfaceHeight & 3) == 0 };
+			m_Width = IsBlockCompressed(format) && !isWholeBlocks ? (surfaceWidth + 3) & ~3 : surfaceWidth;
+			m_Height = IsBlockCompressed(format) && !isWholeBlocks ? (surfaceHeight + 3) & ~3 : surfaceHeight;
+			InitMipLevels();
+			// Packed channels start at 0 with an opaque alpha that the fourth image can replace
+			if (isPacked)
+				std::fill(m_Texels.begin(), m_Texels.end(), 0xFF000000);
+		}
+
+		const MipLevel& fullSize{ m_MipLevels.front() };
+		const uint32_t shift{ static_cast<uint32_t>(image) * 8 };
+		const bool isResampled{ m_Width != surfaceWidth || m_Height != surfaceHeight };
+		const float scaleX{ static_cast<float>(surfaceWidth) / static_cast<float>(m_Width) };
+		const float scaleY{ static_cast<float>(surfaceHeight) / static_cast<float>(m_Height) };
+		SDL_LockSurface(pSurface);
+		for (int row{ 0 }; row < m_Height; ++row)
+		{
+			const size_t rowIndex{ GetRowIndex(fullSize, row) };
+			const uint32_t* pRow{ isResampled ? nullptr :
+				reinterpret_cast<const uint32_t*>(static_cast<const uint8_t*>(pSurface->pixels) + row * pSurface->pitch) };
+			if (!isPacked && !isResampled)
+			{
+				// A row of a tile is 4 texels in a row of the surface too
+				for (int col{ 0 }; col < m_Width; col += 4)
+				{
+					memcpy(&m_Texels[rowIndex + GetColumnIndex(col)], pRow + col, static_cast<size_t>(std::min(m_Width - col, 4)) * sizeof(uint32_t));
+				}
+			}
+			else
+			{
+				for (int col{ 0 }; col < m_Width; ++col)
+				{
+					const uint32_t source{ isResampled ?
+						SampleSurface(pSurface, (static_cast<float>(col) + .5f) * scaleX - .5f, (static_cast<float>(row) + .5f) * scaleY - .5f) : pRow[col] };
+					uint32_t& texel{ m_Texels[rowIndex + GetColumnIndex(col)] };
+					texel = isPacked ? (texel & ~(0xFFu << shift)) | ((source & 0xFF) << shift) : source;
+				}
+			}
+		}
+		SDL_UnlockSurface(pSurface);
+		SDL_FreeSurface(pSurface);
+	}
+
+	for (size_t level{ 1 }; level < m_MipLevels.size(); ++level)
+	{
+		Downsample(m_MipLevels[level - 1], m_MipLevels[level]);
+	}
+
+	Compress(format);
+	return true;
+}
+
+SDL_Surface* Texture::LoadSurface(const std::string& path) const
 {
 	// Load texture with SDL
-	m_pSurface = IMG_Load(path.c_str());
-	if (m_pSurface == nullptr)
+	SDL_Surface* pLoaded{ IMG_Load(path.c_str()) };
+	if (pLoaded == nullptr)
 	{
 		std::cout << "Error creating SDL_Surface with path: " << path << std::endl;
+		return nullptr;
+	}
+
+	// Whatever the file holds, the samplers and DXGI_FORMAT_R8G8B8A8_UNORM get RGBA bytes
+	SDL_Surface* pSurface{ SDL_ConvertSurfaceFormat(pLoaded, SDL_PIXELFORMAT_RGBA32, 0) };
+	SDL_FreeSurface(pLoaded);
+	if (pSurface == nullptr || pSurface->w <= 0 || pSurface->h <= 0)
+	{
+		std::cout << "Error converting SDL_Surface with path: " << path << std::endl;
+		SDL_FreeSurface(pSurface);
+		return nullptr;
+	}
+	return pSurface;
+}
+
+bool Texture::LoadDDS(const char* pData, size_t size)
+{
+	if (size < ddsHeaderSize || Read<uint32_t>(pData, 0) != ddsMagic)
+		return false;
+
+	const uint32_t flags{ Read<uint32_t>(pData, 8) };
+	const uint32_t height{ Read<uint32_t>(pData, 12) };
+	const uint32_t width{ Read<uint32_t>(pData, 16) };
+	const uint32_t mipMapCount{ Read<uint32_t>(pData, 28) };
+	const uint32_t pixelFormatFlags{ Read<uint32_t>(pData, 80) };
+	const uint32_t fourCC{ Read<uint32_t>(pData, 84) };
+	const uint32_t caps2{ Read<uint32_t>(pData, 112) };
+	if ((pixelFormatFlags & ddsFourCCFlag) == 0 || (caps2 & (ddsCubemapFlag | ddsVolumeFlag)) != 0)
+		return false;
+
+	size_t offset{ ddsHeaderSize };
+	uint32_t dxgiFormat{ DXGI_FORMAT_UNKNOWN };
+	if (fourCC == MakeFourCC('D', 'X', '1', '0'))
+	{
+		if (size < ddsHeaderSize + dx10HeaderSize || Read<uint32_t>(pData, 132) != dx10Texture2D || Read<uint32_t>(pData, 140) > 1)
+			return false;
+		dxgiFormat = Read<uint32_t>(pData, 128);
+		offset += dx10HeaderSize;
+	}
+	if (!GetDDSFormat(fourCC, dxgiFormat, m_Format) || width == 0 || height == 0 || width > INT32_MAX || height > INT32_MAX)
+		return false;
+
+	// Levels follow each other, full size first
+	m_Width = static_cast<int>(width);
+	m_Height = static_cast<int>(height);
+	InitMipLevels((flags & ddsMipMapCountFlag) != 0 && mipMapCount > 0 ? mipMapCount : 1);
+	for (const MipLevel& level : m_MipLevels)
+	{
+		const size_t levelSize{ GetLevelPitch(level) * GetLevelRowCount(level) };
+		if (size - offset < levelSize)
+			return false;
+		LoadBlocks(level, pData + offset);
+		offset += levelSize;
+	}
+	return true;
+}
+
+bool Texture::LoadKTX2(const char* pData, size_t size)
+{
+	if (size < ktx2HeaderSize || memcmp(pData, ktx2Identifier, sizeof(ktx2Identifier)) != 0)
+		return false;
+
+	const uint32_t vkFormat{ Read<uint32_t>(pData, 12) };
+	const uint32_t width{ Read<uint32_t>(pData, 20) };
+	const uint32_t height{ Read<uint32_t>(pData, 24) };
+	const uint32_t depth{ Read<uint32_t>(pData, 28) };
+	const uint32_t layerCount{ Read<uint32_t>(pData, 32) };
+	const uint32_t faceCount{ Read<uint32_t>(pData, 36) };
+	const uint32_t levelCount{ std::max(Read<uint32_t>(pData, 40), 1u) };
+	const uint32_t supercompressionScheme{ Read<uint32_t>(pData, 44) };
+	if (!GetKTX2Format(vkFormat, m_Format) || width == 0 || height == 0 || width > INT32_MAX || height > INT32_MAX || depth != 0
+		|| layerCount > 1 || faceCount != 1 || supercompressionScheme != 0 || size < ktx2HeaderSize + levelCount * ktx2LevelSize)
+		return false;
+
+	// The level index has the offset of every level in the file, full size first
+	m_Width = static_cast<int>(width);
+	m_Height = static_cast<int>(height);
+	InitMipLevels(levelCount);
+	for (size_t i{ 0 }; i < m_MipLevels.size(); ++i)
+	{
+		const uint64_t levelOffset{ Read<uint64_t>(pData, ktx2HeaderSize + i * ktx2LevelSize) };
+		const uint64_t levelSize{ Read<uint64_t>(pData, ktx2HeaderSize + i * ktx2LevelSize + 8) };
+		if (levelOffset > size || size - levelOffset < levelSize || levelSize < GetLevelPitch(m_MipLevels[i]) * GetLevelRowCount(m_MipLevels[i]))
+			return false;
+		LoadBlocks(m_MipLevels[i], pData + levelOffset);
+	}
+	return true;
+}
+
+void Texture::LoadBlocks(const MipLevel& level, const char* pData)
+{
+	// A row of blocks in the file is a row of tiles here, so it goes in with one copy
+	const size_t pitch{ GetLevelPitch(level) };
+	for (int y{ 0 }; y < level.height; y += 4)
+	{
+		memcpy(&m_Texels[(GetRowIndex(level, y) >> 4) << GetTileShift(m_Format)], pData + static_cast<size_t>(y / 4) * pitch, pitch);
+	}
+}
+
+void Texture::InitMipLevels(size_t maxLevelCount)
+{
+	m_MipLevels.clear();
+	size_t offset{ 0 };
+	int width{ m_Width };
+	int height{ m_Height };
+	while (true)
+	{
+		MipLevel level{ width, height, 2, (width & (width - 1)) == 0 ? width - 1 : 0, (height & (height - 1)) == 0 ? height - 1 : 0, offset };
+		while ((1 << level.pitchShift) < width)
+			++level.pitchShift;
+		m_MipLevels.push_back(level);
+		// Whole tiles, so every level starts on a cache line
+		offset += static_cast<size_t>((height + 3) & ~3) << level.pitchShift;
+
+		if ((width == 1 && height == 1) || m_MipLevels.size() == maxLevelCount)
+			break;
+		width = std::max(width / 2, 1);
+		height = std::max(height / 2, 1);
+	}
+	m_Texels.assign((offset >> 4) << GetTileShift(m_Format), 0);
+}
+
+void Texture::Downsample(const MipLevel& source, const MipLevel& destination)
+{
+	// Box filter over the 2x2 source texels of every destination texel, sizes halve rounding down like on the GPU
+	// so an odd size leaves out its last row or column.
+	// Two channels at a time in the halves of a 32 bit word, rounded to nearest
+	const auto average{ [](uint32_t a, uint32_t b, uint32_t c, uint32_t d)
+		{
+			const uint32_t redBlue{ (a & 0x00FF00FF) + (b & 0x00FF00FF) + (c & 0x00FF00FF) + (d & 0x00FF00FF) + 0x00020002 };
+			const uint32_t greenAlpha{ ((a >> 8) & 0x00FF00FF) + ((b >> 8) & 0x00FF00FF) + ((c >> 8) & 0x00FF00FF) + ((d >> 8) & 0x00FF00FF) + 0x00020002 };
+			return ((redBlue >> 2) & 0x00FF00FF) | (((greenAlpha >> 2) & 0x00FF00FF) << 8);
+		} };
+
+	for (int y{ 0 }; y < destination.height; ++y)
+	{
+		const size_t topRow{ GetRowIndex(source, std::min(y * 2, source.height - 1)) };
+		const size_t bottomRow{ GetRowIndex(source, std::min(y * 2 + 1, source.height - 1)) };
+		const size_t destinationRow{ GetRowIndex(destination, y) };
+
+		int x{ 0 };
+#if defined(__AVX2__)
+		// Two destination texels from the four source texels of a tile row, widened to 16 bits per channel
+		const __m128i rounding{ _mm_set1_epi16(2) };
+		for (; x * 2 + 4 <= source.width && x + 2 <= destination.width; x += 2)
+		{
+			const __m128i top{ _mm_load_si128(reinterpret_cast<const __m128i*>(&m_Texels[topRow + GetColumnIndex(x * 2)])) };
+			const __m128i bottom{ _mm_load_si128(reinterpret_cast<const __m128i*>(&m_Texels[bottomRow + GetColumnIndex(x * 2)])) };
+			const __m128i left{ _mm_add_epi16(_mm_cvtepu8_epi16(top), _mm_cvtepu8_epi16(bottom)) };
+			const __m128i right{ _mm_add_epi16(_mm_cvtepu8_epi16(_mm_srli_si128(top, 8)), _mm_cvtepu8_epi16(_mm_srli_si128(bottom, 8))) };
+			__m128i sum{ _mm_add_epi16(_mm_unpacklo_epi64(left, right), _mm_unpackhi_epi64(left, right)) };
+			sum = _mm_srli_epi16(_mm_add_epi16(sum, rounding), 2);
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(&m_Texels[destinationRow + GetColumnIndex(x)]), _mm_packus_epi16(sum, sum));
+		}
+#endif
+		for (; x < destination.width; ++x)
+		{
+			const int left{ std::min(x * 2, source.width - 1) };
+			const int right{ std::min(x * 2 + 1, source.width - 1) };
+			m_Texels[destinationRow + GetColumnIndex(x)] = average(m_Texels[topRow + GetColumnIndex(left)], m_Texels[topRow + GetColumnIndex(right)],
+				m_Texels[bottomRow + GetColumnIndex(left)], m_Texels[bottomRow + GetColumnIndex(right)]);
+		}
+	}
+}
+
+void Texture::Compress(TextureFormat format)
+{
+	if (format == TextureFormat::RGBA8)
 		return;
+
+	const uint32_t tileShift{ GetTileShift(format) };
+	std::vector<uint32_t, CacheLineAllocator<uint32_t>> blocks((m_Texels.size() >> 4) << tileShift, 0);
+	if (!IsBlockCompressed(format))
+	{
+		// The low bytes of every texel, red first, in the place of the texel
+		const size_t texelSize{ GetTexelSize(format) };
+		uint8_t* pNarrowed{ reinterpret_cast<uint8_t*>(blocks.data()) };
+		for (size_t i{ 0 }; i < m_Texels.size(); ++i)
+		{
+			for (size_t channel{ 0 }; channel < texelSize; ++channel)
+			{
+				pNarrowed[i * texelSize + channel] = static_cast<uint8_t>(m_Texels[i] >> (channel * 8));
+			}
+		}
+		m_Texels = std::move(blocks);
+		m_Format = format;
+		return;
+	}
+
+	for (const MipLevel& level : m_MipLevels)
+	{
+		for (int y{ 0 }; y < level.height; y += 4)
+		{
+			for (int x{ 0 }; x < level.width; x += 4)
+			{
+				// Texels past the edge of a level repeat the last row or column, so they do not pull the endpoints away
+				uint32_t texels[16]{};
+				for (int i{ 0 }; i < 16; ++i)
+				{
+					texels[i] = m_Texels[GetRowIndex(level, std::min(y + i / 4, level.height - 1)) + GetColumnIndex(std::min(x + i % 4, level.width - 1))];
+				}
+
+				uint8_t* pBlock{ reinterpret_cast<uint8_t*>(&blocks[((GetRowIndex(level, y) + GetColumnIndex(x)) >> 4) << tileShift]) };
+				switch (format)
+				{
+				case TextureFormat::BC1:
+					EncodeBC1Block(texels, pBlock);
+					break;
+				case TextureFormat::BC3:
+					EncodeBC3Block(texels, pBlock);
+					break;
+				case TextureFormat::BC4:
+					EncodeBC4Block(texels, pBlock);
+					break;
+				default:
+					EncodeBC5Block(texels, pBlock);
+					break;
+				}
+			}
+		}
 	}
+	m_Texels = std::move(blocks);
+	m_Format = format;
+}
+
+void Texture::DecodeTile(size_t tile, uint32_t* pTexels) const
+{
+	const uint8_t* pBlock{ reinterpret_cast<const uint8_t*>(&m_Texels[tile << GetTileShift(m_Format)]) };
+	switch (m_Format)
+	{
+	case TextureFormat::BC1:
+		DecodeBC1Block(pBlock, pTexels);
+		break;
+	case TextureFormat::BC3:
+		DecodeBC3Block(pBlock, pTexels);
+		break;
+	case TextureFormat::BC4:
+		DecodeBC4Block(pBlock, pTexels);
+		break;
+	default:
+		DecodeBC5Block(pBlock, pTexels);
+		break;
+	}
+}
 
+uint32_t Texture::GetTileShift(TextureFormat format)
+{
+	switch (format)
+	{
+	case TextureFormat::BC1:
+	case TextureFormat::BC4:
+		return 1;
+	case TextureFormat::R8:
+	case TextureFormat::BC3:
+	case TextureFormat::BC5:
+		return 2;
+	case TextureFormat::RG8:
+		return 3;
+	default:
+		return 4;
+	}
+}
+
+size_t Texture::GetTexelSize(TextureFormat format)
+{
+	return (sizeof(uint32_t) << GetTileShift(format)) / 16;
+}
+
+size_t Texture::GetLevelPitch(const MipLevel& level) const
+{
+	if (!IsBlockCompressed(m_Format))
+		return static_cast<size_t>(level.width) * GetTexelSize(m_Format);
+	return static_cast<size_t>((level.width + 3) / 4) * (sizeof(uint32_t) << GetTileShift(m_Format));
+}
+
+size_t Texture::GetLevelRowCount(const MipLevel& level) const
+{
+	return static_cast<size_t>(IsBlockCompressed(m_Format) ? (level.height + 3) / 4 : level.height);
+}
+
+bool Texture::CreateResourceView(ID3D11Device* pDevice)
+{
 	// Make texture description
 	D3D11_TEXTURE2D_DESC desc{};
-	desc.Width = m_pSurface->w;
-	desc.Height = m_pSurface->h;
-	desc.MipLevels = 1;
+	desc.Width = static_cast<UINT>(m_Width);
+	desc.Height = static_cast<UINT>(m_Height);
+	desc.MipLevels = static_cast<UINT>(m_MipLevels.size());
 	desc.ArraySize = 1;
-	desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	desc.Format = GetDXGIFormat(m_Format);
 	desc.SampleDesc.Count = 1;
 	desc.SampleDesc.Quality = 0;
 	desc.Usage = D3D11_USAGE_DEFAULT;
@@ -27,62 +646,66 @@ Texture::Texture(const std::string& path, ID3D11Device* pDevice)
 	desc.CPUAccessFlags = 0;
 	desc.MiscFlags = 0;
 
-	D3D11_SUBRESOURCE_DATA initData;
-	initData.pSysMem = m_pSurface->pixels;
-	initData.SysMemPitch = static_cast<UINT>(m_pSurface->pitch);
-	initData.SysMemSlicePitch = static_cast<UINT>(m_pSurface->h * m_pSurface->pitch);
+	// The whole mip chain goes up, so the MIP_LINEAR and ANISOTROPIC samplers of the effects have levels to pick from.
+	// DirectX takes rows of texels or of blocks, so the tiles are undone into one buffer for all levels
+	const uint8_t* pTexels{ reinterpret_cast<const uint8_t*>(m_Texels.data()) };
+	const size_t texelSize{ GetTexelSize(m_Format) };
+	std::vector<uint8_t> rows{};
+	std::vector<size_t> rowOffsets{};
+	for (const MipLevel& level : m_MipLevels)
+	{
+		rowOffsets.push_back(rows.size());
+		for (int y{ 0 }; y < level.height; ++y)
+		{
+			const size_t rowIndex{ GetRowIndex(level, y) };
+			if (!IsBlockCompressed(m_Format))
+			{
+				for (int x{ 0 }; x < level.width; x += 4)
+				{
+					const uint8_t* pRow{ pTexels + (rowIndex + GetColumnIndex(x)) * texelSize };
+					rows.insert(rows.end(), pRow, pRow + static_cast<size_t>(std::min(level.width - x, 4)) * texelSize);
+				}
+			}
+			else if ((y & 3) == 0)
+			{
+				const uint8_t* pBlocks{ pTexels + (((rowIndex >> 4) << GetTileShift(m_Format)) * sizeof(uint32_t)) };
+				rows.insert(rows.end(), pBlocks, pBlocks + GetLevelPitch(level));
+			}
+		}
+	}
+
+	std::vector<D3D11_SUBRESOURCE_DATA> initData(m_MipLevels.size());
+	for (size_t i{ 0 }; i < m_MipLevels.size(); ++i)
+	{
+		initData[i].pSysMem = &rows[rowOffsets[i]];
+		initData[i].SysMemPitch = static_cast<UINT>(GetLevelPitch(m_MipLevels[i]));
+		initData[i].SysMemSlicePitch = static_cast<UINT>(GetLevelPitch(m_MipLevels[i]) * GetLevelRowCount(m_MipLevels[i]));
+	}
 
-	HRESULT result = pDevice->CreateTexture2D(&desc, &initData, &m_pTexture);
+	HRESULT result = pDevice->CreateTexture2D(&desc, initData.data(), &m_pTexture);
 	if (FAILED(result))
 	{
-		std::cout << "Error creating Texture with path: " << path << std::endl;
-		return;
+		std::cout << "Error creating Texture with path: " << m_Path << std::endl;
+		return false;
 	}
 
 	D3D11_SHADER_RESOURCE_VIEW_DESC SRVDesc{};
 	SRVDesc.Format = desc.Format;
 	SRVDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-	SRVDesc.Texture2D.MipLevels = 1;
+	SRVDesc.Texture2D.MipLevels = desc.MipLevels;
 
 	result = pDevice->CreateShaderResourceView(m_pTexture, &SRVDesc, &m_pTextureResourceView);
 	if (FAILED(result))
 	{
-		std::cout << "Error creating TextureResourceView with path: " << path << std::endl;
-		return;
-	}
-
-	
-}
-
-Texture::~Texture()
-{
-	if (m_pTextureResourceView != nullptr)
-		m_pTextureResourceView->Release();
-
-	if (m_pTexture != nullptr)
+		std::cout << "Error creating TextureResourceView with path: " << m_Path << std::endl;
 		m_pTexture->Release();
-
-	SDL_FreeSurface(m_pSurface);
+		m_pTexture = nullptr;
+		return false;
+	}
+	return true;
 }
 
 ID3D11ShaderResourceView* Texture::GetTextureResourceView() const
 {
 	return m_pTextureResourceView;
 }
-
-Elite::RGBColor Texture::Sample(const Elite::FVector2& uv) const
-{
-	Uint8 r, g, b;
-	SDL_GetRGB(
-		static_cast<Uint32*>(m_pSurface->pixels)
-		[
-			PixelToBufferIndex
-			(
-				static_cast<int>(uv.x * static_cast<float>(m_pSurface->w)),
-				static_cast<int>(uv.y * static_cast<float>(m_pSurface->h)),
-				m_pSurface->w)
-		],
-		m_pSurface->format,
-		&r, &g, &b);
-	return Elite::RGBColor{ static_cast<float>(r) / 255.f, static_cast<float>(g) / 255.f, static_cast<float>(b) / 255.f };
-}
@@ -1,20 +1,528 @@
 #pragma once
 #include <SDL_image.h>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <new>
 #include <string>
+#include <type_traits>
+#include <vector>
 #include "ERGBColor.h"
 #include "EMath.h"
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// Where the pixels of a texture are kept, Cpu for the software sampler and Gpu for the DirectX materials
+enum class TextureResidency : uint8_t
+{
+	None = 0,
+	Cpu = 1 << 0,
+	Gpu = 1 << 1,
+	CpuAndGpu = Cpu | Gpu
+};
+
+inline TextureResidency operator|(TextureResidency a, TextureResidency b)
+{
+	return static_cast<TextureResidency>(static_cast<uint8_t>(a) | static_cast<uint8_t>(b));
+}
+
+inline bool HasResidency(TextureResidency residency, TextureResidency flag)
+{
+	return (static_cast<uint8_t>(residency) & static_cast<uint8_t>(flag)) == static_cast<uint8_t>(flag);
+}
+
+// What the samplers do with texel coordinates outside the texture
+enum class AddressMode : uint8_t
+{
+	Wrap,
+	Clamp,
+	Border
+};
+
+// How the samplers pick between mip levels, Point takes the nearest level and Linear blends the two around the level of detail
+enum class MipFilter : uint8_t
+{
+	Point,
+	Linear
+};
+
+// Cycled with the F key, picks the technique of the effects and the software sampler
+enum class FilterMode
+{
+	Point = 0,
+	Linear = 1,
+	Anisotropic = 2,
+	EndDoNotUse = 3
+};
+
+// How the texels are kept on the CPU and the GPU. R8 and RG8 only keep the first one or two bytes of every texel.
+// The BC formats store every 4x4 tile as one DXGI_FORMAT_BCn_UNORM block that the samplers decode: BC1 is RGB in 8 bytes,
+// BC3 RGBA in 16, BC4 red in 8 and BC5 red and green in 16. Channels that are not kept sample as 0, alpha as 1
+enum class TextureFormat : uint8_t
+{
+	RGBA8,
+	R8,
+	RG8,
+	BC1,
+	BC3,
+	BC4,
+	BC5
+};
+
+// Samples with the alpha channel, for the samplers that get it as their Color
+struct RGBAColor
+{
+	Elite::RGBColor rgb{};
+	float a{};
+
+	RGBAColor operator+(const RGBAColor& other) const { return RGBAColor{ rgb + other.rgb, a + other.a }; }
+	RGBAColor operator*(float scale) const { return RGBAColor{ rgb * scale, a * scale }; }
+	RGBAColor& operator+=(const RGBAColor& other) { rgb += other.rgb; a += other.a; return *this; }
+};
+
+// Starts every allocation on a cache line, so a 64 byte block of texels is exactly one line
+template<typename Type>
+struct CacheLineAllocator
+{
+	using value_type = Type;
+	static constexpr std::align_val_t alignment{ 64 };
+
+	CacheLineAllocator() = default;
+	template<typename Other>
+	CacheLineAllocator(const CacheLineAllocator<Other>&) {}
+
+	Type* allocate(size_t count)
+	{
+		return static_cast<Type*>(::operator new(count * sizeof(Type), alignment));
+	}
+	void deallocate(Type* pData, size_t)
+	{
+		::operator delete(pData, alignment);
+	}
+
+	template<typename Other>
+	bool operator==(const CacheLineAllocator<Other>&) const { return true; }
+	template<typename Other>
+	bool operator!=(const CacheLineAllocator<Other>&) const { return false; }
+};
+
 class Texture final
 {
 public:
-	explicit Texture(const std::string& path, ID3D11Device* pDevice);
+	// Images are compressed to format while loading, .dds and .ktx2 files keep the BC format they are stored in
+	explicit Texture(const std::string& path, ID3D11Device* pDevice, TextureResidency residency = TextureResidency::CpuAndGpu,
+		TextureFormat format = TextureFormat::RGBA8);
+	// Packs grayscale images that are sampled together into the channels of one texture, the first channel of every image
+	// in order from red. All images need the same size
+	explicit Texture(const std::vector<std::string>& channelPaths, ID3D11Device* pDevice,
+		TextureResidency residency = TextureResidency::CpuAndGpu, TextureFormat format = TextureFormat::RGBA8);
+	Texture(const Texture& other) = delete;
+	Texture(Texture&& other) = delete;
+	Texture& operator=(const Texture& other) = delete;
+	Texture& operator=(Texture&& other) = delete;
 	~Texture();
 
+	TextureResidency GetResidency() const;
+	size_t GetCpuMemory() const;
+	size_t GetGpuMemory() const;
+	TextureFormat GetFormat() const;
+	// Stands in for the path of a packed texture, in messages and as the key of the texture cache
+	static std::string GetPackedPath(const std::vector<std::string>& channelPaths);
+
+	// Needs Gpu residency
 	ID3D11ShaderResourceView* GetTextureResourceView() const;
-	Elite::RGBColor Sample(const Elite::FVector2& uv) const;
+	// Samplers need Cpu residency, texel centers are at half integer uv * size like on the GPU
+	// Sample and SamplePoint always read the full size level. Every sampler returns RGBAColor as Color with the alpha channel
+	template<AddressMode addressMode = AddressMode::Wrap, typename Color = Elite::RGBColor>
+	Color Sample(const Elite::FVector2& uv) const;
+	template<AddressMode addressMode = AddressMode::Wrap, typename Color = Elite::RGBColor>
+	Color SamplePoint(const Elite::FVector2& uv) const;
+	// Bilinear within the levels, lod 0 is the full size level
+	template<AddressMode addressMode = AddressMode::Wrap, MipFilter mipFilter = MipFilter::Linear, typename Color = Elite::RGBColor>
+	Color SampleLevel(const Elite::FVector2& uv, float lod) const;
+	// The footprint comes from how far the uv moves to the next pixel on the right and below, filtered like the sampler
+	// states of the effects: Point is MIN_MAG_MIP_POINT, Linear is MIN_MAG_MIP_LINEAR and Anisotropic takes up to the max
+	// anisotropy trilinear samples along the long axis of the footprint
+	template<AddressMode addressMode = AddressMode::Wrap, FilterMode filterMode = FilterMode::Linear, typename Color = Elite::RGBColor>
+	Color SampleGrad(const Elite::FVector2& uv, const Elite::FVector2& uvDdx, const Elite::FVector2& uvDdy) const;
+	float CalcLod(const Elite::FVector2& uvDdx, const Elite::FVector2& uvDdy) const;
+
+	// Returned by AddressMode::Border outside the texture, as RGBA8
+	void SetBorderColor(uint32_t borderColor);
+	// Most samples FilterMode::Anisotropic takes, footprints that are longer get blurred along their long axis instead
+	void SetMaxAnisotropy(uint32_t maxAnisotropy);
+	int GetWidth() const;
+	int GetHeight() const;
+	uint32_t GetMipLevelCount() const;
 
 private:
-	SDL_Surface* m_pSurface{ nullptr };
+	struct MipLevel
+	{
+		int width;
+		int height;
+		// Width padded to a power of two of at least one tile, a row of tiles is 4 << pitchShift texels
+		uint32_t pitchShift;
+		// Size - 1 for power of two sizes, which wrap with a mask instead of a modulo
+		int wrapMaskX;
+		int wrapMaskY;
+		size_t offset;
+	};
+
+	// Decoded tiles of the BC formats, every thread has its own so samplers never wait on each other. Direct mapped on a hash
+	// of the key, which is the id of the texture over the index of the tile
+	struct DecodedTileCache
+	{
+		static constexpr size_t size{ 128 };
+		uint64_t keys[size];
+		alignas(64) uint32_t texels[size][16];
+	};
+
+	const std::string m_Path;
+	// Only set for packed textures
+	const std::vector<std::string> m_ChannelPaths{};
+	// Tells the tiles of this texture apart from those of every other one in the decoded tile caches, never 0
+	const uint64_t m_Id;
+	TextureResidency m_Residency{ TextureResidency::None };
+	TextureFormat m_Format;
+	int m_Width{};
+	int m_Height{};
+	uint32_t m_BorderColor{ 0 };
+	uint32_t m_MaxAnisotropy{ 16 };
+
+	// RGBA8 texels of every mip level back to back, red in the lowest byte. Every level is stored in 4x4 tiles of one cache
+	// line each, so the texels of a bilinear sample or a step along v are mostly in the same line. The tiles and the texels
+	// within a tile are laid out row by row. The BC formats keep one block of 2 or 4 words per tile in the same order, the
+	// offsets and indices of the levels still count texels. R8 and RG8 narrow every texel where it is, so the index of a
+	// texel is the index of its byte or its pair of bytes
+	std::vector<uint32_t, CacheLineAllocator<uint32_t>> m_Texels{};
+	// Full size first, down to 1x1, kept when the texels are dropped
+	std::vector<MipLevel> m_MipLevels{};
+
 	ID3D11Texture2D* m_pTexture{ nullptr };
 	ID3D11ShaderResourceView* m_pTextureResourceView{ nullptr };
-};
\ No newline at end of file
+
+	// Only called by the constructors, a texture never changes once it is shared and sampled
+	void AddResidency(TextureResidency residency, ID3D11Device* pDevice);
+	bool LoadTexels();
+	bool LoadImageTexels();
+	SDL_Surface* LoadSurface(const std::string& path) const;
+	bool LoadDDS(const char* pData, size_t size);
+	bool LoadKTX2(const char* pData, size_t size);
+	// Copies the blocks of a level from a file, where they are laid out row by row without tiles
+	void LoadBlocks(const MipLevel& level, const char* pData);
+	void InitMipLevels(size_t maxLevelCount = SIZE_MAX);
+	void Downsample(const MipLevel& source, const MipLevel& destination);
+	void Compress(TextureFormat format);
+	bool CreateResourceView(ID3D11Device* pDevice);
+
+	// Words per tile as a shift, 16 texels for RGBA8
+	static uint32_t GetTileShift(TextureFormat format);
+	static bool IsBlockCompressed(TextureFormat format);
+	// Bytes per texel of the formats that are not block compressed
+	static size_t GetTexelSize(TextureFormat format);
+	// Bytes of a level in the layout of DirectX, rows of texels or of blocks
+	size_t GetLevelPitch(const MipLevel& level) const;
+	size_t GetLevelRowCount(const MipLevel& level) const;
+
+	// The index of a texel is the sum of a row and a column part, neighbouring texels share one of them
+	static size_t GetRowIndex(const MipLevel& level, int y);
+	static size_t GetColumnIndex(int x);
+	template<AddressMode addressMode>
+	static bool Address(int& coordinate, int size, int wrapMask);
+	uint32_t GetTexel(size_t index) const;
+	const uint32_t* GetDecodedTile(size_t tile) const;
+	void DecodeTile(size_t tile, uint32_t* pTexels) const;
+	static DecodedTileCache& GetDecodedTileCache();
+	template<AddressMode addressMode>
+	uint32_t Fetch(const MipLevel& level, int x, int y) const;
+	template<typename Color>
+	static Color MakeColor(float r, float g, float b, float a);
+	template<AddressMode addressMode, typename Color>
+	Color SampleNearest(const MipLevel& level, const Elite::FVector2& uv) const;
+	template<AddressMode addressMode, typename Color>
+	Color SampleBilinear(const MipLevel& level, const Elite::FVector2& uv) const;
+	template<AddressMode addressMode, typename Color>
+	Color SampleAnisotropic(const Elite::FVector2& uv, const Elite::FVector2& uvDdx, const Elite::FVector2& uvDdy) const;
+	static float Log2(float value);
+};
+
+inline size_t Texture::GetRowIndex(const MipLevel& level, int y)
+{
+	return level.offset + (static_cast<size_t>(y >> 2) << (level.pitchShift + 2)) + (static_cast<size_t>(y & 3) << 2);
+}
+
+inline size_t Texture::GetColumnIndex(int x)
+{
+	return (static_cast<size_t>(x >> 2) << 4) + static_cast<size_t>(x & 3);
+}
+
+inline Texture::DecodedTileCache& Texture::GetDecodedTileCache()
+{
+	static thread_local DecodedTileCache cache{};
+	return cache;
+}
+
+inline const uint32_t* Texture::GetDecodedTile(size_t tile) const
+{
+	DecodedTileCache& cache{ GetDecodedTileCache() };
+	const uint64_t key{ (m_Id << 40) | tile };
+	const size_t slot{ static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> 57) };
+	if (cache.keys[slot] != key)
+	{
+		DecodeTile(tile, cache.texels[slot]);
+		cache.keys[slot] = key;
+	}
+	return cache.texels[slot];
+}
+
+inline bool Texture::IsBlockCompressed(TextureFormat format)
+{
+	// The BC formats come last
+	return format >= TextureFormat::BC1;
+}
+
+inline uint32_t Texture::GetTexel(size_t index) const
+{
+	switch (m_Format)
+	{
+	case TextureFormat::RGBA8:
+		return m_Texels[index];
+	case TextureFormat::R8:
+		return 0xFF000000 | reinterpret_cast<const uint8_t*>(m_Texels.data())[index];
+	case TextureFormat::RG8:
+	{
+		uint16_t texel{};
+		memcpy(&texel, reinterpret_cast<const uint8_t*>(m_Texels.data()) + index * sizeof(texel), sizeof(texel));
+		return 0xFF000000 | texel;
+	}
+	default:
+		return GetDecodedTile(index >> 4)[index & 15];
+	}
+}
+
+template<AddressMode addressMode>
+bool Texture::Address(int& coordinate, int size, int wrapMask)
+{
+	switch (addressMode)
+	{
+	case AddressMode::Wrap:
+		if (wrapMask != 0)
+		{
+			coordinate &= wrapMask;
+		}
+		else
+		{
+			coordinate %= size;
+			coordinate += coordinate < 0 ? size : 0;
+		}
+		return true;
+	case AddressMode::Clamp:
+		coordinate = std::min(std::max(coordinate, 0), size - 1);
+		return true;
+	default:
+		return coordinate >= 0 && coordinate < size;
+	}
+}
+
+template<AddressMode addressMode>
+uint32_t Texture::Fetch(const MipLevel& level, int x, int y) const
+{
+	if (!Address<addressMode>(x, level.width, level.wrapMaskX) || !Address<addressMode>(y, level.height, level.wrapMaskY))
+		return m_BorderColor;
+	return GetTexel(GetRowIndex(level, y) + GetColumnIndex(x));
+}
+
+template<AddressMode addressMode, typename Color>
+Color Texture::SamplePoint(const Elite::FVector2& uv) const
+{
+	return SampleNearest<addressMode, Color>(m_MipLevels.front(), uv);
+}
+
+template<AddressMode addressMode, typename Color>
+Color Texture::Sample(const Elite::FVector2& uv) const
+{
+	return SampleBilinear<addressMode, Color>(m_MipLevels.front(), uv);
+}
+
+template<AddressMode addressMode, MipFilter mipFilter, typename Color>
+Color Texture::SampleLevel(const Elite::FVector2& uv, float lod) const
+{
+	lod = std::min(std::max(lod, 0.f), static_cast<float>(m_MipLevels.size() - 1));
+	if (mipFilter == MipFilter::Point)
+		return SampleBilinear<addressMode, Color>(m_MipLevels[static_cast<size_t>(lod + .5f)], uv);
+
+	const size_t level{ static_cast<size_t>(lod) };
+	const float blend{ lod - static_cast<float>(level) };
+	const Color fine{ SampleBilinear<addressMode, Color>(m_MipLevels[level], uv) };
+	if (blend == 0.f)
+		return fine;
+	return fine * (1.f - blend) + SampleBilinear<addressMode, Color>(m_MipLevels[level + 1], uv) * blend;
+}
+
+inline float Texture::Log2(float value)
+{
+	// From the float bits like the level of detail hardware of a GPU, within .005
+	int32_t bits{};
+	memcpy(&bits, &value, sizeof(bits));
+	const int32_t exponent{ ((bits >> 23) & 0xFF) - 127 };
+	bits = (bits & 0x007FFFFF) | 0x3F800000;
+	float mantissa{};
+	memcpy(&mantissa, &bits, sizeof(mantissa));
+	// Exact for powers of two, so steps of whole levels do not blend in the next level
+	return static_cast<float>(exponent) + (mantissa - 1.f) * (5.f / 3.f - mantissa / 3.f);
+}
+
+inline float Texture::CalcLod(const Elite::FVector2& uvDdx, const Elite::FVector2& uvDdy) const
+{
+	// Half the log2 of the longer squared pixel step in texels
+	const float width{ static_cast<float>(m_Width) };
+	const float height{ static_cast<float>(m_Height) };
+	const float stepX{ uvDdx.x * width * uvDdx.x * width + uvDdx.y * height * uvDdx.y * height };
+	const float stepY{ uvDdy.x * width * uvDdy.x * width + uvDdy.y * height * uvDdy.y * height };
+	return .5f * Log2(std::max(std::max(stepX, stepY), FLT_MIN));
+}
+
+template<AddressMode addressMode, FilterMode filterMode, typename Color>
+Color Texture::SampleGrad(const Elite::FVector2& uv, const Elite::FVector2& uvDdx, const Elite::FVector2& uvDdy) const
+{
+	switch (filterMode)
+	{
+	case FilterMode::Point:
+	{
+		const float lod{ std::min(std::max(CalcLod(uvDdx, uvDdy), 0.f), static_cast<float>(m_MipLevels.size() - 1)) };
+		return SampleNearest<addressMode, Color>(m_MipLevels[static_cast<size_t>(lod + .5f)], uv);
+	}
+	case FilterMode::Anisotropic:
+		return SampleAnisotropic<addressMode, Color>(uv, uvDdx, uvDdy);
+	default:
+		return SampleLevel<addressMode, MipFilter::Linear, Color>(uv, CalcLod(uvDdx, uvDdy));
+	}
+}
+
+template<AddressMode addressMode, typename Color>
+Color Texture::SampleAnisotropic(const Elite::FVector2& uv, const Elite::FVector2& uvDdx, const Elite::FVector2& uvDdy) const
+{
+	// The footprint of the pixel is about the parallelogram of the two steps, the longer one is walked with as many samples
+	// as it is longer than the shorter one, each sample taken at the level that fits the width of the footprint
+	const float width{ static_cast<float>(m_Width) };
+	const float height{ static_cast<float>(m_Height) };
+	const float stepX{ uvDdx.x * width * uvDdx.x * width + uvDdx.y * height * uvDdx.y * height };
+	const float stepY{ uvDdy.x * width * uvDdy.x * width + uvDdy.y * height * uvDdy.y * height };
+	const float majorStep{ std::max(std::max(stepX, stepY), FLT_MIN) };
+	const float minorStep{ std::max(std::min(stepX, stepY), FLT_MIN) };
+	const Elite::FVector2& majorAxis{ stepX > stepY ? uvDdx : uvDdy };
+
+	const float ratio{ std::min(std::sqrt(majorStep / minorStep), static_cast<float>(m_MaxAnisotropy)) };
+	const int sampleCount{ static_cast<int>(std::ceil(ratio - .01f)) };
+	const float lod{ .5f * Log2(majorStep / (ratio * ratio)) };
+	if (sampleCount <= 1)
+		return SampleLevel<addressMode, MipFilter::Linear, Color>(uv, lod);
+
+	// Every sample is at the same level of detail, so the two levels are picked once
+	const float clampedLod{ std::min(std::max(lod, 0.f), static_cast<float>(m_MipLevels.size() - 1)) };
+	const size_t level{ static_cast<size_t>(clampedLod) };
+	const float blend{ clampedLod - static_cast<float>(level) };
+	const MipLevel& fineLevel{ m_MipLevels[level] };
+	const MipLevel& coarseLevel{ m_MipLevels[std::min(level + 1, m_MipLevels.size() - 1)] };
+
+	Color fine{};
+	Color coarse{};
+	const float spacing{ 1.f / static_cast<float>(sampleCount) };
+	for (int i{ 0 }; i < sampleCount; ++i)
+	{
+		const float offset{ (static_cast<float>(i) + .5f) * spacing - .5f };
+		const Elite::FVector2 sampleUV{ uv.x + majorAxis.x * offset, uv.y + majorAxis.y * offset };
+		fine += SampleBilinear<addressMode, Color>(fineLevel, sampleUV);
+		if (blend > 0.f)
+			coarse += SampleBilinear<addressMode, Color>(coarseLevel, sampleUV);
+	}
+	return (fine * (1.f - blend) + coarse * blend) * spacing;
+}
+
+template<typename Color>
+Color Texture::MakeColor(float r, float g, float b, float a)
+{
+	if constexpr (std::is_same_v<Color, RGBAColor>)
+		return RGBAColor{ Elite::RGBColor{ r, g, b }, a };
+	else
+		return Color{ r, g, b };
+}
+
+template<AddressMode addressMode, typename Color>
+Color Texture::SampleNearest(const MipLevel& level, const Elite::FVector2& uv) const
+{
+	const uint32_t texel{ Fetch<addressMode>(level, static_cast<int>(std::floor(uv.x * static_cast<float>(level.width))),
+		static_cast<int>(std::floor(uv.y * static_cast<float>(level.height)))) };
+	return MakeColor<Color>(static_cast<float>(texel & 0xFF) / 255.f, static_cast<float>((texel >> 8) & 0xFF) / 255.f,
+		static_cast<float>((texel >> 16) & 0xFF) / 255.f, static_cast<float>(texel >> 24) / 255.f);
+}
+
+template<AddressMode addressMode, typename Color>
+Color Texture::SampleBilinear(const MipLevel& level, const Elite::FVector2& uv) const
+{
+	const float x{ uv.x * static_cast<float>(level.width) - 0.5f };
+	const float y{ uv.y * static_cast<float>(level.height) - 0.5f };
+	const float floorX{ std::floor(x) };
+	const float floorY{ std::floor(y) };
+	const float tx{ x - floorX };
+	const float ty{ y - floorY };
+	int x0{ static_cast<int>(floorX) };
+	int y0{ static_cast<int>(floorY) };
+	int x1{ x0 + 1 };
+	int y1{ y0 + 1 };
+
+	// Every coordinate is addressed once for the two texels that share it, outside ones only matter for Border
+	const bool isInsideX0{ Address<addressMode>(x0, level.width, level.wrapMaskX) };
+	const bool isInsideX1{ Address<addressMode>(x1, level.width, level.wrapMaskX) };
+	const bool isInsideY0{ Address<addressMode>(y0, level.height, level.wrapMaskY) };
+	const bool isInsideY1{ Address<addressMode>(y1, level.height, level.wrapMaskY) };
+	const size_t row0{ GetRowIndex(level, isInsideY0 ? y0 : 0) };
+	const size_t row1{ GetRowIndex(level, isInsideY1 ? y1 : 0) };
+	const size_t column0{ GetColumnIndex(isInsideX0 ? x0 : 0) };
+	const size_t column1{ GetColumnIndex(isInsideX1 ? x1 : 0) };
+
+	// The four texels are mostly in one tile, which the BC formats then look up in the decoded tile cache once
+	size_t tile{ SIZE_MAX };
+	const uint32_t* pTile{ nullptr };
+	const auto fetch{ [&](bool isInside, size_t index)
+		{
+			if (!isInside)
+				return m_BorderColor;
+			if (!IsBlockCompressed(m_Format))
+				return GetTexel(index);
+			if ((index >> 4) != tile)
+			{
+				tile = index >> 4;
+				pTile = GetDecodedTile(tile);
+			}
+			return pTile[index & 15];
+		} };
+	const uint32_t texel00{ fetch(isInsideX0 && isInsideY0, row0 + column0) };
+	const uint32_t texel10{ fetch(isInsideX1 && isInsideY0, row0 + column1) };
+	const uint32_t texel01{ fetch(isInsideX0 && isInsideY1, row1 + column0) };
+	const uint32_t texel11{ fetch(isInsideX1 && isInsideY1, row1 + column1) };
+
+#if defined(__AVX2__)
+	// One texel per register, its four channels widened to floats and weighted in one go
+	const auto widen{ [](uint32_t texel) { return _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(static_cast<int>(texel)))); } };
+	const float scale{ 1.f / 255.f };
+	__m128 color{ _mm_mul_ps(widen(texel00), _mm_set1_ps((1.f - tx) * (1.f - ty) * scale)) };
+	color = _mm_fmadd_ps(widen(texel10), _mm_set1_ps(tx * (1.f - ty) * scale), color);
+	color = _mm_fmadd_ps(widen(texel01), _mm_set1_ps((1.f - tx) * ty * scale), color);
+	color = _mm_fmadd_ps(widen(texel11), _mm_set1_ps(tx * ty * scale), color);
+
+	alignas(16) float channels[4];
+	_mm_store_ps(channels, color);
+	return MakeColor<Color>(channels[0], channels[1], channels[2], channels[3]);
+#else
+	const auto blend{ [&](uint32_t shift)
+		{
+			const float top{ static_cast<float>((texel00 >> shift) & 0xFF) * (1.f - tx) + static_cast<float>((texel10 >> shift) & 0xFF) * tx };
+			const float bottom{ static_cast<float>((texel01 >> shift) & 0xFF) * (1.f - tx) + static_cast<float>((texel11 >> shift) & 0xFF) * tx };
+			return (top * (1.f - ty) + bottom * ty) / 255.f;
+		} };
+	return MakeColor<Color>(blend(0), blend(8), blend(16), std::is_same_v<Color, RGBAColor> ? blend(24) : 1.f);
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,102 @@
+#include "pch.h"
+#include "TextureCache.h"
+
+TextureCache::TextureCache(ID3D11Device* pDevice)
+	: m_pDevice(pDevice)
+{
+}
+
+std::shared_ptr<Texture> TextureCache::GetTexture(const std::string& path, TextureResidency residency, TextureFormat format)
+{
+	return GetOrCreate(path, residency, format, [&](TextureResidency createResidency, TextureFormat createFormat)
+		{
+			return std::make_shared<Texture>(path, m_pDevice, createResidency, createFormat);
+		});
+}
+
+std::shared_ptr<Texture> TextureCache::GetPackedTexture(const std::vector<std::string>& channelPaths, TextureResidency residency,
+	TextureFormat format)
+{
+	return GetOrCreate(Texture::GetPackedPath(channelPaths), residency, format, [&](TextureResidency createResidency, TextureFormat createFormat)
+		{
+			return std::make_shared<Texture>(channelPaths, m_pDevice, createResidency, createFormat);
+		});
+}
+
+size_t TextureCache::GetTextureCount() const
+{
+	size_t count{ 0 };
+	ForEachTexture([&count](const Texture&) { ++count; });
+	return count;
+}
+
+size_t TextureCache::GetCpuMemory() const
+{
+	size_t memory{ 0 };
+	ForEachTexture([&memory](const Texture& texture) { memory += texture.GetCpuMemory(); });
+	return memory;
+}
+
+size_t TextureCache::GetGpuMemory() const
+{
+	size_t memory{ 0 };
+	ForEachTexture([&memory](const Texture& texture) { memory += texture.GetGpuMemory(); });
+	return memory;
+}
+
+template<typename Create>
+std::shared_ptr<Texture> TextureCache::GetOrCreate(const std::string& key, TextureResidency residency, TextureFormat format, Create create)
+{
+	std::shared_ptr<Entry> pEntry{};
+	{
+		const std::lock_guard<std::mutex> lock{ m_Mutex };
+		EraseExpiredEntries();
+		std::shared_ptr<Entry>& pSlot{ m_Entries[key] };
+		if (!pSlot)
+			pSlot = std::make_shared<Entry>();
+		++pSlot->requestCount;
+		pEntry = pSlot;
+	}
+
+	std::shared_ptr<Texture> pTexture{};
+	{
+		// Only requests for the same key wait on each other here
+		const std::lock_guard<std::mutex> lock{ pEntry->mutex };
+		pTexture = pEntry->pTexture.lock();
+		if (!pTexture || !HasResidency(pTexture->GetResidency(), residency))
+		{
+			// Whoever holds the old texture keeps it unchanged until they let go of it
+			pTexture = pTexture ? create(pTexture->GetResidency() | residency, pTexture->GetFormat()) : create(residency, format);
+			pEntry->pTexture = pTexture;
+		}
+	}
+
+	const std::lock_guard<std::mutex> lock{ m_Mutex };
+	--pEntry->requestCount;
+	return pTexture;
+}
+
+void TextureCache::EraseExpiredEntries()
+{
+	// An entry that a request still uses may be loading its texture, which is not in the weak pointer yet
+	for (auto it{ m_Entries.begin() }; it != m_Entries.end();)
+	{
+		if (it->second->requestCount == 0 && it->second->pTexture.expired())
+			it = m_Entries.erase(it);
+		else
+			++it;
+	}
+}
+
+template<typename Function>
+void TextureCache::ForEachTexture(Function function) const
+{
+	const std::lock_guard<std::mutex> lock{ m_Mutex };
+	for (const auto& entry : m_Entries)
+	{
+		const std::lock_guard<std::mutex> entryLock{ entry.second->mutex };
+		const std::shared_ptr<Texture> pTexture{ entry.second->pTexture.lock() };
+		if (pTexture)
+			function(*pTexture);
+	}
+}
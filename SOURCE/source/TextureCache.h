@@ -0,0 +1,54 @@
+#pragma once
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Texture.h"
+
+// Shares one Texture per path between everyone holding a handle to it, the texture is freed with its last handle.
+// Safe to use from several threads, loads of different paths run in parallel.
+class TextureCache final
+{
+public:
+	explicit TextureCache(ID3D11Device* pDevice);
+	TextureCache(const TextureCache& other) = delete;
+	TextureCache(TextureCache&& other) = delete;
+	TextureCache& operator=(const TextureCache& other) = delete;
+	TextureCache& operator=(TextureCache&& other) = delete;
+	~TextureCache() = default;
+
+	// Loads the texture when nobody holds it yet. A held texture is never changed, since it may be sampled already. When it is
+	// not resident everywhere it is asked for, a new texture is loaded with both residencies and in the format of the held
+	// one, and later requests get the new texture. The format only applies to the first load
+	std::shared_ptr<Texture> GetTexture(const std::string& path, TextureResidency residency, TextureFormat format = TextureFormat::RGBA8);
+	// Same for grayscale images packed into the channels of one texture, shared by everyone packing the same paths in order
+	std::shared_ptr<Texture> GetPackedTexture(const std::vector<std::string>& channelPaths, TextureResidency residency,
+		TextureFormat format = TextureFormat::RGBA8);
+
+	size_t GetTextureCount() const;
+	size_t GetCpuMemory() const;
+	size_t GetGpuMemory() const;
+
+private:
+	struct Entry
+	{
+		std::mutex mutex{};
+		std::weak_ptr<Texture> pTexture{};
+		// Requests between finding the entry and returning its texture, guarded by m_Mutex
+		uint32_t requestCount{};
+	};
+
+	ID3D11Device* m_pDevice;
+	mutable std::mutex m_Mutex{};
+	std::unordered_map<std::string, std::shared_ptr<Entry>> m_Entries{};
+
+	// Create takes the residency and the format of the texture to load
+	template<typename Create>
+	std::shared_ptr<Texture> GetOrCreate(const std::string& key, TextureResidency residency, TextureFormat format, Create create);
+	// Entries of textures nobody holds anymore and no request is using, only while m_Mutex is held
+	void EraseExpiredEntries();
+	template<typename Function>
+	void ForEachTexture(Function function) const;
+};
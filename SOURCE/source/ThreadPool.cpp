@@ -0,0 +1,48 @@
+#include "pch.h"
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(size_t threadCount)
+{
+	m_Threads.reserve(threadCount);
+	for (size_t i{ 0 }; i < threadCount; ++i)
+	{
+		m_Threads.emplace_back(&ThreadPool::Work, this);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		const std::lock_guard<std::mutex> lock{ m_Mutex };
+		m_IsStopping = true;
+	}
+	m_TaskAdded.notify_all();
+
+	for (std::thread& thread : m_Threads)
+	{
+		thread.join();
+	}
+}
+
+size_t ThreadPool::GetThreadCount() const
+{
+	return m_Threads.size();
+}
+
+void ThreadPool::Work()
+{
+	while (true)
+	{
+		std::function<void()> task{};
+		{
+			std::unique_lock<std::mutex> lock{ m_Mutex };
+			m_TaskAdded.wait(lock, [this]() { return m_IsStopping || !m_Tasks.empty(); });
+			if (m_Tasks.empty())
+				return;
+
+			task = std::move(m_Tasks.front());
+			m_Tasks.pop_front();
+		}
+		task();
+	}
+}
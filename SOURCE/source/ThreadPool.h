@@ -0,0 +1,54 @@
+#pragma once
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Fixed set of worker threads running submitted tasks in the order they were submitted
+class ThreadPool final
+{
+public:
+	explicit ThreadPool(size_t threadCount = std::max(1u, std::thread::hardware_concurrency()));
+	ThreadPool(const ThreadPool& other) = delete;
+	ThreadPool(ThreadPool&& other) = delete;
+	ThreadPool& operator=(const ThreadPool& other) = delete;
+	ThreadPool& operator=(ThreadPool&& other) = delete;
+	// Finishes every queued task before joining the workers
+	~ThreadPool();
+
+	// A task may wait on the future of a task submitted before it, those are always started first
+	template<typename Function>
+	std::future<std::invoke_result_t<std::decay_t<Function>>> Submit(Function&& function);
+
+	size_t GetThreadCount() const;
+
+private:
+	std::vector<std::thread> m_Threads{};
+	std::deque<std::function<void()>> m_Tasks{};
+	std::mutex m_Mutex{};
+	std::condition_variable m_TaskAdded{};
+	bool m_IsStopping{ false };
+
+	void Work();
+};
+
+template<typename Function>
+std::future<std::invoke_result_t<std::decay_t<Function>>> ThreadPool::Submit(Function&& function)
+{
+	using Result = std::invoke_result_t<std::decay_t<Function>>;
+
+	// std::function needs a copyable target, the task itself can only be moved
+	const auto pTask{ std::make_shared<std::packaged_task<Result()>>(std::forward<Function>(function)) };
+	std::future<Result> future{ pTask->get_future() };
+	{
+		const std::lock_guard<std::mutex> lock{ m_Mutex };
+		m_Tasks.emplace_back([pTask]() { (*pTask)(); });
+	}
+	m_TaskAdded.notify_one();
+	return future;
+}
@@ -0,0 +1,204 @@
+#include "pch.h"
+#include "TiledLighting.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include "SoftwareShaders.h"
+
+namespace
+{
+	// Points into the tile for the two rays it goes through, oriented by a ray through the middle of the tile
+	Elite::FVector3 CalcSideNormal(const Elite::FVector3& rayA, const Elite::FVector3& rayB, const Elite::FVector3& centerRay)
+	{
+		Elite::FVector3 normal{ Cross(rayA, rayB) };
+		if (Dot(normal, centerRay) < 0.f)
+		{
+			normal = -normal;
+		}
+		Normalize(normal);
+		return normal;
+	}
+}
+
+void TiledLighting::SetView(const std::vector<Light>& lights, const Elite::FMatrix4& viewToWorld, const Elite::FMatrix4& projection)
+{
+	m_pLights = &lights;
+	m_Eye = Elite::FPoint3{ viewToWorld[3].xyz };
+	m_Forward = -viewToWorld[2].xyz;
+	m_DepthScale = projection[3].z;
+	m_DepthOffset = projection[2].z;
+}
+
+uint64_t TiledLighting::ShadeTiles(const FragmentTarget& target, uint32_t height, uint32_t firstTileRow, uint32_t endTileRow,
+	std::vector<uint32_t>& tileLights) const
+{
+	const GBuffer& gBuffer{ *target.pGBuffer };
+	const uint32_t tileColumns{ (target.width + tileSize - 1) / tileSize };
+	uint64_t gatheredLights{ 0 };
+	for (uint32_t tileRow{ firstTileRow }; tileRow < endTileRow; ++tileRow)
+	{
+		const uint32_t firstRow{ tileRow * tileSize };
+		const uint32_t endRow{ std::min(firstRow + tileSize, height) };
+		for (uint32_t tileColumn{ 0 }; tileColumn < tileColumns; ++tileColumn)
+		{
+			const uint32_t firstCol{ tileColumn * tileSize };
+			const uint32_t endCol{ std::min(firstCol + tileSize, target.width) };
+
+			// The depth bounds come from the depth buffer alone, a tile of only background has nothing to light
+			float minDepth{ FLT_MAX };
+			float maxDepth{ 0.f };
+			for (uint32_t row{ firstRow }; row < endRow; ++row)
+			{
+				for (uint32_t col{ firstCol }; col < endCol; ++col)
+				{
+					const float depth{ target.pDepthBuffer[col + row * target.width] };
+					if (depth < 1.f)
+					{
+						minDepth = std::min(minDepth, depth);
+						maxDepth = std::max(maxDepth, depth);
+					}
+				}
+			}
+			if (minDepth > maxDepth)
+			{
+				continue;
+			}
+
+			CullLights(target, static_cast<float>(firstCol), static_cast<float>(endCol), static_cast<float>(firstRow), static_cast<float>(endRow),
+				m_DepthScale / (minDepth + m_DepthOffset), m_DepthScale / (maxDepth + m_DepthOffset), tileLights);
+			gatheredLights += tileLights.size();
+
+			for (uint32_t row{ firstRow }; row < endRow; ++row)
+			{
+				for (uint32_t col{ firstCol }; col < endCol; ++col)
+				{
+					const uint32_t pixelIndex{ col + row * target.width };
+					const float depth{ target.pDepthBuffer[pixelIndex] };
+					if (depth >= 1.f)
+					{
+						continue;
+					}
+
+					const uint32_t albedo{ gBuffer.albedo[pixelIndex] };
+					const Elite::RGBColor albedoColor{ static_cast<float>(albedo & 0xFF) / 255.f, static_cast<float>((albedo >> 8) & 0xFF) / 255.f,
+						static_cast<float>((albedo >> 16) & 0xFF) / 255.f };
+					Elite::RGBColor color{ albedoColor };
+					if ((albedo >> 24) != 0)
+					{
+						const uint16_t specularGlossiness{ gBuffer.specularGlossiness[pixelIndex] };
+						const Elite::FVector3 view{ target.viewOrigin + target.viewPerColumn * static_cast<float>(col) + target.viewPerRow * static_cast<float>(row) };
+						const Elite::FVector3 normal{ GBuffer::DecodeNormal(gBuffer.normals[pixelIndex]) };
+						const float viewDepth{ m_DepthScale / (depth + m_DepthOffset) };
+						// Only the mapped normal is left for the offset into the shadow map
+						const float shadow{ target.pShadowMap != nullptr ? target.pShadowMap->Sample(m_Eye + view * viewDepth, normal, viewDepth) : 1.f };
+						color = ShadePixel(albedoColor, normal, static_cast<float>(specularGlossiness & 0xFF) / 255.f,
+							static_cast<float>(specularGlossiness >> 8) / 255.f, view, viewDepth, shadow, tileLights);
+					}
+
+					target.pPixels[pixelIndex] = SDL_MapRGB(target.pFormat,
+						static_cast<Uint8>(std::min(color.r, 1.f) * 255.f),
+						static_cast<Uint8>(std::min(color.g, 1.f) * 255.f),
+						static_cast<Uint8>(std::min(color.b, 1.f) * 255.f));
+				}
+			}
+		}
+	}
+	return gatheredLights;
+}
+
+void TiledLighting::CullLights(const FragmentTarget& target, float firstCol, float endCol, float firstRow, float endRow, float minDepth,
+	float maxDepth, std::vector<uint32_t>& tileLights) const
+{
+	// The four sides of the tile frustum go through the camera and the outer edges of its corner pixels
+	const auto calcRay{ [&target](float col, float row) { return target.viewOrigin + target.viewPerColumn * col + target.viewPerRow * row; } };
+	const Elite::FVector3 topLeft{ calcRay(firstCol - .5f, firstRow - .5f) };
+	const Elite::FVector3 topRight{ calcRay(endCol - .5f, firstRow - .5f) };
+	const Elite::FVector3 bottomLeft{ calcRay(firstCol - .5f, endRow - .5f) };
+	const Elite::FVector3 bottomRight{ calcRay(endCol - .5f, endRow - .5f) };
+	const Elite::FVector3 center{ calcRay((firstCol + endCol) * .5f - .5f, (firstRow + endRow) * .5f - .5f) };
+	const Elite::FVector3 sides[4]
+	{
+		CalcSideNormal(topLeft, bottomLeft, center),
+		CalcSideNormal(topRight, bottomRight, center),
+		CalcSideNormal(topLeft, topRight, center),
+		CalcSideNormal(bottomLeft, bottomRight, center)
+	};
+
+	tileLights.clear();
+	const std::vector<Light>& lights{ *m_pLights };
+	for (uint32_t lightIndex{ 0 }; lightIndex < lights.size(); ++lightIndex)
+	{
+		// Spot lights are tested by the sphere around their whole range, the cone only matters per pixel
+		const Light& light{ lights[lightIndex] };
+		const Elite::FVector3 toLight{ light.position - m_Eye };
+		const float lightDepth{ Dot(toLight, m_Forward) };
+		if (lightDepth + light.range < minDepth || lightDepth - light.range > maxDepth)
+		{
+			continue;
+		}
+		if (Dot(toLight, sides[0]) < -light.range || Dot(toLight, sides[1]) < -light.range || Dot(toLight, sides[2]) < -light.range
+			|| Dot(toLight, sides[3]) < -light.range)
+		{
+			continue;
+		}
+		tileLights.push_back(lightIndex);
+	}
+}
+
+Elite::RGBColor TiledLighting::ShadePixel(const Elite::RGBColor& albedo, const Elite::FVector3& normal, float specular, float glossiness,
+	const Elite::FVector3& view, float viewDepth, float shadow, const std::vector<uint32_t>& tileLights) const
+{
+	using namespace PosCol3D;
+	const Elite::FVector3 viewDirection{ Elite::GetNormalized(view) };
+	const float exponent{ glossiness * shininess };
+
+	// The directional light exactly like the forward pixel stage
+	const Elite::FVector3 lightDirection{ lightDirectionX, lightDirectionY, lightDirectionZ };
+	const float normalDotLight{ Dot(normal, lightDirection) };
+	const float observedArea{ std::max(0.f, std::min(-normalDotLight, 1.f)) };
+	const Elite::FVector3 reflect{ lightDirection - 2.f * normalDotLight * normal };
+	const float phong{ specular * std::pow(std::abs(Dot(reflect, viewDirection)), exponent) };
+	Elite::RGBColor color{ (albedo + Elite::RGBColor{ phong, phong, phong }) * (observedArea * shadow * lightIntensity / pi) };
+
+	// The view ray has a length of 1 along the view direction, so it reaches the surface at the view depth
+	const Elite::FPoint3 position{ m_Eye + view * viewDepth };
+	const std::vector<Light>& lights{ *m_pLights };
+	for (const uint32_t lightIndex : tileLights)
+	{
+		const Light& light{ lights[lightIndex] };
+		const Elite::FVector3 toLight{ light.position - position };
+		const float squaredDistance{ SqrMagnitude(toLight) };
+		const float squaredRange{ light.range * light.range };
+		if (squaredDistance >= squaredRange)
+		{
+			continue;
+		}
+
+		const Elite::FVector3 direction{ toLight / std::sqrt(squaredDistance) };
+		const float normalDotDirection{ Dot(normal, direction) };
+		if (normalDotDirection <= 0.f)
+		{
+			continue;
+		}
+
+		// Inverse square, windowed to reach 0 at the range
+		const float window{ 1.f - (squaredDistance / squaredRange) * (squaredDistance / squaredRange) };
+		float attenuation{ light.intensity * window * window / std::max(squaredDistance, 1e-4f) };
+		if (light.type == LightType::Spot)
+		{
+			const float cone{ std::min(std::max((Dot(-direction, light.direction) - light.cosOuterCone) / (light.cosInnerCone - light.cosOuterCone), 0.f), 1.f) };
+			attenuation *= cone * cone;
+		}
+		if (attenuation <= 0.f)
+		{
+			continue;
+		}
+
+		const Elite::FVector3 lightReflect{ 2.f * normalDotDirection * normal - direction };
+		const float lightPhong{ specular * std::pow(std::max(-Dot(lightReflect, viewDirection), 0.f), exponent) };
+		color += light.color * (albedo + Elite::RGBColor{ lightPhong, lightPhong, lightPhong }) * (attenuation * normalDotDirection / pi);
+	}
+	return color;
+}
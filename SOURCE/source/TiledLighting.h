@@ -0,0 +1,38 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "EMath.h"
+#include "Light.h"
+#include "SoftwareMaterial.h"
+
+// Lights the G-buffer in tiles of 16x16 pixels. Every tile first gathers the lights whose sphere reaches into the part of
+// the view frustum it covers, between the nearest and farthest depth of its pixels, and then lights its pixels with only
+// those. Next to the scene lights every pixel gets the directional light of PosCol3D.fx, like the forward pixel stage, in
+// the shadow map of the target when it has one
+class TiledLighting final
+{
+public:
+	static constexpr uint32_t tileSize{ 16 };
+
+	// Once per frame before ShadeTiles, the lights have to outlive the frame
+	void SetView(const std::vector<Light>& lights, const Elite::FMatrix4& viewToWorld, const Elite::FMatrix4& projection);
+
+	// Lights the tiles on the tile rows into the back buffer of the target, pixels without depth are left alone.
+	// tileLights is scratch space for the lights of one tile. Returns how many lights all tiles together gathered
+	uint64_t ShadeTiles(const FragmentTarget& target, uint32_t height, uint32_t firstTileRow, uint32_t endTileRow,
+		std::vector<uint32_t>& tileLights) const;
+
+private:
+	const std::vector<Light>* m_pLights{};
+	Elite::FPoint3 m_Eye{};
+	Elite::FVector3 m_Forward{};
+	// The depth buffer holds z / w of the projection, view depth is m_DepthScale / (depth + m_DepthOffset)
+	float m_DepthScale{};
+	float m_DepthOffset{};
+
+	void CullLights(const FragmentTarget& target, float firstCol, float endCol, float firstRow, float endRow, float minDepth,
+		float maxDepth, std::vector<uint32_t>& tileLights) const;
+	Elite::RGBColor ShadePixel(const Elite::RGBColor& albedo, const Elite::FVector3& normal, float specular, float glossiness,
+		const Elite::FVector3& view, float viewDepth, float shadow, const std::vector<uint32_t>& tileLights) const;
+};
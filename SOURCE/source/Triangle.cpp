@@ -6,7 +6,7 @@
 #include "EMath.h"
 
 
-bool Triangle::Hit(const FPoint2& pixel, std::vector<Vertex>& vertices)
+bool Triangle::Hit(const FPoint2& pixel, std::array<Vertex, 3>& vertices)
 {
 	FVector2 pixelToVertex{ pixel - vertices[0].pos.xy };
 	FVector3 edge{ vertices[1].pos.xyz - vertices[0].pos.xyz };
@@ -39,3 +39,40 @@ bool Triangle::Hit(const FPoint2& pixel, std::vector<Vertex>& vertices)
 
 	return true;
 }
+
+bool Triangle::Intersect(const Ray& ray, const FPoint3& v0, const FPoint3& v1, const FPoint3& v2, float& distance)
+{
+	// Moller-Trumbore
+	const FVector3 edgeA{ v1 - v0 };
+	const FVector3 edgeB{ v2 - v0 };
+	const FVector3 p{ Cross(ray.direction, edgeB) };
+	const float determinant{ Dot(edgeA, p) };
+	if (std::abs(determinant) < FLT_EPSILON)
+	{
+		return false;
+	}
+
+	const float inverseDeterminant{ 1.f / determinant };
+	const FVector3 originToVertex{ ray.origin - v0 };
+	const float u{ Dot(originToVertex, p) * inverseDeterminant };
+	if (u < 0.f || u > 1.f)
+	{
+		return false;
+	}
+
+	const FVector3 q{ Cross(originToVertex, edgeA) };
+	const float v{ Dot(ray.direction, q) * inverseDeterminant };
+	if (v < 0.f || u + v > 1.f)
+	{
+		return false;
+	}
+
+	const float t{ Dot(edgeB, q) * inverseDeterminant };
+	if (t < 0.f)
+	{
+		return false;
+	}
+
+	distance = t;
+	return true;
+}
@@ -1,12 +1,15 @@
 #pragma once
 #include "Geometry.h"
 #include "Structs.h"
+#include <array>
 
 class Triangle : public Geometry
 {
 public:
 	
-	static bool Hit(const FPoint2& pixel, std::vector<Vertex>& vertices);
+	static bool Hit(const FPoint2& pixel, std::array<Vertex, 3>& vertices);
+	// Two sided, distance is in units of the ray direction
+	static bool Intersect(const Ray& ray, const FPoint3& v0, const FPoint3& v1, const FPoint3& v2, float& distance);
 	
 };
 
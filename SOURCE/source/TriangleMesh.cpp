@@ -3,90 +3,703 @@
 #include "SceneManager.h"
 #include <tuple>
 #include <array>
+#include <numeric>
 
 #include "MathFunctions.h"
 #include "Triangle.h"
+#include "VertexTransform.h"
+#include "SoftwareMaterial.h"
+#include "ShadowMap.h"
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
 
 TriangleMesh::TriangleMesh(const FPoint3& position, const std::vector<IVertex>& vertices, const std::vector<unsigned>& indices, PrimitiveTopology topology)
+	: TriangleMesh(position, CreateData(vertices, indices, topology))
+{
+}
+
+TriangleMesh::TriangleMesh(const FPoint3& position, std::shared_ptr<const TriangleMeshData> pData)
 	: Geometry(position)
-	, m_Indices(indices)
-	, m_Topology(topology)
+	, m_pData(std::move(pData))
+{
+	SetLocalBounds(m_pData->localAABB, m_pData->localBoundingSphere);
+}
+
+std::shared_ptr<const TriangleMeshData> TriangleMesh::CreateData(const std::vector<IVertex>& vertices, const std::vector<unsigned>& indices, PrimitiveTopology topology)
+{
+	AABB bounds{};
+	for (const IVertex& vertex : vertices)
+	{
+		Grow(bounds, vertex.pos);
+	}
+	return CreateData(MeshView{ vertices.data(), vertices.size(), indices.data(), indices.size() }, bounds, topology);
+}
+
+std::shared_ptr<const TriangleMeshData> TriangleMesh::CreateData(const MeshView& mesh, const AABB& bounds, PrimitiveTopology topology)
+{
+	auto pData{ std::make_shared<TriangleMeshData>() };
+	pData->topology = topology;
+
+	TriangleMeshLod& fullDetail{ pData->lods.emplace_back() };
+	fullDetail.indices.assign(mesh.pIndices, mesh.pIndices + mesh.indexCount);
+	fullDetail.vertices.Resize(mesh.vertexCount);
+	for (size_t i{ 0 }; i < mesh.vertexCount; ++i)
+	{
+		fullDetail.vertices.SetVertex(i, mesh.pVertices[i]);
+	}
+
+	pData->localAABB = bounds;
+	pData->localBoundingSphere = CalcBoundingSphere(fullDetail.vertices, pData->localAABB);
+
+	if (topology == PrimitiveTopology::TriangleList)
+	{
+		BuildLods(*pData);
+		for (TriangleMeshLod& lod : pData->lods)
+		{
+			BuildClusters(lod);
+		}
+	}
+	return pData;
+}
+const std::shared_ptr<const TriangleMeshData>& TriangleMesh::GetData() const
 {
-	m_ModelVertices.reserve(vertices.size());
-	for (const IVertex& iVertex : vertices)
+	return m_pData;
+}
+
+bool TriangleMesh::Raycast(const Ray& ray, float& distance) const
+{
+	const TriangleMeshLod& fullDetail{ m_pData->lods.front() };
+	const VertexStreams& modelVertices{ fullDetail.vertices };
+	const auto getModelPosition = [&modelVertices](unsigned int index)
+	{
+		return FPoint3{ modelVertices.x[index], modelVertices.y[index], modelVertices.z[index] };
+	};
+
+	// The ray is moved into model space, an affine transform keeps the distance along the ray the same
+	bool isHit{ false };
+	float closestDistance{ FLT_MAX };
+	for (uint32_t instance{ 0 }; instance < GetInstanceCount(); ++instance)
 	{
-		m_ModelVertices.push_back(
-			Vertex{
-				iVertex.pos,
-				RGBColor{1.f, 1.f, 1.f},
-				FVector2{iVertex.uv.x, iVertex.uv.y},
-				iVertex.normal,
-				iVertex.tangent,
-				0
+		const FMatrix4 worldToModel{ Inverse(GetInstanceTransform(instance)) };
+		const FPoint4 modelOrigin{ worldToModel * FPoint4{ ray.origin } };
+		const FVector4 modelDirection{ worldToModel * FVector4{ ray.direction, 0.f } };
+		const Ray modelRay{ modelOrigin.xyz, modelDirection.xyz };
+
+		float boundsDistance{};
+		if (IsValid(m_pData->localAABB) && !IntersectRay(m_pData->localAABB, modelRay, closestDistance, boundsDistance))
+		{
+			continue;
+		}
+
+		const unsigned int triangleCount{ GetTriangleCount(fullDetail) };
+		for (unsigned int i{ 0 }; i < triangleCount; ++i)
+		{
+			const std::array<unsigned int, 3> indices{ GetTriangleIndices(fullDetail, i) };
+			float hitDistance{};
+			if (Triangle::Intersect(modelRay, getModelPosition(indices[0]), getModelPosition(indices[1]), getModelPosition(indices[2]), hitDistance) &&
+				hitDistance < closestDistance)
+			{
+				closestDistance = hitDistance;
+				isHit = true;
 			}
-		);
+		}
 	}
 
-	m_WorldVertices.insert(m_WorldVertices.end(), m_ModelVertices.begin(), m_ModelVertices.end());
-	CalcWorldVertices();
+	if (isHit)
+	{
+		distance = closestDistance;
+	}
+	return isHit;
 }
 
 std::vector<Vertex> TriangleMesh::GetModelVerts() const
 {
-	return m_ModelVertices;
+	const VertexStreams& modelVertices{ m_pData->lods.front().vertices };
+
+	std::vector<Vertex> vertices{};
+	vertices.reserve(modelVertices.count);
+	for (size_t i{ 0 }; i < modelVertices.count; ++i)
+	{
+		vertices.push_back(modelVertices.GetVertex(i));
+	}
+	return vertices;
 }
 
-void TriangleMesh::Project(std::vector<Vertex>& vertices) const
+void TriangleMesh::Project(uint32_t instance, ProjectedGeometry& projected, RasterizerState& state) const
 {
 	const Scene& activeScene{ SceneManager::GetInstance().GetScene() };
 	const Camera* pCamera{ activeScene.GetCamera() };
+	const FMatrix4 transform{ GetInstanceTransform(instance) };
+	projected.lod = SelectLod(transform, projected.lod, state);
+	const TriangleMeshLod& lod{ m_pData->lods[projected.lod] };
+	const unsigned int triangleCount{ GetTriangleCount(lod) };
+	state.drawnTriangles += triangleCount;
+	state.savedTriangles += GetTriangleCount(m_pData->lods.front()) - triangleCount;
 
-	// Positions
-	TransformVertexPos(pCamera->GetRHProjection() * pCamera->GetRHWorldToView() * GetTransform(), vertices);
-	PerspectiveDivide(vertices);
-	// Vertices now in NDC space
+	projected.vertexRanges.clear();
+	projected.triangleRanges.clear();
+	projected.visibleClusters.clear();
+	projected.vertices.Resize(lod.vertices.count);
+	if (lod.clusters.empty())
+	{
+		// Everything is drawn, still in parts so the stages after this can split a large mesh over threads
+		const uint32_t vertexCount{ static_cast<uint32_t>(lod.vertices.count) };
+		for (uint32_t first{ 0 }; first < vertexCount; first += m_MaxVertexRange)
+		{
+			projected.vertexRanges.push_back(IndexRange{ first, std::min(m_MaxVertexRange, vertexCount - first) });
+		}
+		for (uint32_t first{ 0 }; first < triangleCount; first += m_MaxTriangleRange)
+		{
+			projected.triangleRanges.push_back(IndexRange{ first, std::min(m_MaxTriangleRange, triangleCount - first) });
+		}
+		return;
+	}
 
-	// Normal & Tangent
-	TransformVertexNormals(GetTransform(), vertices);
-	TransformVertexTangents(GetTransform(), vertices);
+	// Only the vertices of clusters that pass the frustum and cone tests get transformed, in memory order with neighbouring
+	// visible clusters merged into one range. The vertex stage widens a range to whole batches, so clusters that reach into
+	// the same batch always end up in the same range
+	projected.clusterVisibility.assign(lod.clusters.size(), 0);
+	const Frustum& frustum{ pCamera->GetRHFrustum() };
+	const FPoint3 cameraPos{ pCamera->GetRHViewToWorld()[3].xyz };
+	constexpr uint32_t batchSize{ VertexStreams::batchSize };
+	for (uint32_t clusterIndex{ 0 }; clusterIndex < lod.clusters.size(); ++clusterIndex)
+	{
+		const TriangleCluster& cluster{ lod.clusters[clusterIndex] };
+		const BoundingSphere worldSphere{ TransformBoundingSphere(transform, cluster.boundingSphere) };
+		if (!IsInsideFrustum(frustum, worldSphere))
+		{
+			++state.frustumCulledClusters;
+			continue;
+		}
+		if (state.cullBackFaces && IsClusterBackFacing(cluster, worldSphere, transform, cameraPos))
+		{
+			++state.backfaceCulledClusters;
+			continue;
+		}
 
-	// Todo: View Direction 
+		projected.clusterVisibility[clusterIndex] = 1;
+		projected.visibleClusters.push_back(clusterIndex);
+		const uint32_t clusterEnd{ cluster.firstVertex + cluster.vertexCount };
+		if (!projected.vertexRanges.empty())
+		{
+			IndexRange& range{ projected.vertexRanges.back() };
+			const uint32_t batchEnd{ (range.first + range.count + batchSize - 1) / batchSize * batchSize };
+			const bool isSharingBatch{ cluster.firstVertex < batchEnd };
+			if (isSharingBatch || (cluster.firstVertex == batchEnd && range.count < m_MaxVertexRange))
+			{
+				range.count = clusterEnd - range.first;
+				continue;
+			}
+		}
+		projected.vertexRanges.push_back(IndexRange{ cluster.firstVertex, cluster.vertexCount });
+	}
+
+	if (state.frontToBack)
+	{
+		for (const uint32_t clusterIndex : lod.clusterOrders[GetViewBucket(lod, transform)])
+		{
+			if (projected.clusterVisibility[clusterIndex])
+			{
+				projected.triangleRanges.push_back(IndexRange{ lod.clusters[clusterIndex].firstTriangle, lod.clusters[clusterIndex].triangleCount });
+			}
+		}
+	}
+	else
+	{
+		for (const uint32_t clusterIndex : projected.visibleClusters)
+		{
+			projected.triangleRanges.push_back(IndexRange{ lod.clusters[clusterIndex].firstTriangle, lod.clusters[clusterIndex].triangleCount });
+		}
+	}
+	state.drawnClusters += projected.visibleClusters.size();
 }
-bool TriangleMesh::Rasterize(std::vector<Vertex>& vertices, std::vector<float>& depthBuffer, std::vector<Vertex>& outVertices) const
+
+void TriangleMesh::ShadeVertices(uint32_t instance, ProjectedGeometry& projected, size_t firstRange, size_t endRange) const
 {
-	unsigned int maxIndex{};
-	switch (m_Topology)
+	const Camera* pCamera{ SceneManager::GetInstance().GetScene().GetCamera() };
+	const FMatrix4 transform{ GetInstanceTransform(instance) };
+	const TriangleMeshLod& lod{ m_pData->lods[projected.lod] };
+
+	// Positions end up in screen space, normals and tangents in world space
+	const FMatrix4 worldViewProjection{ pCamera->GetRHProjection() * pCamera->GetRHWorldToView() * transform };
+	const float screenWidth{ static_cast<float>(pCamera->GetScreenWidth()) };
+	const float screenHeight{ static_cast<float>(pCamera->GetScreenHeight()) };
+
+	// The vertex stage of the material, or the plain transform for geometry without one
+	const SoftwareMaterial* pMaterial{ GetMaterial() };
+	const VertexConstants constants{ worldViewProjection, transform, screenWidth, screenHeight };
+	for (size_t rangeIndex{ firstRange }; rangeIndex < endRange; ++rangeIndex)
 	{
-	case PrimitiveTopology::TriangleList:
-		maxIndex = static_cast<unsigned int>(m_Indices.size()) / 3;
-		break;
-	case PrimitiveTopology::TriangleStrip:
-		maxIndex = static_cast<unsigned int>(m_Indices.size()) - 2;
-		break;
+		const IndexRange& range{ projected.vertexRanges[rangeIndex] };
+		if (pMaterial != nullptr)
+		{
+			pMaterial->ShadeVertices(constants, lod.vertices, projected.vertices, range.first, range.count);
+		}
+		else
+		{
+			TransformVertexRange(worldViewProjection, transform, screenWidth, screenHeight, lod.vertices, projected.vertices, range.first, range.count);
+		}
 	}
+}
 
-	for (unsigned int i{ 0 }; i < maxIndex; ++i)
+void TriangleMesh::BinTriangles(const ProjectedGeometry& projected, size_t firstRange, size_t endRange, uint32_t draw, const RasterizerState& state,
+	TileBins& bins) const
+{
+	const TriangleMeshLod& lod{ m_pData->lods[projected.lod] };
+	const VertexStreams& vertices{ projected.vertices };
+	for (size_t rangeIndex{ firstRange }; rangeIndex < endRange; ++rangeIndex)
 	{
-		std::vector<Vertex> triangleVertices{ GetTriangleVertices(i, vertices) };
-		RasterizeSingleTriangle(triangleVertices, depthBuffer, outVertices);
+		const IndexRange& range{ projected.triangleRanges[rangeIndex] };
+		for (uint32_t triangle{ range.first }; triangle < range.first + range.count; ++triangle)
+		{
+			// Left out for the same reasons RasterizeSingleTriangle would not cover a pixel of them: a corner outside the
+			// depth range, or a back face while those are culled
+			const std::array<unsigned int, 3> indices{ GetTriangleIndices(lod, triangle) };
+			if (!InRange(vertices.z[indices[0]], 0.f, 1.f) || !InRange(vertices.z[indices[1]], 0.f, 1.f) || !InRange(vertices.z[indices[2]], 0.f, 1.f))
+			{
+				continue;
+			}
+			const FPoint2 p0{ vertices.x[indices[0]], vertices.y[indices[0]] };
+			const FPoint2 p1{ vertices.x[indices[1]], vertices.y[indices[1]] };
+			const FPoint2 p2{ vertices.x[indices[2]], vertices.y[indices[2]] };
+			if (state.cullBackFaces && Cross(FVector2{ p1 - p0 }, FVector2{ p2 - p0 }) > 0.f)
+			{
+				continue;
+			}
+
+			bins.Add(BinnedTriangle{ draw, triangle }, std::min(p0.x, std::min(p1.x, p2.x)), std::min(p0.y, std::min(p1.y, p2.y)),
+				std::max(p0.x, std::max(p1.x, p2.x)), std::max(p0.y, std::max(p1.y, p2.y)));
+		}
 	}
+}
 
+bool TriangleMesh::Rasterize(const ProjectedGeometry& projected, const BinnedTriangle* pFirst, const BinnedTriangle* pLast, const ScreenTile& tile,
+	std::vector<float>& depthBuffer, std::vector<Vertex>& outVertices, RasterizerState& state) const
+{
+	const TriangleMeshLod& lod{ m_pData->lods[projected.lod] };
+	for (const BinnedTriangle* pTriangle{ pFirst }; pTriangle < pLast; ++pTriangle)
+	{
+		std::array<Vertex, 3> triangleVertices{ GetTriangleVertices(lod, pTriangle->triangle, projected.vertices) };
+		RasterizeSingleTriangle(triangleVertices, tile, depthBuffer, outVertices, state);
+	}
 	return !outVertices.empty();
 }
 
-void TriangleMesh::CalcWorldVertices()
+void TriangleMesh::RasterizeDepth(uint32_t instance, DepthTarget& target, ProjectedGeometry& projected, RasterizerState& state) const
+{
+	const FMatrix4 transform{ GetInstanceTransform(instance) };
+	const TriangleMeshLod& lod{ m_pData->lods[SelectDepthLod(transform, target.texelSize, state)] };
+	const FMatrix4 worldViewProjection{ target.viewProjection * transform };
+	const float width{ static_cast<float>(target.width) };
+	const float height{ static_cast<float>(target.height) };
+
+	// Only positions get transformed, of the clusters inside the frustum of the target. Both sides of every triangle are
+	// drawn, so the clusters get no cone test
+	projected.visibleClusters.clear();
+	projected.vertices.Resize(lod.vertices.count);
+	if (lod.clusters.empty())
+	{
+		TransformPositionRange(worldViewProjection, width, height, lod.vertices, projected.vertices, 0, lod.vertices.count);
+	}
+	else
+	{
+		uint32_t rangeBegin{ 0 };
+		uint32_t rangeEnd{ 0 };
+		for (uint32_t clusterIndex{ 0 }; clusterIndex < lod.clusters.size(); ++clusterIndex)
+		{
+			const TriangleCluster& cluster{ lod.clusters[clusterIndex] };
+			if (!IsInsideFrustum(target.frustum, TransformBoundingSphere(transform, cluster.boundingSphere)))
+			{
+				continue;
+			}
+
+			projected.visibleClusters.push_back(clusterIndex);
+			if (cluster.firstVertex != rangeEnd)
+			{
+				TransformPositionRange(worldViewProjection, width, height, lod.vertices, projected.vertices, rangeBegin, rangeEnd - rangeBegin);
+				rangeBegin = cluster.firstVertex;
+			}
+			rangeEnd = cluster.firstVertex + cluster.vertexCount;
+		}
+		TransformPositionRange(worldViewProjection, width, height, lod.vertices, projected.vertices, rangeBegin, rangeEnd - rangeBegin);
+	}
+
+	const VertexStreams& vertices{ projected.vertices };
+	const auto rasterizeTriangle{ [&](unsigned int triangle)
+		{
+			// Triangles reaching behind the eye of a perspective target are skipped
+			const std::array<unsigned int, 3> indices{ GetTriangleIndices(lod, triangle) };
+			if (vertices.w[indices[0]] <= 0.f || vertices.w[indices[1]] <= 0.f || vertices.w[indices[2]] <= 0.f)
+			{
+				return;
+			}
+			target.RasterizeTriangle(FPoint3{ vertices.x[indices[0]], vertices.y[indices[0]], vertices.z[indices[0]] },
+				FPoint3{ vertices.x[indices[1]], vertices.y[indices[1]], vertices.z[indices[1]] },
+				FPoint3{ vertices.x[indices[2]], vertices.y[indices[2]], vertices.z[indices[2]] });
+		} };
+
+	if (lod.clusters.empty())
+	{
+		const unsigned int triangleCount{ GetTriangleCount(lod) };
+		for (unsigned int i{ 0 }; i < triangleCount; ++i)
+		{
+			rasterizeTriangle(i);
+		}
+		state.depthTriangles += triangleCount;
+		return;
+	}
+
+	for (const uint32_t clusterIndex : projected.visibleClusters)
+	{
+		const TriangleCluster& cluster{ lod.clusters[clusterIndex] };
+		for (uint32_t i{ cluster.firstTriangle }; i < cluster.firstTriangle + cluster.triangleCount; ++i)
+		{
+			rasterizeTriangle(i);
+		}
+		state.depthTriangles += cluster.triangleCount;
+	}
+}
+
+void TriangleMesh::BuildLods(TriangleMeshData& data)
+{
+	while (data.lods.size() < m_MaxLodAmount)
+	{
+		const TriangleMeshLod& previous{ data.lods.back() };
+		const size_t previousTriangleAmount{ previous.indices.size() / 3 };
+		const size_t targetTriangleAmount{ previousTriangleAmount / 2 };
+		if (targetTriangleAmount < m_MinLodTriangleAmount)
+		{
+			return;
+		}
+
+		float error{};
+		const std::vector<unsigned> simplifiedIndices{ SimplifyMesh(previous.vertices, previous.indices, targetTriangleAmount, error) };
+		// Stop once the simplifier runs out of collapses that keep the shape intact
+		if (simplifiedIndices.size() / 3 > previousTriangleAmount * 3 / 4)
+		{
+			return;
+		}
+
+		TriangleMeshLod lod{};
+		CompactVertices(previous.vertices, simplifiedIndices, lod.vertices, lod.indices);
+		lod.error = previous.error + error;
+		data.lods.push_back(std::move(lod));
+	}
+}
+
+void TriangleMesh::BuildClusters(TriangleMeshLod& lod)
+{
+	const VertexStreams& modelVertices{ lod.vertices };
+	const uint32_t triangleAmount{ static_cast<uint32_t>(lod.indices.size()) / 3 };
+	if (triangleAmount == 0)
+	{
+		return;
+	}
+
+	std::vector<FPoint3> centroids{};
+	centroids.reserve(triangleAmount);
+	std::vector<uint32_t> normalBuckets{};
+	normalBuckets.reserve(triangleAmount);
+	FPoint3 minBounds{ FLT_MAX, FLT_MAX, FLT_MAX };
+	FPoint3 maxBounds{ -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (uint32_t i{ 0 }; i < triangleAmount; ++i)
+	{
+		const unsigned i0{ lod.indices[i * 3] };
+		const unsigned i1{ lod.indices[i * 3 + 1] };
+		const unsigned i2{ lod.indices[i * 3 + 2] };
+		const FPoint3 centroid
+		{
+			(modelVertices.x[i0] + modelVertices.x[i1] + modelVertices.x[i2]) / 3.f,
+			(modelVertices.y[i0] + modelVertices.y[i1] + modelVertices.y[i2]) / 3.f,
+			(modelVertices.z[i0] + modelVertices.z[i1] + modelVertices.z[i2]) / 3.f
+		};
+
+		minBounds = FPoint3{ std::min(minBounds.x, centroid.x), std::min(minBounds.y, centroid.y), std::min(minBounds.z, centroid.z) };
+		maxBounds = FPoint3{ std::max(maxBounds.x, centroid.x), std::max(maxBounds.y, centroid.y), std::max(maxBounds.z, centroid.z) };
+		centroids.push_back(centroid);
+
+		// Normal of the side Triangle::Hit keeps, which is what the cluster cone has to describe
+		const FPoint3 p0{ modelVertices.x[i0], modelVertices.y[i0], modelVertices.z[i0] };
+		const FPoint3 p1{ modelVertices.x[i1], modelVertices.y[i1], modelVertices.z[i1] };
+		const FPoint3 p2{ modelVertices.x[i2], modelVertices.y[i2], modelVertices.z[i2] };
+		const FVector3 normal{ Cross(p1 - p0, p2 - p0) };
+		uint32_t bestBucket{ 0 };
+		for (uint32_t bucket{ 1 }; bucket < TriangleMeshLod::viewBucketAmount; ++bucket)
+		{
+			if (Dot(normal, GetViewBucketDirection(bucket)) > Dot(normal, GetViewBucketDirection(bestBucket)))
+			{
+				bestBucket = bucket;
+			}
+		}
+		normalBuckets.push_back(bestBucket);
+	}
+
+	// Group triangles by the axis their normal is closest to, so the normal cone of a cluster stays narrow enough to cull,
+	// and within a group sort them along a Morton curve so consecutive triangles, and therefore clusters, are spatially compact
+	const FVector3 extent{ maxBounds - minBounds };
+	const auto normalize = [](float value, float minValue, float size) { return size > 0.f ? (value - minValue) / size : 0.f; };
+
+	std::vector<std::pair<uint64_t, uint32_t>> mortonKeys{};
+	mortonKeys.reserve(triangleAmount);
+	for (uint32_t i{ 0 }; i < triangleAmount; ++i)
+	{
+		const FPoint3& centroid{ centroids[i] };
+		const uint32_t mortonCode
+		{
+			MortonCode3D(
+				normalize(centroid.x, minBounds.x, extent.x),
+				normalize(centroid.y, minBounds.y, extent.y),
+				normalize(centroid.z, minBounds.z, extent.z))
+		};
+		mortonKeys.emplace_back(static_cast<uint64_t>(normalBuckets[i]) << 32 | mortonCode, i);
+	}
+	std::sort(mortonKeys.begin(), mortonKeys.end());
+
+	std::vector<unsigned> sortedIndices{};
+	sortedIndices.reserve(lod.indices.size());
+	for (const std::pair<uint64_t, uint32_t>& key : mortonKeys)
+	{
+		sortedIndices.push_back(lod.indices[key.second * 3]);
+		sortedIndices.push_back(lod.indices[key.second * 3 + 1]);
+		sortedIndices.push_back(lod.indices[key.second * 3 + 2]);
+	}
+	lod.indices = std::move(sortedIndices);
+
+	lod.clusters.clear();
+	for (uint32_t i{ 0 }; i < triangleAmount; ++i)
+	{
+		const bool isNewBucket{ i > 0 && normalBuckets[mortonKeys[i].second] != normalBuckets[mortonKeys[i - 1].second] };
+		if (lod.clusters.empty() || isNewBucket || lod.clusters.back().triangleCount == TriangleMeshLod::clusterSize)
+		{
+			TriangleCluster& cluster{ lod.clusters.emplace_back() };
+			cluster.firstTriangle = i;
+		}
+		++lod.clusters.back().triangleCount;
+	}
+
+	// Give every cluster its own contiguous vertex range, vertices shared between clusters are duplicated
+	std::vector<unsigned> sourceVertices{};
+	std::vector<uint32_t> vertexClusters(modelVertices.count, UINT32_MAX);
+	std::vector<unsigned> remap(modelVertices.count);
+	for (uint32_t clusterIndex{ 0 }; clusterIndex < lod.clusters.size(); ++clusterIndex)
+	{
+		TriangleCluster& cluster{ lod.clusters[clusterIndex] };
+		cluster.firstVertex = static_cast<uint32_t>(sourceVertices.size());
+		for (size_t i{ cluster.firstTriangle * 3u }; i < (cluster.firstTriangle + cluster.triangleCount) * 3u; ++i)
+		{
+			const unsigned index{ lod.indices[i] };
+			if (vertexClusters[index] != clusterIndex)
+			{
+				vertexClusters[index] = clusterIndex;
+				remap[index] = static_cast<unsigned>(sourceVertices.size());
+				sourceVertices.push_back(index);
+			}
+			lod.indices[i] = remap[index];
+		}
+		cluster.vertexCount = static_cast<uint32_t>(sourceVertices.size()) - cluster.firstVertex;
+
+		// Vertex cache order inside the cluster, then its vertices renumbered in the new order of first use
+		const auto clusterBegin{ lod.indices.begin() + cluster.firstTriangle * 3u };
+		const auto clusterEnd{ clusterBegin + cluster.triangleCount * 3u };
+		std::vector<uint32_t> clusterIndices{ clusterBegin, clusterEnd };
+		for (uint32_t& index : clusterIndices)
+		{
+			index -= cluster.firstVertex;
+		}
+		clusterIndices = OptimizeVertexCache(clusterIndices, cluster.vertexCount);
+		const std::vector<uint32_t> fetchRemap{ RemapVertexFetch(clusterIndices, cluster.vertexCount) };
+
+		const std::vector<unsigned> clusterSources{ sourceVertices.begin() + cluster.firstVertex, sourceVertices.end() };
+		for (uint32_t i{ 0 }; i < cluster.vertexCount; ++i)
+		{
+			sourceVertices[cluster.firstVertex + fetchRemap[i]] = clusterSources[i];
+		}
+		std::transform(clusterIndices.begin(), clusterIndices.end(), clusterBegin, [&cluster](uint32_t index) { return index + cluster.firstVertex; });
+	}
+
+	VertexStreams clusterVertices{};
+	clusterVertices.Resize(sourceVertices.size());
+	for (size_t i{ 0 }; i < sourceVertices.size(); ++i)
+	{
+		clusterVertices.CopyVertex(i, modelVertices, sourceVertices[i]);
+	}
+	lod.vertices = std::move(clusterVertices);
+
+	for (TriangleCluster& cluster : lod.clusters)
+	{
+		BuildClusterBounds(lod, cluster);
+	}
+
+	lod.clusterCenter = FPoint3{ (minBounds.x + maxBounds.x) / 2.f, (minBounds.y + maxBounds.y) / 2.f, (minBounds.z + maxBounds.z) / 2.f };
+
+	// A camera looking from direction d reaches first the cluster whose nearest triangle has the largest projection on d
+	std::vector<float> nearestDistances(lod.clusters.size());
+	for (uint32_t bucket{ 0 }; bucket < TriangleMeshLod::viewBucketAmount; ++bucket)
+	{
+		const FVector3 direction{ GetViewBucketDirection(bucket) };
+		for (size_t clusterIndex{ 0 }; clusterIndex < lod.clusters.size(); ++clusterIndex)
+		{
+			const TriangleCluster& cluster{ lod.clusters[clusterIndex] };
+			float nearest{ -FLT_MAX };
+			for (uint32_t i{ cluster.firstTriangle }; i < cluster.firstTriangle + cluster.triangleCount; ++i)
+			{
+				nearest = std::max(nearest, Dot(centroids[mortonKeys[i].second] - lod.clusterCenter, direction));
+			}
+			nearestDistances[clusterIndex] = nearest;
+		}
+
+		std::vector<uint32_t>& order{ lod.clusterOrders[bucket] };
+		order.resize(lod.clusters.size());
+		std::iota(order.begin(), order.end(), 0);
+		std::sort(order.begin(), order.end(), [&nearestDistances](uint32_t a, uint32_t b)
+			{
+				return nearestDistances[a] > nearestDistances[b];
+			});
+	}
+}
+
+void TriangleMesh::BuildClusterBounds(TriangleMeshLod& lod, TriangleCluster& cluster)
+{
+	const VertexStreams& modelVertices{ lod.vertices };
+	const auto getModelPosition = [&modelVertices](unsigned int index)
+	{
+		return FPoint3{ modelVertices.x[index], modelVertices.y[index], modelVertices.z[index] };
+	};
+
+	AABB box{};
+	for (uint32_t i{ cluster.firstVertex }; i < cluster.firstVertex + cluster.vertexCount; ++i)
+	{
+		Grow(box, getModelPosition(i));
+	}
+	cluster.boundingSphere = BoundingSphere{ GetCenter(box), 0.f };
+	for (uint32_t i{ cluster.firstVertex }; i < cluster.firstVertex + cluster.vertexCount; ++i)
+	{
+		cluster.boundingSphere.radius = std::max(cluster.boundingSphere.radius, Magnitude(getModelPosition(i) - cluster.boundingSphere.center));
+	}
+
+	// Same front facing normal as the grouping in BuildClusters
+	std::vector<FVector3> normals{};
+	normals.reserve(cluster.triangleCount);
+	FVector3 axis{ 0.f, 0.f, 0.f };
+	for (uint32_t i{ cluster.firstTriangle }; i < cluster.firstTriangle + cluster.triangleCount; ++i)
+	{
+		const FPoint3 p0{ getModelPosition(lod.indices[i * 3]) };
+		const FVector3 normal{ Cross(getModelPosition(lod.indices[i * 3 + 1]) - p0, getModelPosition(lod.indices[i * 3 + 2]) - p0) };
+		const float area{ Magnitude(normal) };
+		if (area > 0.f)
+		{
+			normals.push_back(normal / area);
+			axis += normals.back();
+		}
+	}
+
+	const float axisLength{ Magnitude(axis) };
+	if (normals.empty() || axisLength <= 0.f)
+	{
+		return;
+	}
+	axis /= axisLength;
+
+	float minDot{ 1.f };
+	for (const FVector3& normal : normals)
+	{
+		minDot = std::min(minDot, Dot(normal, axis));
+	}
+
+	// Past about 85 degrees the cone hardly ever culls, so it is not worth the test
+	cluster.coneAxis = axis;
+	cluster.coneCutoff = minDot <= .1f ? 1.f : sqrtf(1.f - minDot * minDot);
+}
+
+bool TriangleMesh::IsClusterBackFacing(const TriangleCluster& cluster, const BoundingSphere& worldSphere, const FMatrix4& transform, const FPoint3& cameraPos)
+{
+	if (cluster.coneCutoff >= 1.f)
+	{
+		return false;
+	}
+
+	// Back facing for every point of the sphere when the cone, widened by the sphere seen from the camera, points away from it
+	const FVector4 worldAxis{ transform * FVector4{ cluster.coneAxis, 0.f } };
+	const FVector3 axis{ GetNormalized(worldAxis.xyz) };
+	const FVector3 toCluster{ worldSphere.center - cameraPos };
+	return Dot(toCluster, axis) >= cluster.coneCutoff * Magnitude(toCluster) + worldSphere.radius;
+}
+
+uint32_t TriangleMesh::SelectLod(const FMatrix4& transform, uint32_t previousLod, const RasterizerState& state) const
 {
-	for (unsigned int i{0}; i < m_ModelVertices.size(); ++i)
+	uint32_t lod{ std::min(previousLod, static_cast<uint32_t>(m_pData->lods.size()) - 1) };
+
+	const Camera* pCamera{ SceneManager::GetInstance().GetScene().GetCamera() };
+	const BoundingSphere sphere{ TransformBoundingSphere(transform, m_pData->localBoundingSphere) };
+	const float viewDepth{ -(pCamera->GetRHWorldToView() * FPoint4{ sphere.center }).z };
+	if (!state.useLods || m_pData->lods.size() == 1 || sphere.radius <= 0.f || viewDepth <= sphere.radius)
+	{
+		return 0;
+	}
+
+	// Projected radius of the bounding sphere in pixels, the error of a level scales with it
+	const float screenRadius{ sphere.radius / (viewDepth * pCamera->GetFov()) * static_cast<float>(pCamera->GetScreenHeight()) / 2.f };
+	const auto getPixelError = [this, screenRadius](uint32_t level)
+	{
+		return m_pData->lods[level].error / m_pData->localBoundingSphere.radius * screenRadius;
+	};
+
+	while (lod + 1u < m_pData->lods.size() && getPixelError(lod + 1) <= m_LodPixelError * (1.f - m_LodHysteresis))
+	{
+		++lod;
+	}
+	while (lod > 0 && getPixelError(lod) > m_LodPixelError)
+	{
+		--lod;
+	}
+	return lod;
+}
+
+uint32_t TriangleMesh::SelectDepthLod(const FMatrix4& transform, float texelSize, const RasterizerState& state) const
+{
+	if (!state.useLods || texelSize <= 0.f)
+	{
+		return 0;
+	}
+
+	const float scale{ std::max(Magnitude(transform[0].xyz), std::max(Magnitude(transform[1].xyz), Magnitude(transform[2].xyz))) };
+	uint32_t lod{ 0 };
+	while (lod + 1u < m_pData->lods.size() && m_pData->lods[lod + 1].error * scale <= m_LodPixelError * texelSize)
+	{
+		++lod;
+	}
+	return lod;
+}
+
+uint32_t TriangleMesh::GetViewBucket(const TriangleMeshLod& lod, const FMatrix4& transform) const
+{
+	const Camera* pCamera{ SceneManager::GetInstance().GetScene().GetCamera() };
+	const FVector3& cameraPos{ pCamera->GetRHViewToWorld()[3].xyz };
+	const FPoint4 modelCameraPos{ Inverse(transform) * FPoint4{ cameraPos.x, cameraPos.y, cameraPos.z } };
+	const FVector3 viewDirection{ modelCameraPos.xyz - lod.clusterCenter };
+
+	uint32_t bestBucket{ 0 };
+	float bestDot{ -FLT_MAX };
+	for (uint32_t bucket{ 0 }; bucket < TriangleMeshLod::viewBucketAmount; ++bucket)
 	{
-		m_WorldVertices[i].pos = GetTransform() * m_ModelVertices[i].pos;
+		const float dot{ Dot(viewDirection, GetViewBucketDirection(bucket)) };
+		if (dot > bestDot)
+		{
+			bestDot = dot;
+			bestBucket = bucket;
+		}
 	}
+	return bestBucket;
 }
-void TriangleMesh::OnRecalculateTransform()
+
+FVector3 TriangleMesh::GetViewBucketDirection(uint32_t bucket)
 {
-	CalcWorldVertices();
+	FVector3 direction{ 0.f, 0.f, 0.f };
+	direction[static_cast<uint8_t>(bucket / 2)] = bucket % 2 == 0 ? 1.f : -1.f;
+	return direction;
 }
 
-bool TriangleMesh::RasterizeSingleTriangle(std::vector<Vertex>& triangleVertices, std::vector<float>& depthBuffer, std::vector<Vertex>& outVertices) const
+bool TriangleMesh::RasterizeSingleTriangle(std::array<Vertex, 3>& triangleVertices, const ScreenTile& tile, std::vector<float>& depthBuffer, std::vector<Vertex>& outVertices, RasterizerState& state) const
 {
 	for (const Vertex& vertex : triangleVertices)
 	{
@@ -99,22 +712,85 @@ bool TriangleMesh::RasterizeSingleTriangle(std::vector<Vertex>& triangleVertices
 	const Camera* pCamera{ SceneManager::GetInstance().GetScene().GetCamera() };
 	const int width{ pCamera->GetScreenWidth() };
 	const int height{ pCamera->GetScreenHeight() };
-	VertsToSS(width, height, triangleVertices);
 	
 	const std::tuple<FPoint2, FPoint2> points{ GetBoundingBox(static_cast<float>(width), static_cast<float>(height), triangleVertices) };
 	const FPoint2 topLeft{ std::get<0>(points) };
 	const FPoint2 bottomRight{ std::get<1>(points) };
 
-	FPoint2 pixel{};
-	for (auto row = static_cast<uint32_t>(std::ceilf(topLeft.y)); row < static_cast<uint32_t>(std::ceilf(bottomRight.y)); ++row)
-	{
-		pixel.y = static_cast<float>(row);
+	// Clipped to the tile, which starts on an even pixel so the quads below stay the same
+	const auto beginRow{ std::max(static_cast<uint32_t>(std::ceilf(topLeft.y)), tile.firstRow) };
+	const auto endRow{ std::min(static_cast<uint32_t>(std::ceilf(bottomRight.y)), tile.endRow) };
+	const auto beginCol{ std::max(static_cast<uint32_t>(std::ceilf(topLeft.x)), tile.firstCol) };
+	const auto endCol{ std::min(static_cast<uint32_t>(std::ceilf(bottomRight.x)), tile.endCol) };
+	const std::array<const Vertex*, 3> triangleVertexPointerArray{ &triangleVertices[0],&triangleVertices[1],&triangleVertices[2] };
+
+	// The uv is needed for every pixel of a quad, so its divisions are done once per triangle
+	const FPoint2 p0{ triangleVertices[0].pos.xy };
+	const FPoint2 p1{ triangleVertices[1].pos.xy };
+	const FPoint2 p2{ triangleVertices[2].pos.xy };
+	const float inverseArea{ 1 / Cross(FVector2{ p0 - p1 }, FVector2{ p0 - p2 }) };
+	const std::array<float, 3> inverseW{ 1 / triangleVertices[0].pos.w, 1 / triangleVertices[1].pos.w, 1 / triangleVertices[2].pos.w };
+	const std::array<FVector2, 3> uvOverW{ triangleVertices[0].uv * inverseW[0], triangleVertices[1].uv * inverseW[1], triangleVertices[2].uv * inverseW[2] };
 
-		for (auto col = static_cast<uint32_t>(std::ceilf(topLeft.x)); col < static_cast<uint32_t>(std::ceilf(bottomRight.x)); ++col)
+	// The edge tests of Triangle::Hit, the weights are also filled in outside the triangle where they extrapolate.
+	// Back faces have all three crosses the other way round, the weights stay the same since the area flips with them
+	const bool cullBackFaces{ state.cullBackFaces };
+	const auto calcWeights{ [&](const FPoint2& pixel, std::array<float, 3>& weights)
+		{
+			const float crossA{ Cross(FVector2{ p1 - p0 }, FVector2{ pixel - p0 }) };
+			const float crossB{ Cross(FVector2{ p2 - p1 }, FVector2{ pixel - p1 }) };
+			const float crossC{ Cross(FVector2{ p0 - p2 }, FVector2{ pixel - p2 }) };
+			weights = { crossB * inverseArea, crossC * inverseArea, crossA * inverseArea };
+			return (crossA <= 0.f && crossB <= 0.f && crossC <= 0.f) || (!cullBackFaces && crossA >= 0.f && crossB >= 0.f && crossC >= 0.f);
+		} };
+	const auto interpolateW{ [&inverseW](const std::array<float, 3>& weights)
 		{
-			pixel.x = static_cast<float>(col);
-			if (Triangle::Hit(pixel, triangleVertices))
+			return 1 / (inverseW[0] * weights[0] + inverseW[1] * weights[1] + inverseW[2] * weights[2]);
+		} };
+
+	// Pixels are walked in 2x2 quads starting on even coordinates, like a GPU shades them, so every pixel knows the uv of its
+	// neighbours for the texture level of detail. Quad pixels outside the triangle only extrapolate the uv
+	std::array<std::array<float, 3>, 4> quadWeights{};
+	std::array<bool, 4> quadCoverage{};
+	std::array<FVector2, 4> quadUVs{};
+	for (uint32_t quadRow = beginRow & ~1u; quadRow < endRow; quadRow += 2)
+	{
+		for (uint32_t quadCol = beginCol & ~1u; quadCol < endCol; quadCol += 2)
+		{
+			bool isQuadCovered{ false };
+			for (uint32_t i{ 0 }; i < 4; ++i)
+			{
+				const uint32_t col{ quadCol + (i & 1) };
+				const uint32_t row{ quadRow + (i >> 1) };
+				const FPoint2 pixel{ static_cast<float>(col), static_cast<float>(row) };
+				quadCoverage[i] = calcWeights(pixel, quadWeights[i]) && col >= beginCol && col < endCol && row >= beginRow && row < endRow;
+				isQuadCovered = isQuadCovered || quadCoverage[i];
+			}
+			if (!isQuadCovered)
 			{
+				continue;
+			}
+
+			for (uint32_t i{ 0 }; i < 4; ++i)
+			{
+				const std::array<float, 3>& weights{ quadWeights[i] };
+				quadUVs[i] = (uvOverW[0] * weights[0] + uvOverW[1] * weights[1] + uvOverW[2] * weights[2]) * interpolateW(weights);
+			}
+			const FVector2 uvDdx{ quadUVs[1] - quadUVs[0] };
+			const FVector2 uvDdy{ quadUVs[2] - quadUVs[0] };
+
+			for (uint32_t i{ 0 }; i < 4; ++i)
+			{
+				if (!quadCoverage[i])
+				{
+					continue;
+				}
+
+				const uint32_t col{ quadCol + (i & 1) };
+				const uint32_t row{ quadRow + (i >> 1) };
+				triangleVertices[0].weight = quadWeights[i][0];
+				triangleVertices[1].weight = quadWeights[i][1];
+				triangleVertices[2].weight = quadWeights[i][2];
 				const float interpZ
 				{
 					1 /
@@ -125,35 +801,30 @@ bool TriangleMesh::RasterizeSingleTriangle(std::vector<Vertex>& triangleVertices
 					)
 				};
 
-				if (interpZ > depthBuffer[PixelToBufferIndex(col, row, width)])
-
-				depthBuffer[PixelToBufferIndex(col, row, width)] = interpZ;
+				++state.testedFragments;
+				if (interpZ >= depthBuffer[PixelToBufferIndex(col, row, width)])
+				{
+					++state.rejectedFragments;
+					continue;
+				}
 
-				const float interpW
+				if (state.depthWrite)
 				{
-					1 /
-					(
-						1 / triangleVertices[0].pos.w * triangleVertices[0].weight +
-						1 / triangleVertices[1].pos.w * triangleVertices[1].weight +
-						1 / triangleVertices[2].pos.w * triangleVertices[2].weight
-					)
+					depthBuffer[PixelToBufferIndex(col, row, width)] = interpZ;
+				}
 
-				};
+				const float interpW{ interpolateW(quadWeights[i]) };
 
 				Vertex vertOut{};
 
-				vertOut.pos.x = pixel.x;
-				vertOut.pos.y = pixel.y;
+				vertOut.pos.x = static_cast<float>(col);
+				vertOut.pos.y = static_cast<float>(row);
 				vertOut.pos.z = interpZ;
 				vertOut.pos.w = interpW;
-				
-				const std::array<const Vertex*, 3> triangleVertexPointerArray{ &triangleVertices[0],&triangleVertices[1],&triangleVertices[2] };
-				vertOut.uv = Interpolate
-				(
-					std::array<FVector2, 3>{triangleVertices[0].uv, triangleVertices[1].uv, triangleVertices[2].uv},
-					triangleVertexPointerArray,
-					interpW
-				);
+
+				vertOut.uv = quadUVs[i];
+				vertOut.uvDdx = uvDdx;
+				vertOut.uvDdy = uvDdy;
 				vertOut.color = Interpolate
 				(
 					std::array<RGBColor, 3>{triangleVertices[0].color, triangleVertices[1].color, triangleVertices[2].color},
@@ -181,32 +852,40 @@ bool TriangleMesh::RasterizeSingleTriangle(std::vector<Vertex>& triangleVertices
 	return !outVertices.empty();
 }
 
-std::vector<Vertex> TriangleMesh::GetTriangleVertices(unsigned triangleNumber, const std::vector<Vertex>& vertices) const
+unsigned int TriangleMesh::GetTriangleCount(const TriangleMeshLod& lod) const
 {
-	std::vector<Vertex> out{};
-	switch (m_Topology)
+	switch (m_pData->topology)
+	{
+	case PrimitiveTopology::TriangleStrip:
+		return lod.indices.size() < 3 ? 0 : static_cast<unsigned int>(lod.indices.size()) - 2;
+	case PrimitiveTopology::TriangleList:
+	default:
+		return static_cast<unsigned int>(lod.indices.size()) / 3;
+	}
+}
+
+std::array<unsigned int, 3> TriangleMesh::GetTriangleIndices(const TriangleMeshLod& lod, unsigned int triangleNumber) const
+{
+	const std::vector<unsigned>& indices{ lod.indices };
+	switch (m_pData->topology)
 	{
-		case PrimitiveTopology::TriangleList:
-			{
-				const unsigned int firstIndex{ triangleNumber * 3 };
-				out.push_back(vertices[m_Indices[firstIndex]]);
-				out.push_back(vertices[m_Indices[firstIndex + 1]]);
-				out.push_back(vertices[m_Indices[firstIndex + 2]]);
-			}
-		break;
 		case PrimitiveTopology::TriangleStrip:
-			out.push_back(vertices[m_Indices[triangleNumber]]);
 			if (triangleNumber % 2 == 0)
 			{
-				out.push_back(vertices[m_Indices[triangleNumber + 1]]);
-				out.push_back(vertices[m_Indices[triangleNumber + 2]]);
+				return { indices[triangleNumber], indices[triangleNumber + 1], indices[triangleNumber + 2] };
 			}
-			else
+			return { indices[triangleNumber], indices[triangleNumber + 2], indices[triangleNumber + 1] };
+		case PrimitiveTopology::TriangleList:
+		default:
 			{
-				out.push_back(vertices[m_Indices[triangleNumber + 2]]);
-				out.push_back(vertices[m_Indices[triangleNumber + 1]]);
+				const unsigned int firstIndex{ triangleNumber * 3 };
+				return { indices[firstIndex], indices[firstIndex + 1], indices[firstIndex + 2] };
 			}
-		break;
 	}
-	return out;
-}
\ No newline at end of file
+}
+
+std::array<Vertex, 3> TriangleMesh::GetTriangleVertices(const TriangleMeshLod& lod, unsigned triangleNumber, const VertexStreams& vertices) const
+{
+	const std::array<unsigned int, 3> indices{ GetTriangleIndices(lod, triangleNumber) };
+	return { vertices.GetVertex(indices[0]), vertices.GetVertex(indices[1]), vertices.GetVertex(indices[2]) };
+}
@@ -1,5 +1,7 @@
 ﻿#pragma once
 #include <vector>
+#include <array>
+#include <memory>
 #include "Geometry.h"
 #include "Structs.h"
 #include "Texture.h"
@@ -10,29 +12,103 @@ enum class PrimitiveTopology
 	TriangleStrip
 };
 
-class TriangleMesh final : public Geometry
+// Spatially close triangles with their own vertex range, culled as a whole before any per triangle work
+struct TriangleCluster
+{
+	uint32_t firstTriangle{};
+	uint32_t triangleCount{};
+	uint32_t firstVertex{};
+	uint32_t vertexCount{};
+
+	BoundingSphere boundingSphere;
+	// Every triangle normal lies within the cone around the axis, the cutoff is the sine of its half angle
+	// A cutoff of 1 means the normals spread too far for the cone to ever cull the cluster
+	FVector3 coneAxis{ 0.f, 0.f, 1.f };
+	float coneCutoff{ 1.f };
+};
+
+// One level of detail, with only the vertices its own triangles use
+struct TriangleMeshLod
+{
+	static constexpr uint32_t clusterSize{ 64 };
+	static constexpr uint32_t viewBucketAmount{ 6 };
+
+	VertexStreams vertices;
+	std::vector<unsigned> indices;
+	// How far the surface may lie from the full detail one, in model units
+	float error{};
+
+	// Clusters of spatially close triangles, and per view direction bucket the cluster order from near to far
+	std::vector<TriangleCluster> clusters;
+	std::array<std::vector<uint32_t>, viewBucketAmount> clusterOrders;
+	FPoint3 clusterCenter;
+};
+
+// Model space data of a mesh, immutable once built so any number of meshes and instances can share it
+struct TriangleMeshData
+{
+	// Full detail first, every next level has about half the triangles
+	std::vector<TriangleMeshLod> lods;
+	PrimitiveTopology topology{ PrimitiveTopology::TriangleList };
+
+	AABB localAABB;
+	BoundingSphere localBoundingSphere;
+};
+
+class TriangleMesh : public Geometry
 {
 public:
 	TriangleMesh(const FPoint3& position, const std::vector<IVertex>& vertices, const std::vector<unsigned int>& indices, 
 		PrimitiveTopology topology = PrimitiveTopology::TriangleList);
+	TriangleMesh(const FPoint3& position, std::shared_ptr<const TriangleMeshData> pData);
 	~TriangleMesh() override = default;
 
+	static std::shared_ptr<const TriangleMeshData> CreateData(const std::vector<IVertex>& vertices, const std::vector<unsigned int>& indices,
+		PrimitiveTopology topology = PrimitiveTopology::TriangleList);
+	// Reads the mesh straight from where it is, like a mapped mesh cache, with the bounds it already knows
+	static std::shared_ptr<const TriangleMeshData> CreateData(const MeshView& mesh, const AABB& bounds,
+		PrimitiveTopology topology = PrimitiveTopology::TriangleList);
+	const std::shared_ptr<const TriangleMeshData>& GetData() const;
+
+	bool Raycast(const Ray& ray, float& distance) const override;
+
 	std::vector<Vertex> GetModelVerts() const override;
 
-	void Project(std::vector<Vertex>& vertices) const override;
-	bool Rasterize(std::vector<Vertex>& vertices, std::vector<float>& depthBuffer, std::vector<Vertex>& outVertices) const override;
+	void Project(uint32_t instance, ProjectedGeometry& projected, RasterizerState& state) const override;
+	void ShadeVertices(uint32_t instance, ProjectedGeometry& projected, size_t firstRange, size_t endRange) const override;
+	void BinTriangles(const ProjectedGeometry& projected, size_t firstRange, size_t endRange, uint32_t draw, const RasterizerState& state,
+		TileBins& bins) const override;
+	bool Rasterize(const ProjectedGeometry& projected, const BinnedTriangle* pFirst, const BinnedTriangle* pLast, const ScreenTile& tile,
+		std::vector<float>& depthBuffer, std::vector<Vertex>& outVertices, RasterizerState& state) const override;
+	void RasterizeDepth(uint32_t instance, DepthTarget& target, ProjectedGeometry& projected, RasterizerState& state) const override;
 
 private:
-	std::vector<Vertex> m_ModelVertices;
-	std::vector<Vertex> m_WorldVertices;
-	std::vector<unsigned> m_Indices;
+	static constexpr uint32_t m_MaxLodAmount{ 4 };
+	static constexpr uint32_t m_MinLodTriangleAmount{ 256 };
+	// A level is used while its error covers at most this many pixels, a coarser level only once it is below by the hysteresis
+	static constexpr float m_LodPixelError{ 1.f };
+	static constexpr float m_LodHysteresis{ .25f };
+	// Largest vertex range Project leaves for the vertex stage where it can split, and triangle range of a mesh without clusters
+	static constexpr uint32_t m_MaxVertexRange{ 1024 };
+	static constexpr uint32_t m_MaxTriangleRange{ 256 };
 
-	PrimitiveTopology m_Topology;
+	std::shared_ptr<const TriangleMeshData> m_pData;
 
-	void CalcWorldVertices();
-	void OnRecalculateTransform() override;
+	static void BuildLods(TriangleMeshData& data);
+	static void BuildClusters(TriangleMeshLod& lod);
+	static void BuildClusterBounds(TriangleMeshLod& lod, TriangleCluster& cluster);
+	static bool IsClusterBackFacing(const TriangleCluster& cluster, const BoundingSphere& worldSphere, const FMatrix4& transform, const FPoint3& cameraPos);
+	// The level for this frame, moving away from the one of the previous frame only past the hysteresis
+	uint32_t SelectLod(const FMatrix4& transform, uint32_t previousLod, const RasterizerState& state) const;
+	// The coarsest level whose error stays within a texel of that world size. There is no hysteresis, the level is not
+	// kept per target
+	uint32_t SelectDepthLod(const FMatrix4& transform, float texelSize, const RasterizerState& state) const;
+	uint32_t GetViewBucket(const TriangleMeshLod& lod, const FMatrix4& transform) const;
+	static FVector3 GetViewBucketDirection(uint32_t bucket);
 
-	bool RasterizeSingleTriangle(std::vector<Vertex>& triangleVertices, std::vector<float>& depthBuffer, std::vector<Vertex>& outVertices) const;
+	bool RasterizeSingleTriangle(std::array<Vertex, 3>& triangleVertices, const ScreenTile& tile, std::vector<float>& depthBuffer, std::vector<Vertex>& outVertices, RasterizerState& state) const;
 
-	std::vector<Vertex> GetTriangleVertices(unsigned int triangleNumber, const std::vector<Vertex>& vertices) const;
+	unsigned int GetTriangleCount(const TriangleMeshLod& lod) const;
+	std::array<unsigned int, 3> GetTriangleIndices(const TriangleMeshLod& lod, unsigned int triangleNumber) const;
+	std::array<Vertex, 3> GetTriangleVertices(const TriangleMeshLod& lod, unsigned int triangleNumber, const VertexStreams& vertices) const;
 };
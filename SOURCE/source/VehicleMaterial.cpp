@@ -8,22 +8,11 @@ VehicleMaterial::VehicleMaterial(ID3D11Device* pDevice, const std::wstring& path
 	, m_pViewInverseMatrixVariable(nullptr)
 	, m_pDiffuseMapVariable(nullptr)
 	, m_pNormalMapVariable(nullptr)
-	, m_pSpecularMapVariable(nullptr)
-	, m_pGlossinessMapVariable(nullptr)
-	, m_pDiffuse(nullptr)
-	, m_pNormalMap(nullptr)
-	, m_pSpecularMap(nullptr)
-	, m_pGlossinessMap(nullptr)
+	, m_pSpecularGlossinessMapVariable(nullptr)
 {
 }
 
-VehicleMaterial::~VehicleMaterial()
-{
-	delete m_pDiffuse;
-	delete m_pNormalMap;
-	delete m_pSpecularMap;
-	delete m_pGlossinessMap;
-}
+VehicleMaterial::~VehicleMaterial() = default;
 
 void VehicleMaterial::Update(Mesh* mesh)
 {
@@ -33,29 +22,20 @@ void VehicleMaterial::Update(Mesh* mesh)
 	SetEffectMatrix("gWorldMatrix", m_pWorldMatrixVariable, mesh->GetTransform());
 	SetEffectMatrix("gViewInverseMatrix", m_pViewInverseMatrixVariable, pCamera->GetLHViewToWorld());
 
-	SetEffectShaderResource("gDiffuseMap", m_pDiffuseMapVariable, m_pDiffuse);
-	SetEffectShaderResource("gNormalMap", m_pNormalMapVariable, m_pNormalMap);
-	SetEffectShaderResource("gSpecularMap", m_pSpecularMapVariable, m_pSpecularMap);
-	SetEffectShaderResource("gGlossinessMap", m_pGlossinessMapVariable, m_pGlossinessMap);
+	SetEffectShaderResource("gDiffuseMap", m_pDiffuseMapVariable, m_pDiffuse.get());
+	SetEffectShaderResource("gNormalMap", m_pNormalMapVariable, m_pNormalMap.get());
+	SetEffectShaderResource("gSpecularGlossinessMap", m_pSpecularGlossinessMapVariable, m_pSpecularGlossinessMap.get());
 }
 
-void VehicleMaterial::SetDiffuseTexture(Texture* pDiffuseTexture)
-{
-	delete m_pDiffuse;
-	m_pDiffuse = pDiffuseTexture;
-}
-void VehicleMaterial::SetNormalMap(Texture* pNormalMap)
+void VehicleMaterial::SetDiffuseTexture(std::shared_ptr<Texture> pDiffuseTexture)
 {
-	delete m_pNormalMap;
-	m_pNormalMap = pNormalMap;
+	m_pDiffuse = std::move(pDiffuseTexture);
 }
-void VehicleMaterial::SetSpecularMap(Texture* pSpecularMap)
+void VehicleMaterial::SetNormalMap(std::shared_ptr<Texture> pNormalMap)
 {
-	delete m_pSpecularMap;
-	m_pSpecularMap = pSpecularMap;
+	m_pNormalMap = std::move(pNormalMap);
 }
-void VehicleMaterial::SetGlossinessMap(Texture* pGlossinessMap)
+void VehicleMaterial::SetSpecularGlossinessMap(std::shared_ptr<Texture> pSpecularGlossinessMap)
 {
-	delete m_pGlossinessMap;
-	m_pGlossinessMap = pGlossinessMap;
+	m_pSpecularGlossinessMap = std::move(pSpecularGlossinessMap);
 }
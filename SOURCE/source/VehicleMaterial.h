@@ -1,5 +1,6 @@
 #pragma once
 #include "Material.h"
+#include <memory>
 
 
 
@@ -15,10 +16,10 @@ public:
 
 	void Update(Mesh* mesh) override;
 	
-	void SetDiffuseTexture(Texture* pDiffuseTexture);
-	void SetNormalMap(Texture* pNormalMap);
-	void SetSpecularMap(Texture* pSpecularMap);
-	void SetGlossinessMap(Texture* pGlossinessMap);
+	void SetDiffuseTexture(std::shared_ptr<Texture> pDiffuseTexture);
+	void SetNormalMap(std::shared_ptr<Texture> pNormalMap);
+	// Specular in red and glossiness in green
+	void SetSpecularGlossinessMap(std::shared_ptr<Texture> pSpecularGlossinessMap);
 
 private:
 	ID3DX11EffectMatrixVariable* m_pWorldMatrixVariable;
@@ -26,12 +27,10 @@ private:
 
 	ID3DX11EffectShaderResourceVariable* m_pDiffuseMapVariable;
 	ID3DX11EffectShaderResourceVariable* m_pNormalMapVariable;
-	ID3DX11EffectShaderResourceVariable* m_pSpecularMapVariable;
-	ID3DX11EffectShaderResourceVariable* m_pGlossinessMapVariable;
+	ID3DX11EffectShaderResourceVariable* m_pSpecularGlossinessMapVariable;
 
-	Texture* m_pDiffuse;
-	Texture* m_pNormalMap;
-	Texture* m_pSpecularMap;
-	Texture* m_pGlossinessMap;
+	std::shared_ptr<Texture> m_pDiffuse;
+	std::shared_ptr<Texture> m_pNormalMap;
+	std::shared_ptr<Texture> m_pSpecularGlossinessMap;
 };
 
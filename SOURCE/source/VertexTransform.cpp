@@ -0,0 +1,173 @@
+#include "pch.h"
+#include "VertexTransform.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+void TransformVertexStreams(const Elite::FMatrix4& worldViewProjection, const Elite::FMatrix4& world,
+	float screenWidth, float screenHeight, const VertexStreams& modelVertices, VertexStreams& projectedVertices)
+{
+	projectedVertices.Resize(modelVertices.count);
+	TransformVertexRange(worldViewProjection, world, screenWidth, screenHeight, modelVertices, projectedVertices, 0, modelVertices.count);
+}
+
+void TransformVertexRange(const Elite::FMatrix4& worldViewProjection, const Elite::FMatrix4& world,
+	float screenWidth, float screenHeight, const VertexStreams& modelVertices, VertexStreams& projectedVertices,
+	size_t firstVertex, size_t vertexCount)
+{
+	constexpr size_t batchSize{ VertexStreams::batchSize };
+	const size_t begin{ firstVertex / batchSize * batchSize };
+	const size_t end{ std::min((firstVertex + vertexCount + batchSize - 1) / batchSize * batchSize, modelVertices.GetPaddedCount()) };
+
+	const Elite::FMatrix4& m{ worldViewProjection };
+	const Elite::FMatrix4& r{ world };
+	const float halfWidth{ screenWidth / 2.f };
+	const float halfHeight{ screenHeight / 2.f };
+
+#if defined(__AVX2__)
+	const __m256 m00{ _mm256_set1_ps(m(0, 0)) }, m01{ _mm256_set1_ps(m(0, 1)) }, m02{ _mm256_set1_ps(m(0, 2)) }, m03{ _mm256_set1_ps(m(0, 3)) };
+	const __m256 m10{ _mm256_set1_ps(m(1, 0)) }, m11{ _mm256_set1_ps(m(1, 1)) }, m12{ _mm256_set1_ps(m(1, 2)) }, m13{ _mm256_set1_ps(m(1, 3)) };
+	const __m256 m20{ _mm256_set1_ps(m(2, 0)) }, m21{ _mm256_set1_ps(m(2, 1)) }, m22{ _mm256_set1_ps(m(2, 2)) }, m23{ _mm256_set1_ps(m(2, 3)) };
+	const __m256 m30{ _mm256_set1_ps(m(3, 0)) }, m31{ _mm256_set1_ps(m(3, 1)) }, m32{ _mm256_set1_ps(m(3, 2)) }, m33{ _mm256_set1_ps(m(3, 3)) };
+
+	const __m256 r00{ _mm256_set1_ps(r(0, 0)) }, r01{ _mm256_set1_ps(r(0, 1)) }, r02{ _mm256_set1_ps(r(0, 2)) };
+	const __m256 r10{ _mm256_set1_ps(r(1, 0)) }, r11{ _mm256_set1_ps(r(1, 1)) }, r12{ _mm256_set1_ps(r(1, 2)) };
+	const __m256 r20{ _mm256_set1_ps(r(2, 0)) }, r21{ _mm256_set1_ps(r(2, 1)) }, r22{ _mm256_set1_ps(r(2, 2)) };
+
+	const __m256 one{ _mm256_set1_ps(1.f) };
+	const __m256 halfWidthBatch{ _mm256_set1_ps(halfWidth) };
+	const __m256 halfHeightBatch{ _mm256_set1_ps(halfHeight) };
+
+	for (size_t i{ begin }; i < end; i += batchSize)
+	{
+		// Positions
+		const __m256 x{ _mm256_loadu_ps(&modelVertices.x[i]) };
+		const __m256 y{ _mm256_loadu_ps(&modelVertices.y[i]) };
+		const __m256 z{ _mm256_loadu_ps(&modelVertices.z[i]) };
+
+		const __m256 clipX{ _mm256_fmadd_ps(m00, x, _mm256_fmadd_ps(m01, y, _mm256_fmadd_ps(m02, z, m03))) };
+		const __m256 clipY{ _mm256_fmadd_ps(m10, x, _mm256_fmadd_ps(m11, y, _mm256_fmadd_ps(m12, z, m13))) };
+		const __m256 clipZ{ _mm256_fmadd_ps(m20, x, _mm256_fmadd_ps(m21, y, _mm256_fmadd_ps(m22, z, m23))) };
+		const __m256 clipW{ _mm256_fmadd_ps(m30, x, _mm256_fmadd_ps(m31, y, _mm256_fmadd_ps(m32, z, m33))) };
+
+		const __m256 invW{ _mm256_div_ps(one, clipW) };
+		const __m256 ndcX{ _mm256_mul_ps(clipX, invW) };
+		const __m256 ndcY{ _mm256_mul_ps(clipY, invW) };
+
+		_mm256_storeu_ps(&projectedVertices.x[i], _mm256_fmadd_ps(ndcX, halfWidthBatch, halfWidthBatch));
+		_mm256_storeu_ps(&projectedVertices.y[i], _mm256_fnmadd_ps(ndcY, halfHeightBatch, halfHeightBatch));
+		_mm256_storeu_ps(&projectedVertices.z[i], _mm256_mul_ps(clipZ, invW));
+		_mm256_storeu_ps(&projectedVertices.w[i], clipW);
+
+		// Normals
+		const __m256 nx{ _mm256_loadu_ps(&modelVertices.normalX[i]) };
+		const __m256 ny{ _mm256_loadu_ps(&modelVertices.normalY[i]) };
+		const __m256 nz{ _mm256_loadu_ps(&modelVertices.normalZ[i]) };
+		_mm256_storeu_ps(&projectedVertices.normalX[i], _mm256_fmadd_ps(r00, nx, _mm256_fmadd_ps(r01, ny, _mm256_mul_ps(r02, nz))));
+		_mm256_storeu_ps(&projectedVertices.normalY[i], _mm256_fmadd_ps(r10, nx, _mm256_fmadd_ps(r11, ny, _mm256_mul_ps(r12, nz))));
+		_mm256_storeu_ps(&projectedVertices.normalZ[i], _mm256_fmadd_ps(r20, nx, _mm256_fmadd_ps(r21, ny, _mm256_mul_ps(r22, nz))));
+
+		// Tangents
+		const __m256 tx{ _mm256_loadu_ps(&modelVertices.tangentX[i]) };
+		const __m256 ty{ _mm256_loadu_ps(&modelVertices.tangentY[i]) };
+		const __m256 tz{ _mm256_loadu_ps(&modelVertices.tangentZ[i]) };
+		_mm256_storeu_ps(&projectedVertices.tangentX[i], _mm256_fmadd_ps(r00, tx, _mm256_fmadd_ps(r01, ty, _mm256_mul_ps(r02, tz))));
+		_mm256_storeu_ps(&projectedVertices.tangentY[i], _mm256_fmadd_ps(r10, tx, _mm256_fmadd_ps(r11, ty, _mm256_mul_ps(r12, tz))));
+		_mm256_storeu_ps(&projectedVertices.tangentZ[i], _mm256_fmadd_ps(r20, tx, _mm256_fmadd_ps(r21, ty, _mm256_mul_ps(r22, tz))));
+
+		// UVs are passed through
+		_mm256_storeu_ps(&projectedVertices.u[i], _mm256_loadu_ps(&modelVertices.u[i]));
+		_mm256_storeu_ps(&projectedVertices.v[i], _mm256_loadu_ps(&modelVertices.v[i]));
+	}
+#else
+	for (size_t i{ begin }; i < end; ++i)
+	{
+		const float x{ modelVertices.x[i] };
+		const float y{ modelVertices.y[i] };
+		const float z{ modelVertices.z[i] };
+
+		const float clipW{ m(3, 0) * x + m(3, 1) * y + m(3, 2) * z + m(3, 3) };
+		const float invW{ 1.f / clipW };
+		const float ndcX{ (m(0, 0) * x + m(0, 1) * y + m(0, 2) * z + m(0, 3)) * invW };
+		const float ndcY{ (m(1, 0) * x + m(1, 1) * y + m(1, 2) * z + m(1, 3)) * invW };
+
+		projectedVertices.x[i] = (ndcX + 1.f) * halfWidth;
+		projectedVertices.y[i] = (1.f - ndcY) * halfHeight;
+		projectedVertices.z[i] = (m(2, 0) * x + m(2, 1) * y + m(2, 2) * z + m(2, 3)) * invW;
+		projectedVertices.w[i] = clipW;
+
+		const float nx{ modelVertices.normalX[i] };
+		const float ny{ modelVertices.normalY[i] };
+		const float nz{ modelVertices.normalZ[i] };
+		projectedVertices.normalX[i] = r(0, 0) * nx + r(0, 1) * ny + r(0, 2) * nz;
+		projectedVertices.normalY[i] = r(1, 0) * nx + r(1, 1) * ny + r(1, 2) * nz;
+		projectedVertices.normalZ[i] = r(2, 0) * nx + r(2, 1) * ny + r(2, 2) * nz;
+
+		const float tx{ modelVertices.tangentX[i] };
+		const float ty{ modelVertices.tangentY[i] };
+		const float tz{ modelVertices.tangentZ[i] };
+		projectedVertices.tangentX[i] = r(0, 0) * tx + r(0, 1) * ty + r(0, 2) * tz;
+		projectedVertices.tangentY[i] = r(1, 0) * tx + r(1, 1) * ty + r(1, 2) * tz;
+		projectedVertices.tangentZ[i] = r(2, 0) * tx + r(2, 1) * ty + r(2, 2) * tz;
+
+		projectedVertices.u[i] = modelVertices.u[i];
+		projectedVertices.v[i] = modelVertices.v[i];
+	}
+#endif
+}
+
+void TransformPositionRange(const Elite::FMatrix4& viewProjection, float screenWidth, float screenHeight,
+	const VertexStreams& modelVertices, VertexStreams& projectedVertices, size_t firstVertex, size_t vertexCount)
+{
+	constexpr size_t batchSize{ VertexStreams::batchSize };
+	const size_t begin{ firstVertex / batchSize * batchSize };
+	const size_t end{ std::min((firstVertex + vertexCount + batchSize - 1) / batchSize * batchSize, modelVertices.GetPaddedCount()) };
+
+	const Elite::FMatrix4& m{ viewProjection };
+	const float halfWidth{ screenWidth / 2.f };
+	const float halfHeight{ screenHeight / 2.f };
+
+#if defined(__AVX2__)
+	const __m256 m00{ _mm256_set1_ps(m(0, 0)) }, m01{ _mm256_set1_ps(m(0, 1)) }, m02{ _mm256_set1_ps(m(0, 2)) }, m03{ _mm256_set1_ps(m(0, 3)) };
+	const __m256 m10{ _mm256_set1_ps(m(1, 0)) }, m11{ _mm256_set1_ps(m(1, 1)) }, m12{ _mm256_set1_ps(m(1, 2)) }, m13{ _mm256_set1_ps(m(1, 3)) };
+	const __m256 m20{ _mm256_set1_ps(m(2, 0)) }, m21{ _mm256_set1_ps(m(2, 1)) }, m22{ _mm256_set1_ps(m(2, 2)) }, m23{ _mm256_set1_ps(m(2, 3)) };
+	const __m256 m30{ _mm256_set1_ps(m(3, 0)) }, m31{ _mm256_set1_ps(m(3, 1)) }, m32{ _mm256_set1_ps(m(3, 2)) }, m33{ _mm256_set1_ps(m(3, 3)) };
+
+	const __m256 one{ _mm256_set1_ps(1.f) };
+	const __m256 halfWidthBatch{ _mm256_set1_ps(halfWidth) };
+	const __m256 halfHeightBatch{ _mm256_set1_ps(halfHeight) };
+
+	for (size_t i{ begin }; i < end; i += batchSize)
+	{
+		const __m256 x{ _mm256_loadu_ps(&modelVertices.x[i]) };
+		const __m256 y{ _mm256_loadu_ps(&modelVertices.y[i]) };
+		const __m256 z{ _mm256_loadu_ps(&modelVertices.z[i]) };
+
+		const __m256 clipX{ _mm256_fmadd_ps(m00, x, _mm256_fmadd_ps(m01, y, _mm256_fmadd_ps(m02, z, m03))) };
+		const __m256 clipY{ _mm256_fmadd_ps(m10, x, _mm256_fmadd_ps(m11, y, _mm256_fmadd_ps(m12, z, m13))) };
+		const __m256 clipZ{ _mm256_fmadd_ps(m20, x, _mm256_fmadd_ps(m21, y, _mm256_fmadd_ps(m22, z, m23))) };
+		const __m256 clipW{ _mm256_fmadd_ps(m30, x, _mm256_fmadd_ps(m31, y, _mm256_fmadd_ps(m32, z, m33))) };
+
+		const __m256 invW{ _mm256_div_ps(one, clipW) };
+		_mm256_storeu_ps(&projectedVertices.x[i], _mm256_fmadd_ps(_mm256_mul_ps(clipX, invW), halfWidthBatch, halfWidthBatch));
+		_mm256_storeu_ps(&projectedVertices.y[i], _mm256_fnmadd_ps(_mm256_mul_ps(clipY, invW), halfHeightBatch, halfHeightBatch));
+		_mm256_storeu_ps(&projectedVertices.z[i], _mm256_mul_ps(clipZ, invW));
+		_mm256_storeu_ps(&projectedVertices.w[i], clipW);
+	}
+#else
+	for (size_t i{ begin }; i < end; ++i)
+	{
+		const float x{ modelVertices.x[i] };
+		const float y{ modelVertices.y[i] };
+		const float z{ modelVertices.z[i] };
+
+		const float clipW{ m(3, 0) * x + m(3, 1) * y + m(3, 2) * z + m(3, 3) };
+		const float invW{ 1.f / clipW };
+		projectedVertices.x[i] = ((m(0, 0) * x + m(0, 1) * y + m(0, 2) * z + m(0, 3)) * invW + 1.f) * halfWidth;
+		projectedVertices.y[i] = (1.f - (m(1, 0) * x + m(1, 1) * y + m(1, 2) * z + m(1, 3)) * invW) * halfHeight;
+		projectedVertices.z[i] = (m(2, 0) * x + m(2, 1) * y + m(2, 2) * z + m(2, 3)) * invW;
+		projectedVertices.w[i] = clipW;
+	}
+#endif
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include "EMath.h"
+#include "Structs.h"
+
+// Fused vertex stage: positions go through world-view-projection, perspective divide and viewport mapping,
+// normals and tangents are rotated to world space, all in a single pass over the streams.
+// Uses AVX2 to process 8 vertices per iteration when the build enables it.
+void TransformVertexStreams(const Elite::FMatrix4& worldViewProjection, const Elite::FMatrix4& world,
+	float screenWidth, float screenHeight, const VertexStreams& modelVertices, VertexStreams& projectedVertices);
+
+// Same stage for part of the streams, projectedVertices must already have the size of modelVertices.
+// The range is widened to whole batches, so a few neighbouring vertices may be transformed as well.
+void TransformVertexRange(const Elite::FMatrix4& worldViewProjection, const Elite::FMatrix4& world,
+	float screenWidth, float screenHeight, const VertexStreams& modelVertices, VertexStreams& projectedVertices,
+	size_t firstVertex, size_t vertexCount);
+
+// Positions alone to screen space, for the depth only rasterizer. Writes x, y, z and w of projectedVertices and nothing else
+void TransformPositionRange(const Elite::FMatrix4& viewProjection, float screenWidth, float screenHeight,
+	const VertexStreams& modelVertices, VertexStreams& projectedVertices, size_t firstVertex, size_t vertexCount);
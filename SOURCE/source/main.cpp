@@ -8,6 +8,8 @@
 
 //Standard includes
 #include <iostream>
+#include <chrono>
+#include <string>
 
 //Project includes
 #include "ETimer.h"
@@ -21,15 +23,11 @@
 #include "VehicleMaterial.h"
 #include "ExhaustMaterial.h"
 #include "SoftwareRenderer.h"
+#include "SoftwareShaders.h"
 #include "TriangleMesh.h"
-
-enum class FilterMode
-{
-	Point = 0,
-	Linear = 1,
-	Anisotropic = 2,
-	EndDoNotUse = 3
-};
+#include "InstancedTriangleMesh.h"
+#include "AssetLoader.h"
+#include "Benchmarks.h"
 
 using namespace Elite;
 
@@ -41,9 +39,8 @@ void ShutDown(SDL_Window* pWindow)
 
 int main(int argc, char* args[])
 {
-	//Unreferenced parameters
-	(void)argc;
-	(void)args;
+	if (RunBenchmark(argc, args))
+		return 0;
 
 	//Create window + surfaces
 	SDL_Init(SDL_INIT_VIDEO);
@@ -62,55 +59,136 @@ int main(int argc, char* args[])
 	//Initialize "framework"
 	auto pTimer{ std::make_unique<Elite::Timer>() };
 	auto directxRenderer{ std::make_unique<Elite::DirectxRenderer>(pWindow) };
-	auto softwareRenderer{ std::make_unique<Elite::SoftwareRenderer>(pWindow, 
-		new Texture("Resources/vehicle_diffuse.png", directxRenderer->GetDevice()),
-		new Texture("Resources/vehicle_normal.png", directxRenderer->GetDevice())) };
+	ID3D11Device* pDevice{ directxRenderer->GetDevice() };
 
 	SceneManager& sceneManager{ SceneManager::GetInstance() };
 	
 	Scene& scene = sceneManager.GetScene();
 	scene.SetCamera(new Camera(width, height));
 
+	TextureCache textureCache{ pDevice };
+	auto softwareRenderer{ std::make_unique<Elite::SoftwareRenderer>(pWindow) };
 	TriangleMesh* pTriangleMeshVehicle{ nullptr };
+	TriangleMesh* pTriangleMeshFireFX{ nullptr };
+	InstancedTriangleMesh* pParkingLot{ nullptr };
 	Mesh* pMeshVehicle{ nullptr };
 	Mesh* pFireFX{ nullptr };
 	{
+		//Everything starts loading at once, the scene is built in the order the assets are needed
+		const auto loadStart{ std::chrono::steady_clock::now() };
+		AssetLoader assetLoader{ pDevice, textureCache };
+
+		std::future<MeshAsset> vehicleMesh{ assetLoader.LoadMesh("Resources/vehicle.obj") };
+		std::future<MeshAsset> fireFXMesh{ assetLoader.LoadMesh("Resources/fireFX.obj") };
+		std::future<VehicleMaterial*> vehicleMaterial{ assetLoader.Run([pDevice]() { return new VehicleMaterial(pDevice, L"Resources/PosCol3D.fx"); }) };
+		//Only the textures the software rasterizer samples keep a CPU copy. Every texture is block compressed with the fewest
+		//channels it needs, the normal map keeps x and y and the shader rebuilds z. Specular and gloss are grayscale and
+		//always sampled together, so they share the two channels of one texture. The exhaust keeps alpha for blending
+		std::future<std::shared_ptr<Texture>> vehicleDiffuse{ assetLoader.LoadTexture("Resources/vehicle_diffuse.png", TextureResidency::CpuAndGpu, TextureFormat::BC1) };
+		std::future<std::shared_ptr<Texture>> vehicleNormal{ assetLoader.LoadTexture("Resources/vehicle_normal.png", TextureResidency::CpuAndGpu, TextureFormat::BC5) };
+		std::future<std::shared_ptr<Texture>> vehicleSpecularGlossiness{ assetLoader.LoadPackedTexture(
+			{ "Resources/vehicle_specular.png", "Resources/vehicle_gloss.png" }, TextureResidency::CpuAndGpu, TextureFormat::BC5) };
+		std::shared_future<std::shared_ptr<Texture>> fireFXDiffuse{ assetLoader.LoadTexture("Resources/fireFX_diffuse.png", TextureResidency::CpuAndGpu, TextureFormat::BC3).share() };
+		std::future<ExhaustMaterial*> exhaustMaterial{ assetLoader.Run([pDevice, fireFXDiffuse]()
+			{
+				return new ExhaustMaterial(pDevice, L"Resources/Exhaust.fx", fireFXDiffuse.get());
+			}) };
+
 		{
-			std::vector<IVertex> vertices{};
-			std::vector<uint32_t> indices{};
-			ParseOBJ("Resources/vehicle.obj", vertices, indices);
+			const MeshAsset mesh{ vehicleMesh.get() };
+			std::cout << "vehicle.obj ACMR: " << mesh.acmrBefore << " -> " << mesh.acmrAfter << "\n";
 
-			VehicleMaterial* pVehicleMaterial{ new VehicleMaterial(directxRenderer->GetDevice(), L"Resources/PosCol3D.fx") };
-			pVehicleMaterial->SetDiffuseTexture(new Texture("Resources/vehicle_diffuse.png", directxRenderer->GetDevice()));
-			pVehicleMaterial->SetNormalMap(new Texture("Resources/vehicle_normal.png", directxRenderer->GetDevice()));
-			pVehicleMaterial->SetSpecularMap(new Texture("Resources/vehicle_specular.png", directxRenderer->GetDevice()));
-			pVehicleMaterial->SetGlossinessMap(new Texture("Resources/vehicle_gloss.png", directxRenderer->GetDevice()));
+			const std::shared_ptr<Texture> pDiffuse{ vehicleDiffuse.get() };
+			const std::shared_ptr<Texture> pNormalMap{ vehicleNormal.get() };
+			const std::shared_ptr<Texture> pSpecularGlossinessMap{ vehicleSpecularGlossiness.get() };
 
-			pMeshVehicle = new Mesh(directxRenderer->GetDevice(), vertices, indices, pVehicleMaterial);
+			VehicleMaterial* pVehicleMaterial{ vehicleMaterial.get() };
+			pVehicleMaterial->SetDiffuseTexture(pDiffuse);
+			pVehicleMaterial->SetNormalMap(pNormalMap);
+			pVehicleMaterial->SetSpecularGlossinessMap(pSpecularGlossinessMap);
+
+			pMeshVehicle = new Mesh(pDevice, mesh.GetView(), pVehicleMaterial);
 			pMeshVehicle->SetPosition({ 0,0,50.f });
 			scene.AddMesh(pMeshVehicle);
 
-			pTriangleMeshVehicle = new TriangleMesh(FPoint3{ 0,0,50.f }, vertices, indices);
+			const std::shared_ptr<SoftwareMaterial> pVehicleSoftwareMaterial{ MakeSoftwareMaterial(TransformVertexShader{},
+				PhongPixelShader{ pDiffuse, pNormalMap, pSpecularGlossinessMap }) };
+			pTriangleMeshVehicle = new TriangleMesh(FPoint3{ 0,0,50.f }, TriangleMesh::CreateData(mesh.GetView(), mesh.bounds));
+			pTriangleMeshVehicle->SetMaterial(pVehicleSoftwareMaterial);
 			scene.AddGeometry(pTriangleMeshVehicle);
+
+			//A parking lot around the vehicle, parked vehicles beside it and a row facing it from behind, all instances of its
+			//mesh data. Only the software rasterizer draws instanced geometry, so the lot starts hidden and P shows it
+			pParkingLot = new InstancedTriangleMesh(pTriangleMeshVehicle->GetData(), FPoint3{ 0,0,50.f });
+			for (int row{ 0 }; row < 2; ++row)
+			{
+				for (int col{ -2 }; col <= 2; ++col)
+				{
+					if (row == 0 && col == 0)
+						continue;
+					pParkingLot->AddInstance(FPoint3{ static_cast<float>(col) * 45.f, 0.f, static_cast<float>(row) * 35.f },
+						FVector3{ 0,0,row == 0 ? 1.f : -1.f });
+				}
+			}
+			pParkingLot->SetMaterial(pVehicleSoftwareMaterial);
+			pParkingLot->SetIsActive(false);
+			scene.AddGeometry(pParkingLot);
 		}
 
 		{
-			std::vector<IVertex> vertices{};
-			std::vector<uint32_t> indices{};
-			ParseOBJ("Resources/fireFX.obj", vertices, indices);
+			const MeshAsset mesh{ fireFXMesh.get() };
+			std::cout << "fireFX.obj ACMR: " << mesh.acmrBefore << " -> " << mesh.acmrAfter << "\n";
 
-			ExhaustMaterial* material
-			{
-				new ExhaustMaterial (directxRenderer->GetDevice(), L"Resources/Exhaust.fx", 
-					new Texture("Resources/fireFX_diffuse.png", directxRenderer->GetDevice()))
-			};
-
-			pFireFX = new Mesh(directxRenderer->GetDevice(), vertices, indices, material);
+			pFireFX = new Mesh(pDevice, mesh.GetView(), exhaustMaterial.get());
 			pFireFX->SetPosition({ 0,0,50.f });
 			scene.AddMesh(pFireFX);
+
+			pTriangleMeshFireFX = new TriangleMesh(FPoint3{ 0,0,50.f }, TriangleMesh::CreateData(mesh.GetView(), mesh.bounds));
+			pTriangleMeshFireFX->SetMaterial(MakeSoftwareMaterial(TransformVertexShader{}, DiffusePixelShader{ fireFXDiffuse.get() }, BlendMode::Alpha));
+			scene.AddGeometry(pTriangleMeshFireFX);
 		}
+
+		//A ring of small colored lights around the vehicle and a spot light from above, lit by deferred software shading
+		constexpr int ringLightCount{ 256 };
+		for (int i{ 0 }; i < ringLightCount; ++i)
+		{
+			const float angle{ static_cast<float>(i) / static_cast<float>(ringLightCount) * 2.f * static_cast<float>(E_PI) };
+			Light light{};
+			light.position = FPoint3{ std::cos(angle) * 14.f, 1.f + static_cast<float>(i % 4) * 2.f, 50.f + std::sin(angle) * 14.f };
+			light.color = RGBColor{ .5f + .5f * std::cos(angle), .5f + .5f * std::cos(angle + 2.094f), .5f + .5f * std::cos(angle + 4.189f) };
+			light.intensity = 6.f;
+			light.range = 6.f;
+			scene.AddLight(light);
+		}
+		Light spotLight{};
+		spotLight.type = LightType::Spot;
+		spotLight.position = FPoint3{ 0.f, 20.f, 50.f };
+		spotLight.direction = FVector3{ 0.f, -1.f, 0.f };
+		spotLight.intensity = 400.f;
+		spotLight.range = 30.f;
+		scene.AddLight(spotLight);
+
+		std::cout << "Assets loaded in " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - loadStart).count()
+			<< " ms\n";
+		std::cout << textureCache.GetTextureCount() << " textures, " << textureCache.GetCpuMemory() / (1024 * 1024) << " MB on the CPU, "
+			<< textureCache.GetGpuMemory() / (1024 * 1024) << " MB on the GPU\n";
 	}
 	
+	std::cout << "Keys:\n"
+		"  E: switch between the DirectX and the software rasterizer, starts with DirectX\n"
+		"  F: next filter mode, starts with point\n"
+		"  R: rotate the vehicle\n"
+		"  T: show or hide the exhaust\n"
+		"  Middle mouse button: pick the geometry under the cursor\n"
+		"Software rasterizer only:\n"
+		"  P: show or hide the instanced parking lot, starts hidden\n"
+		"  O: front to back ordering, starts on\n"
+		"  I: order independent transparency, starts on\n"
+		"  G: deferred shading, starts off\n"
+		"  H: shadows of the directional light, start off\n"
+		"  J: 16 bit shadow map depth, starts off\n"
+		"  L: level of detail, starts on\n";
+
 	//Start loop
 	pTimer->Start();
 	float printTimer = 0.f;
@@ -131,7 +209,7 @@ int main(int argc, char* args[])
 				isLooping = false;
 				break;
 			case SDL_KEYUP:
-				if (e.key.keysym.sym == SDLK_f && hardwarerasterizer)
+				if (e.key.keysym.sym == SDLK_f)
 				{
 					for (auto* pMesh : scene.GetMeshes())
 					{
@@ -140,6 +218,7 @@ int main(int argc, char* args[])
 
 					int newFilterMode = (static_cast<int>(filterMode) + 1) % static_cast<int>(FilterMode::EndDoNotUse);
 					filterMode = static_cast<FilterMode>(newFilterMode);
+					softwareRenderer->SetFilterMode(filterMode);
 
 					switch (filterMode)
 					{
@@ -167,15 +246,87 @@ int main(int argc, char* args[])
 				if (e.key.keysym.sym == SDLK_t)
 				{
 					pFireFX->SetIsActive(!pFireFX->GetIsActive());
+					pTriangleMeshFireFX->SetIsActive(pFireFX->GetIsActive());
 					if (!pFireFX->GetIsActive())
 						std::cout << "FireFX mesh hidden\n";
 					else
 						std::cout << "FireFX mesh visible\n";
 				}
 
+				if (e.key.keysym.sym == SDLK_p)
+				{
+					pParkingLot->SetIsActive(!pParkingLot->GetIsActive());
+					if (pParkingLot->GetIsActive())
+						std::cout << "Parking lot visible, " << pParkingLot->GetInstanceCount() << " instanced vehicles (software rasterizer)\n";
+					else
+						std::cout << "Parking lot hidden\n";
+				}
+
+				if (e.key.keysym.sym == SDLK_o)
+				{
+					if (softwareRenderer->ToggleFrontToBack())
+						std::cout << "Front-to-back ordering enabled\n";
+					else
+						std::cout << "Front-to-back ordering disabled\n";
+				}
+
+				if (e.key.keysym.sym == SDLK_i)
+				{
+					if (softwareRenderer->ToggleOrderIndependentTransparency())
+						std::cout << "Order independent transparency enabled\n";
+					else
+						std::cout << "Order independent transparency disabled, transparent meshes sorted back to front\n";
+				}
+
+				if (e.key.keysym.sym == SDLK_g)
+				{
+					if (softwareRenderer->ToggleDeferredShading())
+						std::cout << "Deferred shading enabled, " << scene.GetLights().size() << " lights\n";
+					else
+						std::cout << "Deferred shading disabled\n";
+				}
+
+				if (e.key.keysym.sym == SDLK_h)
+				{
+					if (softwareRenderer->ToggleShadows())
+						std::cout << "Shadows enabled\n";
+					else
+						std::cout << "Shadows disabled\n";
+				}
+
+				if (e.key.keysym.sym == SDLK_j)
+				{
+					if (softwareRenderer->ToggleShadowUnorm16Depth())
+						std::cout << "Shadow maps store 16 bit depth\n";
+					else
+						std::cout << "Shadow maps store 32 bit float depth\n";
+				}
+
+				if (e.key.keysym.sym == SDLK_l)
+				{
+					if (softwareRenderer->ToggleLods())
+						std::cout << "Level of detail enabled\n";
+					else
+						std::cout << "Level of detail disabled\n";
+				}
+
 				if (e.key.keysym.scancode == SDL_SCANCODE_R)
 					rotateVehicle = !rotateVehicle;
 				break;
+			case SDL_MOUSEBUTTONUP:
+				if (e.button.button == SDL_BUTTON_MIDDLE)
+				{
+					float distance{};
+					const Ray ray{ scene.GetCamera()->GetRHRay(FPoint2{ static_cast<float>(e.button.x), static_cast<float>(e.button.y) }) };
+					if (const Geometry* pPicked{ scene.Raycast(ray, distance) })
+					{
+						const FPoint3& position{ pPicked->GetPosition() };
+						std::cout << "Picked geometry at (" << position.x << ", " << position.y << ", " << position.z << "), distance " << distance << "\n";
+					}
+					else
+						std::cout << "Nothing picked\n";
+				}
+				break;
 			}
 		}
 
@@ -185,6 +336,7 @@ int main(int argc, char* args[])
 		{
 			Elite::FMatrix3 rotation{ MakeRotationY(ToRadians(45.f * pTimer->GetElapsed())) };
 			pTriangleMeshVehicle->SetForward(rotation * pTriangleMeshVehicle->GetForward());
+			pTriangleMeshFireFX->SetForward(rotation * pTriangleMeshFireFX->GetForward());
 			// todo: rotate Mesh
 			pMeshVehicle->SetForward(rotation * pMeshVehicle->GetForward());
 		}
@@ -206,6 +358,8 @@ int main(int argc, char* args[])
 		{
 			printTimer = 0.f;
 			std::cout << "FPS: " << pTimer->GetFPS() << std::endl;
+			if (!hardwarerasterizer)
+				softwareRenderer->PrintStatistics();
 		}
 
 	}